@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minikv.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * 多线程吞吐量测试：比较“普通实例 + 一把全局互斥锁”和分片实例，
+ * 线程数从 1 递增到 N，每个线程执行固定数量的操作（默认 90% get、10% set）。
+ * 用法：bench_concurrent [最大线程数] [key 数量] [每线程操作数] [get 百分比]
+ */
+
+// 每个线程的参数
+typedef struct {
+    mk_t* kv;
+    pthread_mutex_t* global; // 非 NULL 时每次操作都先加这把锁
+    int keys;
+    long ops;
+    int get_percent;
+    unsigned seed;
+} bench_arg_t;
+
+// 单调时钟，单位秒
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// xorshift 伪随机数，避免 rand() 内部的锁
+static unsigned next_rand(unsigned* state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// 工作线程：随机选择 key 执行 get 或 set
+static void* bench_worker(void* p) {
+    bench_arg_t* arg = (bench_arg_t*)p;
+    char key[32];
+    volatile size_t sink = 0;
+    for (long i = 0; i < arg->ops; i++) {
+        unsigned r = next_rand(&arg->seed);
+        snprintf(key, sizeof(key), "key%u", r % (unsigned)arg->keys);
+        int is_get = (int)((r >> 16) % 100) < arg->get_percent;
+        if (arg->global) pthread_mutex_lock(arg->global);
+        if (is_get) {
+            const char* v = mk_get(arg->kv, key);
+            if (v) sink += (size_t)v[0];
+        } else {
+            mk_set(arg->kv, key, "updated-value");
+        }
+        if (arg->global) pthread_mutex_unlock(arg->global);
+    }
+    (void)sink;
+    return NULL;
+}
+
+// 用 nthreads 个线程跑一轮，返回每秒操作数
+static double run(mk_t* kv, pthread_mutex_t* global, int nthreads, int keys, long ops, int get_percent) {
+    pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)nthreads);
+    bench_arg_t* args = (bench_arg_t*)malloc(sizeof(bench_arg_t) * (size_t)nthreads);
+    double start = now_sec();
+    for (int t = 0; t < nthreads; t++) {
+        args[t] = (bench_arg_t){ kv, global, keys, ops, get_percent, 2463534242u + (unsigned)t * 7919u };
+        pthread_create(&threads[t], NULL, bench_worker, &args[t]);
+    }
+    for (int t = 0; t < nthreads; t++) pthread_join(threads[t], NULL);
+    double elapsed = now_sec() - start;
+    free(threads);
+    free(args);
+    return (double)ops * nthreads / elapsed;
+}
+
+// 预先写入所有 key
+static void fill(mk_t* kv, int keys) {
+    char key[32];
+    for (int i = 0; i < keys; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        mk_set(kv, key, "initial-value");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    int keys = argc > 2 ? atoi(argv[2]) : 1000000;
+    long ops = argc > 3 ? atol(argv[3]) : 1000000;
+    int get_percent = argc > 4 ? atoi(argv[4]) : 90;
+    if (max_threads < 1 || keys < 1 || ops < 1) {
+        fprintf(stderr, "Usage: %s [max_threads] [keys] [ops_per_thread] [get_percent]\n", argv[0]);
+        return 1;
+    }
+
+    mk_t* plain = mk_create();
+    mk_t* sharded = mk_create_concurrent(0);
+    if (!plain || !sharded) return 1;
+    pthread_mutex_t global = PTHREAD_MUTEX_INITIALIZER;
+    fill(plain, keys);
+    fill(sharded, keys);
+
+    printf("keys=%d ops/thread=%ld get=%d%%\n", keys, ops, get_percent);
+    printf("%8s %16s %16s\n", "threads", "global mutex", "sharded");
+    for (int n = 1; n <= max_threads; n *= 2) {
+        double a = run(plain, &global, n, keys, ops, get_percent);
+        double b = run(sharded, NULL, n, keys, ops, get_percent);
+        printf("%8d %13.2f M/s %13.2f M/s\n", n, a / 1e6, b / 1e6);
+    }
+
+    mk_destroy(plain);
+    mk_destroy(sharded);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#define _POSIX_C_SOURCE 200809L
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * 哈希函数微基准：原来的逐字节 djb2（加 fmix64）与当前的 mk_hash 对比。
+ * 分别测试 8~128 字节的固定长度，以及 8~128 字节均匀分布的混合长度。
+ * 用法：bench_hash [每轮 key 数量]
+ */
+
+// 单调时钟，单位秒
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// 原来的哈希：djb2 逐字节递推，最后做一次 fmix64
+static uint64_t djb2_fmix(const void* key, size_t len, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)key;
+    uint64_t hash = 5381;
+    (void)seed;
+    for (size_t i = 0; i < len; i++) hash = ((hash << 5) + hash) + p[i];
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// 对一组 key 反复计算哈希，返回每个 key 的平均纳秒数
+static double measure(uint64_t (*fn)(const void*, size_t, uint64_t), char** keys, size_t* lens, size_t n, int rounds) {
+    volatile uint64_t sink = 0;
+    double start = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) sink += fn(keys[i], lens[i], 42);
+    }
+    (void)sink;
+    return (now_sec() - start) * 1e9 / ((double)n * rounds);
+}
+
+// 生成 n 个随机 key，长度为 fixed（为 0 时在 8~128 之间随机）
+static void make_keys(char** keys, size_t* lens, size_t n, size_t fixed, unsigned* state) {
+    for (size_t i = 0; i < n; i++) {
+        *state = *state * 1103515245u + 12345u;
+        size_t len = fixed ? fixed : 8 + (*state >> 8) % 121;
+        for (size_t j = 0; j < len; j++) {
+            *state = *state * 1103515245u + 12345u;
+            keys[i][j] = (char)('a' + (*state >> 16) % 26);
+        }
+        lens[i] = len;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 4096;
+    if (n == 0) {
+        fprintf(stderr, "Usage: %s [keys_per_round]\n", argv[0]);
+        return 1;
+    }
+    char** keys = (char**)malloc(n * sizeof(char*));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) keys[i] = (char*)malloc(128);
+    unsigned state = 1;
+    // key 总量保持在缓存内，测的是计算本身
+    int rounds = (int)(20000000 / n) + 1;
+
+    size_t lengths[] = { 8, 16, 24, 32, 48, 64, 96, 128, 0 };
+    printf("%10s %14s %14s %8s\n", "key bytes", "djb2 ns/key", "mk_hash ns/key", "speedup");
+    for (size_t t = 0; t < sizeof(lengths) / sizeof(lengths[0]); t++) {
+        make_keys(keys, lens, n, lengths[t], &state);
+        double a = measure(djb2_fmix, keys, lens, n, rounds);
+        double b = measure(mk_hash, keys, lens, n, rounds);
+        char label[32];
+        if (lengths[t]) snprintf(label, sizeof(label), "%zu", lengths[t]);
+        else snprintf(label, sizeof(label), "8-128");
+        printf("%10s %14.2f %14.2f %7.1fx\n", label, a, b, a / b);
+    }
+
+    for (size_t i = 0; i < n; i++) free(keys[i]);
+    free(keys);
+    free(lens);
+    return 0;
+}
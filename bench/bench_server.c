@@ -0,0 +1,226 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+ * minikv-server 吞吐量测试：依次以 1、2、4 … 个工作线程启动服务器（环境变量 MINIKV_SERVER，默认与本程序在同一目录），
+ * 多个客户端线程各开一个连接，以流水线方式发送随机的 GET/SET（默认 90% GET），统计总吞吐量。
+ * 用法：bench_server [最大工作线程数] [连接数] [流水线深度] [每连接请求数] [get 百分比]
+ */
+
+// 测试使用的端口，避免与正在运行的服务冲突
+#define BENCH_PORT 16399
+// key 的取值范围
+#define BENCH_KEYS 100000
+
+// 每个客户端线程的参数
+typedef struct {
+    int pipeline;
+    long requests;
+    int get_percent;
+    unsigned seed;
+    int failed;
+} client_arg_t;
+
+// 单调时钟，单位秒
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// xorshift 伪随机数，避免 rand() 内部的锁
+static unsigned next_rand(unsigned* state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// 连接测试端口，失败返回 -1
+static int connect_server(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(BENCH_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// 从 buf[0, len) 中数出完整的应答（+OK、:n、$-1 或批量字符串），返回已经解析的字节数
+static size_t count_replies(const char* buf, size_t len, int* replies) {
+    size_t pos = 0;
+    while (pos < len) {
+        const char* crlf = memchr(buf + pos, '\n', len - pos);
+        if (!crlf) break;
+        size_t line_end = (size_t)(crlf - buf) + 1;
+        if (buf[pos] == '$' && buf[pos + 1] != '-') {
+            size_t n = (size_t)strtoul(buf + pos + 1, NULL, 10);
+            if (line_end + n + 2 > len) break;
+            line_end += n + 2;
+        }
+        pos = line_end;
+        (*replies)++;
+    }
+    return pos;
+}
+
+// 客户端线程：每轮发送 pipeline 个请求，收齐应答后再发下一轮
+static void* client_main(void* p) {
+    client_arg_t* arg = (client_arg_t*)p;
+    int fd = connect_server();
+    if (fd < 0) {
+        arg->failed = 1;
+        return NULL;
+    }
+    size_t cap = (size_t)arg->pipeline * 64;
+    char* req = (char*)malloc(cap);
+    char buf[1 << 16];
+    for (long done = 0; done < arg->requests && !arg->failed; done += arg->pipeline) {
+        size_t len = 0;
+        for (int i = 0; i < arg->pipeline; i++) {
+            unsigned r = next_rand(&arg->seed);
+            char key[16];
+            int klen = snprintf(key, sizeof(key), "key%06u", r % BENCH_KEYS);
+            if ((int)((r >> 16) % 100) < arg->get_percent) {
+                len += (size_t)sprintf(req + len, "*2\r\n$3\r\nGET\r\n$%d\r\n%s\r\n", klen, key);
+            } else {
+                len += (size_t)sprintf(req + len, "*3\r\n$3\r\nSET\r\n$%d\r\n%s\r\n$5\r\nvalue\r\n", klen, key);
+            }
+        }
+        for (size_t sent = 0; sent < len;) {
+            ssize_t n = write(fd, req + sent, len - sent);
+            if (n <= 0) {
+                arg->failed = 1;
+                break;
+            }
+            sent += (size_t)n;
+        }
+        int replies = 0;
+        size_t have = 0;
+        while (!arg->failed && replies < arg->pipeline) {
+            ssize_t n = read(fd, buf + have, sizeof(buf) - have);
+            if (n <= 0) {
+                arg->failed = 1;
+                break;
+            }
+            have += (size_t)n;
+            size_t used = count_replies(buf, have, &replies);
+            memmove(buf, buf + used, have - used);
+            have -= used;
+        }
+    }
+    free(req);
+    close(fd);
+    return NULL;
+}
+
+// 启动服务器并等待端口可连接，返回子进程 pid
+static pid_t start_server(const char* path, int workers) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char port[16];
+        char threads[16];
+        snprintf(port, sizeof(port), "%d", BENCH_PORT);
+        snprintf(threads, sizeof(threads), "%d", workers);
+        freopen("/dev/null", "w", stdout);
+        execl(path, path, "-p", port, "-t", threads, (char*)NULL);
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && i < 200; i++) {
+        int fd = connect_server();
+        if (fd >= 0) {
+            close(fd);
+            return pid;
+        }
+        struct timespec delay = { 0, 10 * 1000 * 1000 };
+        nanosleep(&delay, NULL);
+    }
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return -1;
+}
+
+// 用 clients 个连接跑一轮，返回每秒操作数，失败返回负数
+static double run(int clients, int pipeline, long requests, int get_percent) {
+    pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)clients);
+    client_arg_t* args = (client_arg_t*)malloc(sizeof(client_arg_t) * (size_t)clients);
+    double start = now_sec();
+    for (int t = 0; t < clients; t++) {
+        args[t] = (client_arg_t){ pipeline, requests, get_percent, 2463534242u + (unsigned)t * 7919u, 0 };
+        pthread_create(&threads[t], NULL, client_main, &args[t]);
+    }
+    int failed = 0;
+    for (int t = 0; t < clients; t++) {
+        pthread_join(threads[t], NULL);
+        failed |= args[t].failed;
+    }
+    double elapsed = now_sec() - start;
+    free(threads);
+    free(args);
+    if (failed) return -1;
+    // 每个连接按整轮发送，实际请求数向上取整到流水线深度的倍数
+    long rounds = (requests + pipeline - 1) / pipeline;
+    return (double)rounds * pipeline * clients / elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int max_workers = argc > 1 ? atoi(argv[1]) : 4;
+    int clients = argc > 2 ? atoi(argv[2]) : 8;
+    int pipeline = argc > 3 ? atoi(argv[3]) : 32;
+    long requests = argc > 4 ? atol(argv[4]) : 200000;
+    int get_percent = argc > 5 ? atoi(argv[5]) : 90;
+    if (max_workers < 1 || clients < 1 || pipeline < 1 || requests < 1) {
+        fprintf(stderr, "Usage: %s [max_workers] [clients] [pipeline] [requests_per_client] [get_percent]\n", argv[0]);
+        return 1;
+    }
+
+    // 服务器路径由环境变量 MINIKV_SERVER 指定，默认与本程序在同一目录
+    char path[4096];
+    const char* slash = strrchr(argv[0], '/');
+    int dirlen = slash ? (int)(slash - argv[0]) : 1;
+    if (getenv("MINIKV_SERVER")) snprintf(path, sizeof(path), "%s", getenv("MINIKV_SERVER"));
+    else snprintf(path, sizeof(path), "%.*s/minikv-server", dirlen, slash ? argv[0] : ".");
+
+    printf("clients=%d pipeline=%d requests/client=%ld get=%d%% cpus=%ld\n",
+           clients, pipeline, requests, get_percent, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %16s\n", "workers", "throughput");
+    for (int n = 1; n <= max_workers; n *= 2) {
+        pid_t pid = start_server(path, n);
+        if (pid < 0) {
+            fprintf(stderr, "Error: Failed to start %s\n", path);
+            return 1;
+        }
+        double ops = run(clients, pipeline, requests, get_percent);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        if (ops < 0) {
+            fprintf(stderr, "Error: Client connection failed with %d workers\n", n);
+            return 1;
+        }
+        printf("%8d %13.2f M/s\n", n, ops / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,380 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minikv.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * 综合基准测试，升级前用来发现性能回退。
+ * 1. 读写混合：均匀分布与 Zipf 分布的 key，若干读写比例，线程数从 1 翻倍到 N。
+ *    单线程用普通实例，多线程用分片实例；每次操作单独计时，统计 p50/p99/p999。
+ * 2. 文件：写入 N 个 key，再分别测文本和二进制格式的保存、加载以及多线程文本加载。
+ * 每个结果输出一行 JSON，字段固定，便于脚本比较两次运行的结果。
+ * 用法：bench_suite [-k key 数量] [-n 每线程操作数] [-t 最大线程数] [-K key 字节数] [-V value 字节数]
+ *                   [-r 读百分比列表，如 100,90,50] [-d uniform|zipf|all] [-z zipf 参数] [-p 临时文件路径]
+ */
+
+// 延迟直方图：小于 16ns 的值每纳秒一档，之后每个 2 的幂区间分 16 档，相对误差不超过 1/16
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+} hist_t;
+
+// 命令行参数
+typedef struct {
+    size_t keys;
+    long ops;
+    int max_threads;
+    size_t key_size;
+    size_t value_size;
+    int read_pcts[8];
+    int nread_pcts;
+    int uniform;
+    int zipf;
+    double theta;
+    const char* path;
+} config_t;
+
+// Zipf 分布的预计算常量（Gray 等人的方法，与 YCSB 的 ZipfianGenerator 相同）
+// 排名 0 的 key 最热；生成时对排名打散，热点 key 不会集中在相邻的编号上
+typedef struct {
+    size_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+} zipf_t;
+
+// 每个线程的参数和结果
+typedef struct {
+    mk_t* kv;
+    const config_t* cfg;
+    const char* keys;
+    const char* value;
+    const zipf_t* zipf;
+    int read_pct;
+    uint64_t seed;
+    hist_t hist;
+} worker_t;
+
+// 单调时钟，单位纳秒
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64* 伪随机数，每个线程一个状态，避免 rand() 内部的锁
+static uint64_t next_rand(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+// [0, 1) 之间的随机浮点数
+static double next_double(uint64_t* state) {
+    return (double)(next_rand(state) >> 11) / 9007199254740992.0;
+}
+
+// 值所在的直方图档位
+static int hist_index(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int sub = (int)((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB + sub;
+}
+
+// 档位代表的值：取区间的中点
+static uint64_t hist_value(int idx) {
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int msb = idx / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t low = (uint64_t)(HIST_SUB + idx % HIST_SUB) << (msb - HIST_SUB_BITS);
+    return low + ((1ULL << (msb - HIST_SUB_BITS)) >> 1);
+}
+
+static void hist_add(hist_t* h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    h->total++;
+}
+
+static void hist_merge(hist_t* dst, const hist_t* src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+}
+
+// 第 q 分位（0~1）的延迟
+static uint64_t hist_quantile(const hist_t* h, double q) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(q * (double)h->total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) return hist_value(i);
+    }
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+// zeta(n, theta) = sum(1 / i^theta)，i 从 1 到 n
+static double zeta(size_t n, double theta) {
+    double sum = 0;
+    for (size_t i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+
+static void zipf_init(zipf_t* z, size_t n, double theta) {
+    z->n = n;
+    z->theta = theta;
+    z->alpha = 1.0 / (1.0 - theta);
+    z->zetan = zeta(n, theta);
+    double zeta2 = zeta(2, theta);
+    z->eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+}
+
+// 按 Zipf 分布取一个排名，再用乘法哈希打散成 key 编号
+static size_t zipf_next(const zipf_t* z, uint64_t* state) {
+    double u = next_double(state);
+    double uz = u * z->zetan;
+    size_t rank;
+    if (uz < 1.0) rank = 0;
+    else if (uz < 1.0 + pow(0.5, z->theta)) rank = 1;
+    else rank = (size_t)((double)z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    if (rank >= z->n) rank = z->n - 1;
+    return (size_t)((rank * 0x9e3779b97f4a7c15ULL) % z->n);
+}
+
+// 第 i 个 key：固定长度，前缀 k 加补零的编号，预先生成在一块连续内存里
+static const char* key_at(const worker_t* w, size_t i) {
+    return w->keys + i * (w->cfg->key_size + 1);
+}
+
+static char* make_keys(const config_t* cfg) {
+    size_t stride = cfg->key_size + 1;
+    char* keys = (char*)malloc(cfg->keys * stride);
+    if (!keys) return NULL;
+    for (size_t i = 0; i < cfg->keys; i++) {
+        snprintf(keys + i * stride, stride, "k%0*zu", (int)(cfg->key_size - 1), i);
+    }
+    return keys;
+}
+
+// 工作线程：按分布选 key，按比例执行 get 或 set，每次操作单独计时
+static void* worker_run(void* p) {
+    worker_t* w = (worker_t*)p;
+    volatile size_t sink = 0;
+    for (long i = 0; i < w->cfg->ops; i++) {
+        uint64_t r = next_rand(&w->seed);
+        size_t idx = w->zipf ? zipf_next(w->zipf, &w->seed) : (size_t)(r % w->cfg->keys);
+        const char* key = key_at(w, idx);
+        int is_get = (int)((r >> 40) % 100) < w->read_pct;
+        uint64_t start = now_ns();
+        if (is_get) {
+            mk_read_begin(w->kv);
+            const char* v = mk_get(w->kv, key);
+            if (v) sink += (size_t)v[0];
+            mk_read_end(w->kv);
+        } else {
+            mk_set(w->kv, key, w->value);
+        }
+        hist_add(&w->hist, now_ns() - start);
+    }
+    (void)sink;
+    return NULL;
+}
+
+// 按顺序写入全部 key，返回写入延迟的直方图，耗时通过 elapsed 返回
+static int fill(mk_t* kv, const worker_t* proto, hist_t* hist, double* elapsed) {
+    uint64_t begin = now_ns();
+    for (size_t i = 0; i < proto->cfg->keys; i++) {
+        uint64_t start = now_ns();
+        if (mk_set(kv, key_at(proto, i), proto->value) != 0) return -1;
+        hist_add(hist, now_ns() - start);
+    }
+    *elapsed = (double)(now_ns() - begin) / 1e9;
+    return 0;
+}
+
+// 输出一条读写测试的结果
+static void report_ops(const char* bench, const char* dist, int threads, int read_pct,
+                       const config_t* cfg, const hist_t* h, double elapsed) {
+    printf("{\"bench\":\"%s\",\"dist\":\"%s\",\"threads\":%d,\"read_pct\":%d,"
+           "\"keys\":%zu,\"key_size\":%zu,\"value_size\":%zu,\"ops\":%llu,\"seconds\":%.3f,"
+           "\"ops_per_sec\":%.0f,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu}\n",
+           bench, dist, threads, read_pct, cfg->keys, cfg->key_size, cfg->value_size,
+           (unsigned long long)h->total, elapsed, (double)h->total / elapsed,
+           (unsigned long long)hist_quantile(h, 0.50), (unsigned long long)hist_quantile(h, 0.99),
+           (unsigned long long)hist_quantile(h, 0.999));
+    fflush(stdout);
+}
+
+// 输出一条文件测试的结果，吞吐量按 key 数和文件大小计算
+static void report_file(const char* bench, int threads, const config_t* cfg, const char* path, double elapsed) {
+    struct stat st;
+    double mb = stat(path, &st) == 0 ? (double)st.st_size / (1024.0 * 1024.0) : 0;
+    printf("{\"bench\":\"%s\",\"threads\":%d,\"keys\":%zu,\"key_size\":%zu,\"value_size\":%zu,"
+           "\"file_mb\":%.1f,\"seconds\":%.3f,\"ops_per_sec\":%.0f,\"mb_per_sec\":%.1f}\n",
+           bench, threads, cfg->keys, cfg->key_size, cfg->value_size, mb, elapsed,
+           (double)cfg->keys / elapsed, mb / elapsed);
+    fflush(stdout);
+}
+
+// 用 nthreads 个线程跑一轮读写混合
+static int run_mix(const config_t* cfg, const worker_t* proto, const zipf_t* zipf,
+                   const char* dist, int nthreads, int read_pct) {
+    mk_t* kv = nthreads == 1 ? mk_create() : mk_create_concurrent(0);
+    hist_t* fill_hist = (hist_t*)calloc(1, sizeof(hist_t));
+    pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)nthreads);
+    worker_t* workers = (worker_t*)calloc((size_t)nthreads, sizeof(worker_t));
+    double elapsed = 0;
+    int ret = -1;
+    if (!kv || !fill_hist || !threads || !workers || fill(kv, proto, fill_hist, &elapsed) != 0) goto out;
+    uint64_t begin = now_ns();
+    for (int t = 0; t < nthreads; t++) {
+        workers[t] = *proto;
+        workers[t].kv = kv;
+        workers[t].zipf = zipf;
+        workers[t].read_pct = read_pct;
+        workers[t].seed = 0x9e3779b97f4a7c15ULL * (uint64_t)(t + 1);
+        pthread_create(&threads[t], NULL, worker_run, &workers[t]);
+    }
+    for (int t = 0; t < nthreads; t++) pthread_join(threads[t], NULL);
+    elapsed = (double)(now_ns() - begin) / 1e9;
+    // 合并到第一个线程的直方图
+    for (int t = 1; t < nthreads; t++) hist_merge(&workers[0].hist, &workers[t].hist);
+    report_ops("mix", dist, nthreads, read_pct, cfg, &workers[0].hist, elapsed);
+    ret = 0;
+out:
+    free(workers);
+    free(threads);
+    free(fill_hist);
+    mk_destroy(kv);
+    return ret;
+}
+
+// 写入全部 key 后测文本、二进制格式的保存和加载
+static int run_files(const config_t* cfg, const worker_t* proto) {
+    char text[4096], binary[4096];
+    snprintf(text, sizeof(text), "%s.kv", cfg->path);
+    snprintf(binary, sizeof(binary), "%s.bin", cfg->path);
+    hist_t* hist = (hist_t*)calloc(1, sizeof(hist_t));
+    mk_t* kv = mk_create();
+    double elapsed;
+    int ret = -1;
+    if (!hist || !kv || fill(kv, proto, hist, &elapsed) != 0) goto out;
+    report_ops("insert", "sequential", 1, 0, cfg, hist, elapsed);
+
+    uint64_t start = now_ns();
+    if (mk_save(kv, text) != 0) goto out;
+    report_file("save_text", 1, cfg, text, (double)(now_ns() - start) / 1e9);
+    start = now_ns();
+    if (mk_save_binary(kv, binary) != 0) goto out;
+    report_file("save_binary", 1, cfg, binary, (double)(now_ns() - start) / 1e9);
+    mk_destroy(kv);
+    kv = NULL;
+
+    // 每种加载各用一个新实例，计时包含创建和销毁之外的全部工作
+    const char* names[3] = { "load_text", "load_text_parallel", "load_binary" };
+    for (int i = 0; i < 3; i++) {
+        kv = mk_create();
+        if (!kv) goto out;
+        const char* path = i == 2 ? binary : text;
+        int nthreads = i == 1 ? cfg->max_threads : 1;
+        start = now_ns();
+        int failed = i == 1 ? mk_load_parallel(kv, path, nthreads) : mk_load(kv, path);
+        double secs = (double)(now_ns() - start) / 1e9;
+        if (failed || mk_count(kv) != cfg->keys) goto out;
+        report_file(names[i], nthreads, cfg, path, secs);
+        mk_destroy(kv);
+        kv = NULL;
+    }
+    ret = 0;
+out:
+    if (ret != 0) fprintf(stderr, "file benchmark failed\n");
+    mk_destroy(kv);
+    free(hist);
+    remove(text);
+    remove(binary);
+    return ret;
+}
+
+// 解析逗号分隔的读百分比列表
+static int parse_pcts(config_t* cfg, char* list) {
+    cfg->nread_pcts = 0;
+    for (char* tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        int pct = atoi(tok);
+        if (pct < 0 || pct > 100 || cfg->nread_pcts == 8) return -1;
+        cfg->read_pcts[cfg->nread_pcts++] = pct;
+    }
+    return cfg->nread_pcts > 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    config_t cfg = { 1000000, 1000000, 4, 16, 64, { 100, 90, 50 }, 3, 1, 1, 0.99, "/tmp/minikv-bench" };
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "k:n:t:K:V:r:d:z:p:")) != -1) {
+        switch (opt) {
+        case 'k': cfg.keys = (size_t)atol(optarg); break;
+        case 'n': cfg.ops = atol(optarg); break;
+        case 't': cfg.max_threads = atoi(optarg); break;
+        case 'K': cfg.key_size = (size_t)atol(optarg); break;
+        case 'V': cfg.value_size = (size_t)atol(optarg); break;
+        case 'r': if (parse_pcts(&cfg, optarg) != 0) bad = 1; break;
+        case 'd':
+            cfg.uniform = strcmp(optarg, "zipf") != 0;
+            cfg.zipf = strcmp(optarg, "uniform") != 0;
+            break;
+        case 'z': cfg.theta = atof(optarg); break;
+        case 'p': cfg.path = optarg; break;
+        default: bad = 1;
+        }
+    }
+    // key 要放得下前缀和最大的编号
+    int digits = snprintf(NULL, 0, "%zu", cfg.keys - 1);
+    if (bad || cfg.keys < 2 || cfg.ops < 1 || cfg.max_threads < 1 || cfg.key_size < (size_t)digits + 1 ||
+        cfg.value_size < 1 || cfg.theta <= 0 || cfg.theta >= 1) {
+        fprintf(stderr, "Usage: %s [-k keys] [-n ops_per_thread] [-t max_threads] [-K key_bytes] [-V value_bytes]\n"
+                        "       [-r read_pct[,read_pct...]] [-d uniform|zipf|all] [-z zipf_theta] [-p tmp_path]\n", argv[0]);
+        return 1;
+    }
+
+    char* keys = make_keys(&cfg);
+    char* value = (char*)malloc(cfg.value_size + 1);
+    if (!keys || !value) return 1;
+    memset(value, 'v', cfg.value_size);
+    value[cfg.value_size] = '\0';
+    worker_t proto;
+    memset(&proto, 0, sizeof(proto));
+    proto.cfg = &cfg;
+    proto.keys = keys;
+    proto.value = value;
+    zipf_t zipf;
+    zipf_init(&zipf, cfg.keys, cfg.theta);
+
+    int ret = 0;
+    for (int d = 0; d < 2; d++) {
+        if (d == 0 ? !cfg.uniform : !cfg.zipf) continue;
+        for (int r = 0; r < cfg.nread_pcts; r++) {
+            for (int n = 1; n <= cfg.max_threads; n *= 2) {
+                if (run_mix(&cfg, &proto, d ? &zipf : NULL, d ? "zipf" : "uniform", n, cfg.read_pcts[r]) != 0) ret = 1;
+            }
+        }
+    }
+    if (run_files(&cfg, &proto) != 0) ret = 1;
+
+    free(keys);
+    free(value);
+    return ret;
+}
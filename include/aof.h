@@ -0,0 +1,84 @@
+#ifndef AOF_H
+#define AOF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 追加写日志（append-only log）句柄。
+ * 每条 set/del 以一条记录追加到日志末尾，记录格式：
+ *   set: "S <klen> <vlen>\n" + key + value + "\n"
+ *   带过期时间的 set: "X <klen> <vlen> <过期时刻>\n" + key + value + "\n"，过期时刻是毫秒级 Unix 时间
+ *   del: "D <klen>\n" + key + "\n"
+ * key/value 按长度读取，内容中可以出现空格、'=' 等任意字符。
+ */
+typedef struct mk_aof mk_aof_t;
+
+/**
+ * 重放日志时对 set 记录调用的回调，key/value 均以 '\0' 结尾。
+ * expire_at 是过期时刻（毫秒级 Unix 时间），普通 set 记录为 0。
+ */
+typedef int (*mk_aof_set_fn)(void* ctx, const char* key, size_t klen, const char* value, size_t vlen,
+                             uint64_t expire_at);
+
+/**
+ * 重放日志时对 del 记录调用的回调，key 以 '\0' 结尾。
+ */
+typedef int (*mk_aof_del_fn)(void* ctx, const char* key, size_t klen);
+
+/**
+ * 以追加方式打开（不存在则创建）日志文件。
+ * @param path 日志文件路径。
+ * @param policy fsync 策略（mk_fsync_t）。
+ * @param interval_ms policy 为 MK_FSYNC_INTERVAL 时两次 fsync 的最小间隔。
+ * @return 成功返回句柄，失败返回 NULL。
+ */
+mk_aof_t* mk_aof_open(const char* path, int policy, unsigned interval_ms);
+
+/**
+ * 追加一条 set 记录，并按策略决定是否 fsync。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_aof_append_set(mk_aof_t* aof, const char* key, size_t klen, const char* value, size_t vlen);
+
+/**
+ * 追加一条带过期时间的 set 记录，并按策略决定是否 fsync。
+ * @param expire_at 过期时刻（毫秒级 Unix 时间）。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_aof_append_set_ex(mk_aof_t* aof, const char* key, size_t klen, const char* value, size_t vlen,
+                         uint64_t expire_at);
+
+/**
+ * 追加一条 del 记录，并按策略决定是否 fsync。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_aof_append_del(mk_aof_t* aof, const char* key, size_t klen);
+
+/**
+ * 立即把已追加的记录 fsync 到磁盘。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_aof_sync(mk_aof_t* aof);
+
+/**
+ * 清空日志（日志已折叠进快照之后调用）。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_aof_truncate(mk_aof_t* aof);
+
+/**
+ * 关闭日志；除 MK_FSYNC_NEVER 外会先 fsync。
+ */
+void mk_aof_close(mk_aof_t* aof);
+
+/**
+ * 按顺序重放日志中的所有记录。
+ * 末尾不完整的记录（写入途中崩溃）会被截掉，保证之后追加的记录可以被读到。
+ * 文件中间的记录损坏（记录头无法解析、长度超过 32 位、结尾不是换行）时停止重放并报错，不改动文件。
+ * @param path 日志文件路径。
+ * @return 成功返回 0，日志不存在返回 1，内存不足返回 -1，截断失败返回 -2，记录损坏返回 -3。
+ */
+int mk_aof_replay(const char* path, mk_aof_set_fn on_set, mk_aof_del_fn on_del, void* ctx);
+
+#endif // AOF_H
@@ -0,0 +1,45 @@
+#ifndef EBR_H
+#define EBR_H
+
+#include <stdint.h>
+
+/**
+ * 基于 epoch 的内存回收（epoch-based reclamation）。
+ * 读线程在访问共享节点前 pin 住当前 epoch，访问结束后 unpin；
+ * 写线程把摘下的对象连同当时的全局 epoch 一起挂到待回收列表，
+ * 全局 epoch 前进两次之后，所有可能还持有该对象的读线程都已经离开，可以安全释放。
+ * 整个进程共用一个 epoch 域，每个线程第一次 pin 时自动登记。
+ */
+
+/**
+ * 进入读临界区，可以嵌套，只有最外层会记录 epoch。
+ */
+void mk_ebr_pin(void);
+
+/**
+ * 离开读临界区，与 mk_ebr_pin 成对调用。
+ */
+void mk_ebr_unpin(void);
+
+/**
+ * 读取当前全局 epoch，用作待回收对象的时间戳。
+ * 调用前对象必须已经从所有共享结构中摘下。
+ * @return 当前全局 epoch。
+ */
+uint64_t mk_ebr_retire_epoch(void);
+
+/**
+ * 所有处于读临界区的线程都已经看到当前 epoch 时，把全局 epoch 加一。
+ * 不会等待，有线程落后时直接返回。
+ * @return 尝试之后的全局 epoch。
+ */
+uint64_t mk_ebr_try_advance(void);
+
+/**
+ * 判断在 retired 时退休的对象现在能否释放。
+ * @param retired mk_ebr_retire_epoch 返回的时间戳。
+ * @return 可以释放返回 1，否则返回 0。
+ */
+int mk_ebr_can_free(uint64_t retired);
+
+#endif // EBR_H
@@ -0,0 +1,26 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 带种子的 64 位哈希（wyhash 风格）。
+ * 每次读取 8 字节，用 64x64->128 位乘法混合，16 字节以内的 key 只需一两次乘法。
+ * 同一个种子下结果稳定；不同种子的结果互不相关，外部无法预先构造冲突的 key。
+ * @param key 数据起始位置，不要求以 '\0' 结尾。
+ * @param len 数据长度。
+ * @param seed 种子。
+ * @return 64 位哈希值。
+ */
+uint64_t mk_hash(const void* key, size_t len, uint64_t seed);
+
+/**
+ * 生成一个随机种子。
+ * 进程内第一次调用时从 /dev/urandom 读取随机数，之后每次调用在此基础上混合计数器，
+ * 不同实例得到不同的种子。
+ * @return 64 位种子。
+ */
+uint64_t mk_hash_random_seed(void);
+
+#endif // HASH_H
@@ -0,0 +1,62 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include "minikv_internal.h"
+#include <stddef.h>
+
+/**
+ * 按 key 排序的有序索引（跳表）。
+ * 索引项只保存节点指针，不复制 key；哈希表替换或删除节点时同步更新。
+ * key 按字节比较（memcmp），较短的 key 是较长 key 的前缀时排在前面。
+ * 并发实例的所有分片共用一个索引，由索引自带的互斥锁保护。
+ */
+typedef struct mk_index mk_index_t;
+
+/**
+ * 创建空索引。
+ * @param locked 非 0 时每个操作都加索引锁（并发实例使用）。
+ * @return 成功返回索引，失败返回 NULL。
+ */
+mk_index_t* mk_index_create(int locked);
+
+/**
+ * 释放索引，不释放索引中的节点。
+ */
+void mk_index_destroy(mk_index_t* index);
+
+/**
+ * 用一批 key 互不相同的节点建立索引，调用方保证索引为空。
+ * 先对节点指针排序，再按顺序一次性串起各层，比逐个插入少了大量随机访问。
+ * @param nodes 节点数组，函数返回后内容按 key 排好序。
+ * @param n 节点数量。
+ * @return 成功返回 0，内存不足返回 -1。
+ */
+int mk_index_build(mk_index_t* index, mk_node_t** nodes, size_t n);
+
+/**
+ * 插入节点，调用方保证索引中还没有相同的 key。
+ * @return 成功返回 0，内存不足返回 -1。
+ */
+int mk_index_insert(mk_index_t* index, mk_node_t* node);
+
+/**
+ * 同一个 key 的节点被替换后，让索引项指向新节点。
+ */
+void mk_index_replace(mk_index_t* index, mk_node_t* node);
+
+/**
+ * 删除 key 与 node 相同的索引项。
+ */
+void mk_index_remove(mk_index_t* index, const mk_node_t* node);
+
+/**
+ * 按 key 从小到大遍历 [start, end) 范围内的节点，持有索引锁调用回调。
+ * @param start 起始 key（包含），NULL 表示从最小的 key 开始。
+ * @param end 结束 key（不包含），NULL 表示一直到最大的 key；prefix 非 0 时忽略。
+ * @param prefix 非 0 时只遍历以 start 为前缀的 key。
+ * @return 遍历的节点数量。
+ */
+size_t mk_index_range(mk_index_t* index, const char* start, size_t slen, const char* end, size_t elen, int prefix,
+                      void (*callback)(const mk_node_t* node, void* user_data), void* user_data);
+
+#endif // INDEX_H
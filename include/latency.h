@@ -0,0 +1,60 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "minikv_internal.h"
+#include <stdint.h>
+
+/**
+ * 按操作类型记录延迟的直方图。
+ * 档位按对数划分：小于 8ns 每纳秒一档，之后每个 2 的幂区间等分 8 档，
+ * 记录时只需找最高位和其后 3 位，不做除法和浮点运算。
+ * 计数用原子加，无锁读线程可以同时记录；并发实例的各分片共用一份，由实例负责释放。
+ * 第一次开启后一直保留到实例销毁，暂停只清开关，记录中的线程不会访问已释放的内存。
+ */
+typedef struct mk_latency_hist {
+    // 是否记录，原子访问
+    int enabled;
+    uint64_t counts[MK_OP_COUNT][MK_LATENCY_BUCKETS];
+    uint64_t total_ns[MK_OP_COUNT];
+    uint64_t max_ns[MK_OP_COUNT];
+} mk_latency_hist_t;
+
+/**
+ * 单调时钟的纳秒数。
+ */
+uint64_t mk_latency_now(void);
+
+/**
+ * 把从 start 到现在的耗时记到 op 的直方图中。
+ */
+void mk_latency_record(mk_latency_hist_t* hist, mk_op_t op, uint64_t start);
+
+/**
+ * 开始计时：未开启记录时返回 0，否则返回当前时间。
+ * 编译时定义 MK_NO_LATENCY 则恒为 0，之后的 mk_latency_end 什么也不做。
+ */
+static inline uint64_t mk_latency_begin(const mk_t* kv) {
+#ifdef MK_NO_LATENCY
+    (void)kv;
+    return 0;
+#else
+    mk_latency_hist_t* hist = __atomic_load_n(&kv->latency, __ATOMIC_ACQUIRE);
+    if (!hist || !__atomic_load_n(&hist->enabled, __ATOMIC_RELAXED)) return 0;
+    return mk_latency_now();
+#endif
+}
+
+/**
+ * 结束计时并记录，start 为 0（开始时未开启）时什么也不做。
+ */
+static inline void mk_latency_end(const mk_t* kv, mk_op_t op, uint64_t start) {
+#ifdef MK_NO_LATENCY
+    (void)kv;
+    (void)op;
+    (void)start;
+#else
+    if (start) mk_latency_record(__atomic_load_n(&kv->latency, __ATOMIC_ACQUIRE), op, start);
+#endif
+}
+
+#endif // LATENCY_H
@@ -2,6 +2,7 @@
 #define MINIKV_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * MiniKV 实例句柄。
@@ -15,6 +16,25 @@ typedef struct mk_t mk_t;
  */
 mk_t* mk_create(void);
 
+/**
+ * 创建一个线程安全的 MiniKV 实例。
+ * 键值对按哈希分布到 nshards 个分片，每个分片有独立的读写锁：
+ * 不同分片上的写操作互不阻塞。mk_get 不加锁，写操作以原子替换指针的方式发布新值，
+ * 被替换或删除的旧值按 epoch 延迟回收。
+ * 并发实例上所有 API 都可以从多个线程同时调用（mk_destroy 除外）。
+ * - mk_get 返回的指针只在 mk_read_begin/mk_read_end 之间保证有效，
+ *   即使其他线程同时覆盖或删除了该 key；在读临界区之外调用 mk_get 时，
+ *   返回值只能用来判断 key 是否存在；
+ * - mk_count 依次累加各分片的计数，有并发写入时是某个中间值，没有时是精确值；
+ * - mk_foreach 逐个分片持有读锁遍历，每个条目最多访问一次，同一分片内的结果
+ *   是一致的，遍历期间其他分片上的修改可能看见也可能看不见；
+ *   回调中不能对同一实例执行写操作；
+ * - mk_save、mk_save_binary 和 mk_log_compact 持有所有分片的读锁，得到某一时刻的完整快照。
+ * @param nshards 分片数量，向上取整为 2 的幂；小于等于 0 时使用默认值。
+ * @return 成功返回实例指针，失败返回 NULL。
+ */
+mk_t* mk_create_concurrent(int nshards);
+
 /**
  * 销毁 MiniKV 实例并释放相关内存。
  * @param kv 需要销毁的实例。
@@ -24,6 +44,9 @@ void mk_destroy(mk_t* kv);
 /**
  * 从文件加载键值对到实例中。
  * 已存在的 key 可能会被覆盖。
+ * 文件可以是文本格式或二进制快照（自动识别）；二进制快照通过 mmap 加载，
+ * 节点直接指向映射中的记录，直到被修改时才复制出来。
+ * 若存在日志文件 "<filepath>.log"，加载快照后会按顺序重放日志。
  * @param kv 实例。
  * @param filepath 文件路径。
  * @return 成功返回 0，失败返回非 0 错误码。
@@ -31,14 +54,43 @@ void mk_destroy(mk_t* kv);
 int mk_load(mk_t* kv, const char* filepath);
 
 /**
- * 将实例中的所有键值对保存到文件。
- * 文件内容会被覆盖。
+ * 使用多个线程从文本文件加载键值对，适合很大的文件。
+ * 文件在换行处切成若干块并行解析，重复 key 的结果与 mk_load 相同（后出现的生效）。
+ * 与 mk_load 一样会识别二进制快照并重放 "<filepath>.log"。
+ * @param kv 实例。
+ * @param filepath 文件路径。
+ * @param nthreads 线程数，小于等于 0 时使用在线 CPU 数。
+ * @return 成功返回 0，文件不存在返回 1，其他错误返回负数。
+ */
+int mk_load_parallel(mk_t* kv, const char* filepath, int nthreads);
+
+/**
+ * 将实例中的所有键值对以文本格式保存到文件。
+ * 先写入临时文件，fsync 后 rename 替换目标文件并 fsync 所在目录；中途出错或崩溃时目标文件保持原样。
+ * 内容攒在几块 256KB 的缓冲区中，用 writev 成批写出；写入量和耗时计入 mk_stats。
  * @param kv 实例。
  * @param filepath 文件路径。
  * @return 成功返回 0，失败返回非 0 错误码。
  */
 int mk_save(mk_t* kv, const char* filepath);
 
+/**
+ * 将实例中的所有键值对保存为二进制快照。
+ * 快照包含版本化的文件头、预先计算好的哈希、带长度前缀的 key/value 以及校验和，
+ * 可以被 mk_load 直接 mmap 加载。写入方式和落盘保证与 mk_save 相同。
+ * @param kv 实例。
+ * @param filepath 文件路径。
+ * @return 成功返回 0，失败返回非 0 错误码。
+ */
+int mk_save_binary(mk_t* kv, const char* filepath);
+
+/**
+ * 判断文件是否为二进制快照。
+ * @param filepath 文件路径。
+ * @return 是返回 1，不是或无法读取返回 0。
+ */
+int mk_file_is_binary(const char* filepath);
+
 /**
  * 获取与 key 对应的 value。
  * @param kv 实例。
@@ -48,15 +100,105 @@ int mk_save(mk_t* kv, const char* filepath);
  */
 const char* mk_get(const mk_t* kv, const char* key);
 
+/**
+ * value 的只读视图：指针加长度。
+ * data 之后总是跟着一个 '\0'，value 本身也可以包含 '\0'。
+ */
+typedef struct {
+    const char* data;
+    size_t len;
+} mk_view_t;
+
+/**
+ * 按长度获取 value，key 可以是任意字节。
+ * 返回的视图与 mk_get 返回的指针有效期相同。
+ * @param kv 实例。
+ * @param key key 起始位置。
+ * @param klen key 长度。
+ * @param out 输出参数，找到时指向 value 及其长度，未找到时为 {NULL, 0}。
+ * @return 找到返回 1，未找到返回 0，参数错误返回 -1。
+ */
+int mk_get_n(const mk_t* kv, const char* key, size_t klen, mk_view_t* out);
+
+/**
+ * 按长度设置键值对，key 和 value 都可以是任意字节（包括 '\0' 和换行）。
+ * 与 mk_set 不同，key 不限制字符集，只要求非空。
+ * 文本格式保存时，无法写成普通 key=value 行的键值对会写成以 '!' 开头的转义行，
+ * 二进制快照和日志按长度保存，都可以原样读回。
+ * @param kv 实例。
+ * @param key key 起始位置。
+ * @param klen key 长度。
+ * @param value value 起始位置，vlen 为 0 时可以为 NULL。
+ * @param vlen value 长度。
+ * @return 成功返回 0；参数错误返回 -1，key 为空或过长返回 -2；追加日志失败返回 -3。
+ */
+int mk_set_n(mk_t* kv, const char* key, size_t klen, const char* value, size_t vlen);
+
+/**
+ * 按长度删除键值对。
+ * @param kv 实例。
+ * @param key key 起始位置。
+ * @param klen key 长度。
+ * @return 删除成功或未找到都返回 0，出错返回非 0。
+ */
+int mk_del_n(mk_t* kv, const char* key, size_t klen);
+
+/**
+ * 进入读临界区。并发实例中，期间 mk_get 返回的指针一直有效，
+ * 离开临界区后不能再访问；读临界区可以嵌套，应尽量短，长时间停留会推迟旧值的回收。
+ * 普通实例上什么也不做。
+ * @param kv 实例。
+ */
+void mk_read_begin(const mk_t* kv);
+
+/**
+ * 离开读临界区，与 mk_read_begin 成对调用。
+ * @param kv 实例。
+ */
+void mk_read_end(const mk_t* kv);
+
 /**
  * 设置键值对；若 key 已存在则覆盖旧值。
  * @param kv 实例。
  * @param key 键。
  * @param value 值。
  * @return 成功返回 0，失败返回非 0。
+ *         已开启日志但追加记录失败时返回 -3（内存中的数据已更新）。
  */
 int mk_set(mk_t* kv, const char* key, const char* value);
 
+/**
+ * 设置带过期时间的键值对；若 key 已存在则覆盖旧值和旧的过期时间。
+ * 过期时间按墙上时钟记录，保存到文件和日志中，重新加载后继续计时。
+ * 过期的 key 立即对读取和遍历不可见，内存在之后的写操作或 mk_expire 中回收。
+ * 用 mk_set 覆盖会清除过期时间。
+ * @param kv 实例。
+ * @param key 键。
+ * @param value 值。
+ * @param ttl_ms 存活时间（毫秒），必须大于 0。
+ * @return 成功返回 0；参数缺失或 ttl_ms 无效返回 -1，无效 key 返回 -2；
+ *         已开启日志但追加记录失败时返回 -3（内存中的数据已更新）。
+ */
+int mk_set_ex(mk_t* kv, const char* key, const char* value, uint64_t ttl_ms);
+
+/**
+ * 查询 key 的剩余存活时间。
+ * @param kv 实例。
+ * @param key 键。
+ * @return 剩余毫秒数；key 存在但没有过期时间返回 -1；key 不存在或已过期返回 -2。
+ */
+long long mk_ttl(const mk_t* kv, const char* key);
+
+/**
+ * 回收所有已经过期的 key。
+ * 通常不需要调用：写操作会顺带回收少量到期的 key；
+ * 写入很少而过期 key 很多时，可以定期调用它及时释放内存。
+ * 开销与到期的 key 数量成正比，与 key 总数无关。
+ * @param kv 实例。
+ * @return 回收的 key 数量。
+ */
+size_t mk_expire(mk_t* kv);
+
 /**
  * 删除键值对。
  * @param kv 实例。
@@ -66,8 +208,43 @@ int mk_set(mk_t* kv, const char* key, const char* value);
  */
 int mk_del(mk_t* kv, const char* key);
 
+/**
+ * 批量获取多个 key 的 value。
+ * 先计算整批 key 的哈希并预取对应的槽位和节点，再逐个查找，
+ * 多个 key 的缓存未命中可以重叠，比循环调用 mk_get 快。
+ * 返回的指针与 mk_get 的有效期相同。
+ * @param kv 实例。
+ * @param keys key 数组，元素为 NULL 时对应结果为 NULL。
+ * @param n key 数量。
+ * @param values 输出数组，长度至少为 n，未找到的 key 对应 NULL。
+ * @return 找到的 key 数量，参数错误返回 -1。
+ */
+int mk_mget(const mk_t* kv, const char* const* keys, size_t n, const char** values);
+
+/**
+ * 批量设置键值对，按数组顺序写入，同一个 key 出现多次时后面的生效。
+ * 先校验所有 key，有无效 key 时整批都不写入。
+ * @param kv 实例。
+ * @param keys key 数组。
+ * @param values value 数组，与 keys 一一对应。
+ * @param n 键值对数量。
+ * @return 成功返回 0；参数缺失返回 -1，存在无效 key 返回 -2；
+ *         中途写入失败时返回对应的错误码，之前的键值对已经写入。
+ */
+int mk_mset(mk_t* kv, const char* const* keys, const char* const* values, size_t n);
+
+/**
+ * 批量删除 key，不存在的 key 和 NULL 元素会被忽略。
+ * @param kv 实例。
+ * @param keys key 数组。
+ * @param n key 数量。
+ * @return 实际删除的数量，出错返回负数。
+ */
+int mk_mdel(mk_t* kv, const char* const* keys, size_t n);
+
 /**
  * 获取存储的键值对数量。
+ * 已经过期但还没有回收的 key 也计算在内。
  * @param kv 实例。
  * @return 键值对数量。
  */
@@ -81,4 +258,284 @@ size_t mk_count(const mk_t* kv);
  */
 void mk_foreach(const mk_t* kv, void (*callback)(const char* key, const char* value, void* user_data), void* user_data);
 
+/**
+ * 按长度遍历所有键值对，与 mk_foreach 相同，但 key/value 以切片给出，可以含 '\0'。
+ * @param kv 实例。
+ * @param callback 对每个条目调用的回调（key、value、user_data）。
+ * @param user_data 传递给回调的用户数据。
+ */
+void mk_foreach_n(const mk_t* kv, void (*callback)(const mk_view_t* key, const mk_view_t* value, void* user_data), void* user_data);
+
+/**
+ * 游标式遍历，可以分多次调用完成，两次调用之间可以任意修改实例。
+ * 第一次传入游标 0，之后传入上次的返回值，返回 0 表示遍历结束。
+ * 遍历期间一直存在的键值对至少返回一次，即使中途表扩容或缩容；
+ * 期间新增或删除的键值对可能返回也可能不返回，同一个键值对可能返回多次。
+ * 回调中不能修改实例；并发实例每次调用只持有一个分片的读锁。
+ * @param kv 实例。
+ * @param cursor 游标，从 0 开始。
+ * @param count 本次大约返回的键值对数量（0 按 1 处理），空表中检查的桶数也有上限。
+ * @param callback 对每个条目调用的回调（key、value、user_data）。
+ * @param user_data 传递给回调的用户数据。
+ * @return 下一次调用使用的游标，0 表示遍历结束。
+ */
+uint64_t mk_scan(const mk_t* kv, uint64_t cursor, size_t count,
+                 void (*callback)(const char* key, const char* value, void* user_data), void* user_data);
+
+/**
+ * 开启按 key 排序的有序索引，已有的键值对会全部建入索引。
+ * 开启后每次写入和删除都同步维护索引，可以用 mk_range/mk_prefix 做有序遍历。
+ * 已有数据较多时，在 mk_load 之后开启比边加载边插入更快。重复调用没有影响。
+ * @param kv 实例。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_index_enable(mk_t* kv);
+
+/**
+ * 按 key 的字节序从小到大遍历 [start, end) 范围内的键值对，耗时 O(log n + k)。
+ * 回调中不能修改实例；并发实例遍历期间其他线程的写操作会等待。
+ * @param kv 已开启有序索引的实例。
+ * @param start 起始 key（包含），NULL 表示从最小的 key 开始。
+ * @param end 结束 key（不包含），NULL 表示一直到最大的 key。
+ * @param callback 对每个条目调用的回调（key、value、user_data）。
+ * @param user_data 传递给回调的用户数据。
+ * @return 遍历的键值对数量；参数错误或未开启索引返回 -1。
+ */
+long mk_range(const mk_t* kv, const char* start, const char* end,
+              void (*callback)(const char* key, const char* value, void* user_data), void* user_data);
+
+/**
+ * 按 key 顺序遍历以 prefix 开头的键值对，耗时 O(log n + k)。
+ * @param kv 已开启有序索引的实例。
+ * @param prefix key 前缀，空字符串表示全部。
+ * @param callback 对每个条目调用的回调（key、value、user_data）。
+ * @param user_data 传递给回调的用户数据。
+ * @return 遍历的键值对数量；参数错误或未开启索引返回 -1。
+ */
+long mk_prefix(const mk_t* kv, const char* prefix,
+               void (*callback)(const char* key, const char* value, void* user_data), void* user_data);
+
+/**
+ * 追加写日志的 fsync 策略。
+ */
+typedef enum {
+    MK_FSYNC_NEVER = 0,   // 从不主动 fsync，交给操作系统
+    MK_FSYNC_ALWAYS = 1,  // 每条记录写入后立即 fsync
+    MK_FSYNC_INTERVAL = 2 // 距上次 fsync 超过指定毫秒数时 fsync
+} mk_fsync_t;
+
+/**
+ * 为实例开启追加写日志模式。
+ * 之后每次 mk_set/mk_del 只向 "<filepath>.log" 追加一条记录，不再需要整体 mk_save。
+ * 应在 mk_load(kv, filepath) 之后调用。
+ * @param kv 实例。
+ * @param filepath 快照文件路径，日志文件为 filepath 加上 ".log" 后缀。
+ * @param policy fsync 策略。
+ * @param interval_ms policy 为 MK_FSYNC_INTERVAL 时两次 fsync 的最小间隔（毫秒）。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_log_open(mk_t* kv, const char* filepath, mk_fsync_t policy, unsigned interval_ms);
+
+/**
+ * 实例是否处于追加写日志模式。
+ * @param kv 实例。
+ * @return 是返回 1，否返回 0。
+ */
+int mk_log_is_open(const mk_t* kv);
+
+/**
+ * 立即把日志 fsync 到磁盘（MK_FSYNC_INTERVAL 下可由调用方定时调用）。
+ * @param kv 实例。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_log_sync(mk_t* kv);
+
+/**
+ * 压缩日志：把当前数据写成新快照（先写临时文件再原子替换），然后清空日志。
+ * @param kv 实例。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_log_compact(mk_t* kv);
+
+/**
+ * 关闭追加写日志模式（日志文件保留在磁盘上）。
+ * @param kv 实例。
+ */
+void mk_log_close(mk_t* kv);
+
+/**
+ * 内存上限下的淘汰策略。
+ */
+typedef enum {
+    MK_EVICT_LRU = 1, // 淘汰最久没有访问的 key
+    MK_EVICT_LFU = 2  // 淘汰访问频率最低的 key，计数随时间衰减
+} mk_evict_t;
+
+/**
+ * 设置内存上限，把实例当作缓存使用。
+ * 写入后占用超过上限时，在这次写操作中随机取样几个 key，淘汰按策略最该淘汰的一个，直到回到上限以内；
+ * 刚写入的 key 不会被淘汰，取样遇到已经过期的 key 优先淘汰。
+ * 淘汰是近似的，不保证淘汰的是全局最旧或最少访问的 key。
+ * 每个 key 的访问信息只占槽位中的 2 字节，读取时更新。
+ * 日志模式下每个被淘汰的 key 追加一条删除记录。
+ * 并发实例中每个分片各自限制在上限的 1/分片数。
+ * 调低上限时立即淘汰到新的上限以内。
+ * @param kv 实例。
+ * @param bytes 上限（字节），按 mk_memory_usage 的口径计算；0 表示不限制。
+ * @param policy 淘汰策略。
+ * @return 成功返回 0，参数错误返回 -1；日志追加失败返回 -3（内存中的淘汰已经完成）。
+ */
+int mk_set_maxmemory(mk_t* kv, size_t bytes, mk_evict_t policy);
+
+/**
+ * 节点（节点头、key、value 及块内预留空间）和槽位数组占用的字节数。
+ * 不含 slab 页中尚未分配的部分和索引、时间轮等附加结构。
+ * @param kv 实例。
+ * @return 字节数。
+ */
+size_t mk_memory_usage(const mk_t* kv);
+
+// 探测长度分布的档数：第 i 档统计探测长度为 i + 1 的 key，最后一档包含更长的
+#define MK_STATS_PROBE_BUCKETS 16
+
+/**
+ * 实例的运行统计，用于观察哈希表的负载和内存构成。
+ * 探测长度是 key 所在槽位到理想位置的距离加 1，查找命中时比较的槽位数，对应链式哈希表的链长。
+ */
+typedef struct {
+    size_t count;            // 键值对数量（含已过期但尚未回收的 key）
+    size_t buckets;          // 槽位数，迁移期间新旧两张表合计
+    double load_factor;      // 键值对数量 / 当前表的槽位数
+    size_t max_probe;        // 最大探测长度
+    double avg_probe;        // 平均探测长度
+    size_t probe_hist[MK_STATS_PROBE_BUCKETS]; // 探测长度分布
+    size_t key_bytes;        // key 的总长度
+    size_t value_bytes;      // value 的总长度
+    size_t header_bytes;     // 节点头的总大小
+    size_t node_bytes;       // 节点占用的块大小合计，超出 key、value、节点头的部分是结尾的 '\0' 和预留空间
+    size_t bucket_bytes;     // 槽位数组的大小
+    size_t memory;           // 与 mk_memory_usage 相同
+    uint64_t resizes;        // 扩容和缩容的次数
+    uint64_t resize_us;      // 扩容、缩容及其渐进迁移累计耗时（微秒）
+    uint64_t saves;          // 成功保存的次数（mk_save、mk_save_binary、压缩日志；后台保存在子进程中，不计入）
+    uint64_t save_bytes;     // 保存累计写入的字节数
+    uint64_t save_us;        // 保存累计耗时（微秒），含 fsync 和 rename
+    double last_save_mb_per_sec; // 最近一次保存的写入吞吐（MiB/s），没有保存过为 0
+} mk_stats_t;
+
+/**
+ * 收集实例的统计信息，需要遍历全部槽位，开销与槽位数成正比。
+ * 并发实例汇总各分片，逐个分片持读锁收集，不是全局同一时刻的数据。
+ * @param kv 实例。
+ * @param out 输出参数。
+ * @return 成功返回 0，参数错误返回 -1。
+ */
+int mk_stats(const mk_t* kv, mk_stats_t* out);
+
+/**
+ * 记录延迟的操作类型。
+ */
+typedef enum {
+    MK_OP_GET = 0,    // mk_get / mk_get_n
+    MK_OP_SET = 1,    // mk_set / mk_set_n / mk_set_ex / mk_mset 中的每个 key
+    MK_OP_DEL = 2,    // mk_del / mk_del_n / mk_mdel 中的每个 key
+    MK_OP_RESIZE = 3, // 扩容或缩容时分配新表（包括先完成上一轮迁移）
+    MK_OP_LOAD = 4,   // mk_load / mk_load_parallel
+    MK_OP_SAVE = 5,   // mk_save / mk_save_binary
+    MK_OP_COUNT = 6
+} mk_op_t;
+
+// 延迟直方图的档数：小于 8ns 每纳秒一档，之后每个 2 的幂区间分 8 档，相对误差不超过 1/8
+#define MK_LATENCY_BUCKETS 496
+
+/**
+ * 一种操作的延迟统计（纳秒）。
+ * 分位数取所在档的上界，最多偏大 1/8。
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t buckets[MK_LATENCY_BUCKETS]; // 第 i 档的计数，范围见 mk_latency_bucket
+} mk_latency_t;
+
+/**
+ * 开启或暂停延迟记录。
+ * 第一次开启时分配直方图（并发实例的各分片共用一份），之后暂停和恢复只切换开关，已记录的数据保留。
+ * 开启后每次操作读两次单调时钟并做几次原子加，未开启时只多一次判断。
+ * 以 -DMK_NO_LATENCY 编译（make LATENCY=0）时记录代码整体去掉，本函数返回 -1。
+ * @param kv 实例。
+ * @param on 非 0 开启，0 暂停。
+ * @return 成功返回 0，内存不足、编译时去掉或参数错误返回 -1。
+ */
+int mk_latency_enable(mk_t* kv, int on);
+
+/**
+ * 清空已记录的延迟。
+ * @param kv 实例。
+ */
+void mk_latency_reset(mk_t* kv);
+
+/**
+ * 读取一种操作的延迟直方图和分位数。并发写入期间读到的各档计数不是同一时刻的。
+ * @param kv 实例。
+ * @param op 操作类型。
+ * @param out 输出参数。
+ * @return 成功返回 0，从未开启过记录或参数错误返回 -1。
+ */
+int mk_latency(const mk_t* kv, mk_op_t op, mk_latency_t* out);
+
+/**
+ * 直方图第 idx 档覆盖的延迟范围 [low, high)（纳秒）。
+ * @return 档位有效返回 0，否则返回 -1。
+ */
+int mk_latency_bucket(int idx, uint64_t* low, uint64_t* high);
+
+/**
+ * 操作类型的名称（"get"、"set"、"del"、"resize"、"load"、"save"），无效时返回 NULL。
+ */
+const char* mk_op_name(mk_op_t op);
+
+/**
+ * 后台保存的状态。
+ */
+typedef struct {
+    int running;          // 子进程是否还在写
+    int last_result;      // 最近一次完成的结果：0 成功，-1 失败，1 还没有完成过
+    size_t keys_total;    // 发起时的键数
+    size_t keys_written;  // 子进程已处理的节点数（含跳过的已过期键）
+    uint64_t elapsed_ms;  // 正在写时为已用时间，否则为最近一次的总耗时
+} mk_bgsave_status_t;
+
+/**
+ * 在后台保存：fork 出子进程，子进程看到的是 fork 那一刻的数据（写时复制），
+ * 写入 "<filepath>.<pid>.<n>.tmp"，fsync 后 rename 成 filepath，父进程立即返回继续服务。
+ * 并发实例 fork 期间持有所有分片的读锁，只在 fork 本身的几毫秒内阻塞写操作。
+ * 子进程运行期间父进程每改写一页内存就复制一页，写入密集时内存最多翻倍。
+ * @param kv 实例。
+ * @param filepath 目标文件。
+ * @param binary 非 0 写二进制快照，否则写文本。
+ * @return 已开始返回 0，已有后台保存在进行返回 -2，其他错误返回 -1。
+ */
+int mk_bgsave(mk_t* kv, const char* filepath, int binary);
+
+/**
+ * 查询后台保存的状态，子进程已结束时顺便回收。
+ * @param kv 实例。
+ * @param out 输出参数。
+ * @return 成功返回 0，参数错误返回 -1。
+ */
+int mk_bgsave_status(mk_t* kv, mk_bgsave_status_t* out);
+
+/**
+ * 等待正在进行的后台保存结束。
+ * @param kv 实例。
+ * @return 最近一次后台保存的结果：0 成功，-1 失败，1 从未发起过。
+ */
+int mk_bgsave_wait(mk_t* kv);
+
 #endif // 头文件保护结束
@@ -0,0 +1,369 @@
+#ifndef MINIKV_INTERNAL_H
+#define MINIKV_INTERNAL_H
+
+#include "minikv.h"
+#include "slab.h"
+#include "aof.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/*
+ * 库内部共享的数据结构与函数，不属于公共 API。
+ */
+
+// 单个键值对节点
+// 节点头、key 和 value 放在同一个 slab 块里：data 中依次是 key、'\0'、value、'\0'
+typedef struct mk_node {
+    // key 的完整哈希值，迁移时直接复用，不再重新计算
+    uint64_t hash;
+    // key 的长度，比较时先比长度再比内容
+    uint32_t klen;
+    // value 的长度
+    uint32_t vlen;
+    // 块内可容纳的 value 最大长度（不含 '\0'），新值不超过它时原地覆盖
+    uint32_t vcap;
+    // 块所属的 slab 类别；MK_NODE_MAPPED 表示节点位于 mmap 的快照中
+    uint8_t cls;
+    // 节点标志，MK_NODE_EXPIRES 表示 value 之后带有过期时间
+    uint8_t flags;
+    char data[];
+} mk_node_t;
+
+// 位于 mmap 快照中的节点使用的类别编号，这类节点只读，也不归 slab 释放
+#define MK_NODE_MAPPED 254
+
+// 节点中 key 的起始位置
+#define NODE_KEY(node) ((node)->data)
+// 节点中 value 的起始位置
+#define NODE_VALUE(node) ((node)->data + (node)->klen + 1)
+
+// 节点带有过期时间：value 的容量之后紧跟 8 字节的过期时刻（毫秒级 Unix 时间），vcap 相应减少 8
+#define MK_NODE_EXPIRES 1
+// 节点中过期时刻的位置，不保证 8 字节对齐，读写用 memcpy
+#define NODE_EXPIRE(node) (NODE_VALUE(node) + (node)->vcap + 1)
+
+/**
+ * 节点的过期时刻（毫秒级 Unix 时间），没有设置过期时间返回 0。
+ */
+static inline uint64_t mk_node_expire(const mk_node_t* node) {
+    uint64_t expire = 0;
+    if (node->flags & MK_NODE_EXPIRES) memcpy(&expire, NODE_EXPIRE(node), sizeof(expire));
+    return expire;
+}
+
+/**
+ * 当前毫秒级 Unix 时间，过期时间以它为准，保存到文件后重启仍然有效。
+ */
+uint64_t mk_now_ms(void);
+
+/**
+ * 节点是否已经过期。过期但还没有回收的节点对读操作和遍历不可见。
+ * 只有带过期时间的节点才读取时钟。
+ */
+static inline int mk_node_expired(const mk_node_t* node) {
+    return (node->flags & MK_NODE_EXPIRES) && mk_node_expire(node) <= mk_now_ms();
+}
+
+// 开放寻址哈希表的槽位（Robin Hood 线性探测）
+// 所有槽位连续存放在一个数组里，探测时先比较槽内的哈希指纹，
+// 只有指纹相同时才去解引用节点比较完整哈希、长度和 key，减少缓存未命中
+typedef struct mk_slot {
+    // 哈希值低 32 位，作为指纹
+    uint32_t hash;
+    // 距离理想位置的探测距离 + 1，0 表示空槽
+    // 负载因子不超过 0.75，加上随机种子，探测距离远小于 16 位的上限
+    uint16_t dist;
+    // 淘汰用的访问信息，开启内存上限时维护：LRU 为最近访问的时钟，LFU 为对数计数和衰减时间
+    // 放在槽位而不是节点中，mmap 快照中的只读节点同样可以记录，随节点在槽位之间移动
+    uint16_t access;
+    // 指向键值对节点
+    mk_node_t* node;
+} mk_slot_t;
+
+// 一张开放寻址表
+typedef struct mk_table {
+    // 连续的槽位数组，NULL 表示该表未使用
+    mk_slot_t* slots;
+    // 槽位数量，始终为 2 的幂，便于用掩码代替取模
+    size_t capacity;
+} mk_table_t;
+
+// 分片中等待回收的对象
+typedef struct mk_retired {
+    // 对象指针
+    void* ptr;
+    // 退休时的全局 epoch
+    uint64_t epoch;
+    // 节点的 slab 类别；MK_RETIRED_ARRAY 表示 malloc 分配的槽位数组
+    int cls;
+} mk_retired_t;
+
+// 待回收对象是槽位数组时使用的类别编号
+#define MK_RETIRED_ARRAY (-1)
+
+// 并发实例中的一个分片：一个普通实例加一把读写锁
+// 写操作、遍历和保存持有读写锁；mk_get 不加锁，靠 seq 检测并发的结构修改
+// 按缓存行对齐，相邻分片的锁不会落在同一缓存行上互相干扰
+typedef struct mk_shard {
+    _Alignas(64) pthread_rwlock_t lock;
+    struct mk_t* kv;
+    // 结构修改（插入、删除、迁移、扩容）期间为奇数，读线程据此判断是否需要重试
+    unsigned long seq;
+    // 已经摘下、等待读线程离开后释放的节点和槽位数组，按 epoch 递增排列
+    mk_retired_t* retired;
+    size_t retired_count;
+    size_t retired_cap;
+} mk_shard_t;
+
+// 后台保存的状态，由自带的互斥锁保护
+// 这把锁只在发起和查询后台保存时使用，加锁后才会去锁分片，写操作不会反过来等它
+typedef struct mk_bgsave {
+    pthread_mutex_t lock;
+    // 正在写快照的子进程，0 表示没有
+    pid_t pid;
+    // 与子进程共享的匿名映射页：[0] 要写的节点数，[1] 已处理的节点数
+    uint64_t* shared;
+    // 开始和结束的时刻（毫秒），结束时刻只在子进程退出后有效
+    uint64_t started_ms;
+    uint64_t finished_ms;
+    // 最近一次完成的结果：0 成功，-1 失败，1 还没有完成过
+    int result;
+} mk_bgsave_t;
+
+// 简易哈希表
+// 扩容采用渐进式 rehash：触发扩容时只分配新表，旧表中的节点由之后的
+// 写操作分批迁移，迁移期间查找需要同时查新旧两张表
+struct mk_t {
+    // 节点内存分配器，所有节点都从这里分配
+    mk_slab_t slab;
+    // 当前表，新节点总是插入这里
+    mk_table_t table;
+    // 正在迁移的旧表，不在迁移时 slots 为 NULL
+    mk_table_t old;
+    // 旧表中下一个待迁移的槽位下标
+    size_t rehash_idx;
+    // 当前存储的键值对数量（新旧两张表合计）
+    size_t count;
+    // 追加写日志，未开启日志模式时为 NULL
+    mk_aof_t* aof;
+    // 日志对应的快照文件路径，压缩日志时写到这里
+    char* snapshot_path;
+    // 通过 mmap 加载的二进制快照，节点直接指向其中的记录
+    struct mk_mapping* mappings;
+    // 并发实例的分片数组，普通实例为 NULL
+    // 并发实例自身的表不存放数据，键值对按哈希高位分布到各分片
+    mk_shard_t* shards;
+    // 分片数量减 1（分片数量为 2 的幂）
+    size_t shard_mask;
+    // 并发实例中保护日志和映射列表；加锁顺序总是先分片后它
+    pthread_mutex_t meta_lock;
+    // 作为并发实例的分片时指向所属分片，节点不再原地修改，释放改为延迟回收
+    mk_shard_t* owner;
+    // 哈希种子，创建时随机生成
+    uint64_t seed;
+    // 有序索引，未开启时为 NULL；并发实例的分片与实例指向同一个索引
+    struct mk_index* index;
+    // 过期时间轮，第一次写入带过期时间的 key 时创建；并发实例中每个分片各有一个，由分片锁保护
+    struct mk_wheel* wheel;
+    // 节点和槽位数组占用的字节数
+    size_t memory;
+    // 内存上限，0 表示不限制；并发实例中每个分片各占总上限的一份
+    size_t maxmemory;
+    // 淘汰策略（mk_evict_t），只在 maxmemory 不为 0 时有效；无锁读线程会读取，原子访问
+    int evict;
+    // 扩容和缩容的次数，以及分配新表和渐进迁移累计耗时（纳秒），供 mk_stats 使用
+    uint64_t resizes;
+    uint64_t resize_ns;
+    // 延迟直方图，第一次开启记录前为 NULL；并发实例的分片与实例指向同一份
+    struct mk_latency_hist* latency;
+    // 成功保存的次数、写入字节数和耗时（含 fsync 和 rename），以及最近一次的字节数和耗时；并发保存时原子更新
+    uint64_t saves;
+    uint64_t save_bytes;
+    uint64_t save_ns;
+    uint64_t last_save_bytes;
+    uint64_t last_save_ns;
+    // 后台保存，只用在实例本身，分片中不使用
+    mk_bgsave_t bgsave;
+};
+
+// 当前哈希函数的版本号，写入二进制快照，版本不一致时加载需要重新计算哈希
+#define MK_HASH_VERSION 2
+
+/**
+ * 用实例的种子计算 key 的哈希值。
+ * @param kv 实例。
+ * @param str 以 '\0' 结尾的 key。
+ * @param len_out 输出参数，返回 key 的长度。
+ * @return 64 位哈希值。
+ */
+uint64_t mk_hash_key(const mk_t* kv, const char* str, size_t* len_out);
+
+/**
+ * 按长度计算哈希，结果与 mk_hash_key 相同。
+ * @param kv 实例。
+ * @param key key 起始位置，不要求以 '\0' 结尾。
+ * @param len key 长度。
+ * @return 64 位哈希值。
+ */
+uint64_t mk_hash_bytes(const mk_t* kv, const char* key, size_t len);
+
+/**
+ * 从指定的 slab 分配并初始化节点，key/value 按长度拷贝并补 '\0'。
+ * @param expire_at 过期时刻（毫秒级 Unix 时间），0 表示不过期。
+ * @return 成功返回节点指针，失败返回 NULL。
+ */
+mk_node_t* mk_node_new(mk_slab_t* slab, const char* key, size_t klen, uint64_t hash,
+                       const char* value, size_t vlen, uint64_t expire_at);
+
+/**
+ * 写入键值对（不校验 key、不写日志），key 已存在则覆盖，原有的过期时间被 expire_at 取代。
+ * @param expire_at 过期时刻（毫秒级 Unix 时间），0 表示不过期。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_set_entry(mk_t* kv, const char* key, size_t klen, uint64_t hash,
+                 const char* value, size_t vlen, uint64_t expire_at);
+
+/**
+ * 直接把现成的节点放入表中，key 已存在则替换并释放旧节点。
+ * 用于把 mmap 快照中的记录原样挂入哈希表。
+ * 并发实例中非映射节点必须来自 kv->slab，会被复制到所属分片的 slab。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_put_node(mk_t* kv, mk_node_t* node);
+
+/**
+ * 预留至少能容纳 n 个键值对的槽位，避免批量加载时反复扩容。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_reserve(mk_t* kv, size_t n);
+
+/**
+ * 遍历所有节点。并发实例中不加锁，调用方需要先持有所有分片的锁。
+ */
+void mk_foreach_node(const mk_t* kv, void (*callback)(const mk_node_t* node, void* user_data), void* user_data);
+
+/**
+ * 按顺序重放 "<filepath>.log"（不存在则什么也不做）。
+ * @return 成功返回 0，日志不存在返回 1，出错返回负数。
+ */
+int mk_replay_log(mk_t* kv, const char* filepath);
+
+/**
+ * 生成 "<filepath><suffix>" 形式的路径，调用方负责释放。
+ */
+char* mk_path_with_suffix(const char* filepath, const char* suffix);
+
+/**
+ * 保存用的临时文件路径 "<filepath>.<pid>.<n>.tmp"，调用方负责释放。
+ * 带上进程号和进程内递增的序号：后台保存的子进程、并发实例上同时进行的多个保存
+ * 即使目标路径相同也各写各的临时文件。
+ */
+char* mk_temp_path(const char* filepath);
+
+struct mk_writer;
+
+/**
+ * 累计一次成功保存写入的字节数和耗时，供 mk_stats 报告写入吞吐。
+ */
+void mk_note_save(mk_t* kv, const struct mk_writer* w);
+
+/**
+ * 锁住并发实例的所有分片（读锁），期间没有写操作；普通实例什么也不做。
+ */
+void mk_lock_all(const mk_t* kv);
+
+/**
+ * 释放 mk_lock_all 加的锁。
+ */
+void mk_unlock_all(const mk_t* kv);
+
+/**
+ * 按格式把全部键值对写入文件（先写临时文件、落盘再 rename），不加锁，调用方保证期间没有写操作。
+ * @param binary 非 0 写二进制快照，否则写文本。
+ * @param progress 非 NULL 时每处理一个节点原子加 1。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_save_unlocked(mk_t* kv, const char* filepath, int binary, uint64_t* progress);
+
+/**
+ * 分段保存：把几个实例的数据先后写进同一个文件（先写临时文件、落盘再 rename）。
+ * 服务器的 SAVE 让各工作线程依次写自己的分片，不需要先把数据汇总到一个实例；
+ * 各段可以在不同线程写，但同一时刻只能有一个线程在写。
+ */
+typedef struct mk_dump {
+    struct mk_writer* out;
+    char* filepath;
+    int binary;
+    // 二进制快照文件头记录的哈希种子，各段实例的种子必须与它相同，记录中的哈希值才能原样使用
+    uint64_t seed;
+    // 放不进一块写缓冲的超长行或超大记录在这里拼装
+    char* buf;
+    size_t cap;
+    // 二进制快照已写的记录数、记录区字节数和校验和
+    uint64_t count;
+    uint64_t data_size;
+    uint64_t checksum;
+    // 后台保存的进度计数，NULL 表示不报告
+    uint64_t* progress;
+} mk_dump_t;
+
+/**
+ * 创建临时文件开始分段保存。
+ * @param binary 非 0 写二进制快照，否则写文本。
+ * @param progress 非 NULL 时每处理一个节点原子加 1。
+ * @return 成功返回新的分段保存，失败返回 NULL。
+ */
+mk_dump_t* mk_dump_open(const char* filepath, int binary, uint64_t seed, uint64_t* progress);
+
+/**
+ * 追加一个实例的全部键值对，已经过期的不写；不加锁，调用方保证期间没有写操作。
+ * @return 成功返回 0，写入失败或二进制格式下实例的哈希种子不一致返回 -1，之后的追加都会失败。
+ */
+int mk_dump_add(mk_dump_t* d, const mk_t* kv);
+
+/**
+ * 回填文件头、落盘并 rename 成目标文件；出错时删除临时文件。无论成败都释放 d。
+ * @param kv 非 NULL 时把写入的字节数和耗时计入它的统计。
+ * @return 成功返回 0，失败（含 d 为 NULL）返回 1。
+ */
+int mk_dump_finish(mk_dump_t* d, mk_t* kv);
+
+/**
+ * 放弃分段保存：删除临时文件，目标文件保持原样，释放 d。d 为 NULL 时什么也不做。
+ */
+void mk_dump_abort(mk_dump_t* d);
+
+/**
+ * 等待后台保存的子进程结束并释放共享页，mk_destroy 调用。
+ */
+void mk_bgsave_cleanup(mk_t* kv);
+
+/**
+ * 以二进制快照格式保存（先写临时文件、落盘再 rename）。
+ * @param progress 非 NULL 时每处理一个节点原子加 1（含跳过的过期节点），用于报告后台保存的进度。
+ * @return 成功返回 0，失败返回非 0。
+ */
+int mk_snapshot_save(mk_t* kv, const char* filepath, uint64_t* progress);
+
+/**
+ * 分段保存的二进制部分：写占位文件头、把节点写成一条记录（mk_foreach_node 的回调）、回填文件头。
+ */
+void mk_snapshot_begin(mk_dump_t* d);
+void mk_snapshot_write_node(const mk_node_t* node, void* user_data);
+void mk_snapshot_end(mk_dump_t* d);
+
+/**
+ * mmap 二进制快照并把其中的记录挂入哈希表。
+ * @return 成功返回 0，文件无法打开返回 1，格式或校验和错误返回负数。
+ */
+int mk_snapshot_load(mk_t* kv, const char* filepath);
+
+/**
+ * 解除实例持有的所有快照映射。
+ */
+void mk_snapshot_release(mk_t* kv);
+
+#endif // MINIKV_INTERNAL_H
@@ -1,6 +1,9 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * 去掉字符串两边的空白字符
  * @param str 要处理的字符串（会被修改）
@@ -24,4 +27,71 @@ int is_valid_key(const char* key);
  */
 int parse_key_value_line(char* line, char** key_out, char** val_out);
 
+/**
+ * 验证长度为 len 的键名是否有效（不要求以 '\0' 结尾）
+ * @param key 要验证的键名
+ * @param len 键名长度
+ * @return 有效返回1，无效返回0
+ */
+int is_valid_key_n(const char* key, size_t len);
+
+/**
+ * 解析单行键值对，规则与 parse_key_value_line 相同，但不修改输入
+ * key 和 value 以指针+长度的切片形式返回，指向原始行内
+ * @param line 行首指针（不含换行符）
+ * @param len 行长度
+ * @param key_out 输出参数，key 起始位置
+ * @param klen_out 输出参数，key 长度
+ * @param val_out 输出参数，value 起始位置
+ * @param vlen_out 输出参数，value 长度
+ * @return 解析成功返回1，失败返回0
+ */
+int parse_key_value_slice(const char* line, size_t len, const char** key_out, size_t* klen_out,
+                          const char** val_out, size_t* vlen_out);
+
+/**
+ * 判断键值对能否写成普通的 key=value 行（重新解析后完全一致）
+ * key 需要满足 is_valid_key_n；value 不能含 '\0'、'\r'、'\n'，首尾不能是空白
+ * @return 可以返回1，否则返回0
+ */
+int is_plain_entry(const char* key, size_t klen, const char* value, size_t vlen);
+
+/**
+ * 把任意字节的键值对编码成转义行："!" + 编码后的 key + "=" + 编码后的 value（不含换行）
+ * key 中 [A-Za-z0-9_.-] 以外的字节、value 中的 '%'、控制字符和空格编码为 %XX
+ * @param out 输出缓冲区，至少 escaped_entry_size(klen, vlen) 字节
+ * @return 写入的字节数
+ */
+size_t escape_entry(const char* key, size_t klen, const char* value, size_t vlen, char* out);
+
+/**
+ * 转义行编码所需的最大字节数
+ */
+size_t escaped_entry_size(size_t klen, size_t vlen);
+
+/**
+ * 解析单行，同时支持普通行和以 '!' 开头的转义行
+ * 普通行的 key/value 指向原始行内；转义行解码到 *scratch 中，空间不足时自动扩大
+ * @param line 行首指针（不含换行符）
+ * @param len 行长度
+ * @param scratch 解码缓冲区，可以为 NULL，由调用方最终释放
+ * @param scratch_cap 解码缓冲区大小
+ * @param key_out 输出参数，key 起始位置
+ * @param klen_out 输出参数，key 长度
+ * @param val_out 输出参数，value 起始位置
+ * @param vlen_out 输出参数，value 长度
+ * @return 解析成功返回1，空行、注释或格式错误返回0，内存不足返回-1
+ */
+int parse_entry_slice(const char* line, size_t len, char** scratch, size_t* scratch_cap,
+                      const char** key_out, size_t* klen_out, const char** val_out, size_t* vlen_out);
+
+/**
+ * 解析带过期时间的行开头的 "@<过期时刻> " 前缀，过期时刻是毫秒级 Unix 时间
+ * @param line 行首指针（不含换行符）
+ * @param len 行长度
+ * @param expire_out 输出参数，有前缀时写入过期时刻，否则写入 0
+ * @return 前缀的字节数（包括后面的空格），没有合法的前缀返回 0
+ */
+size_t parse_expire_prefix(const char* line, size_t len, uint64_t* expire_out);
+
 #endif // PARSER_H
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef RESP_H
+#define RESP_H
+
+#include "minikv.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * RESP（Redis 序列化协议）的请求解析与应答编码，供网络服务使用。
+ * 请求支持多条批量字符串（*<n>\r\n$<len>\r\n...）和按空白分隔的内联命令；
+ * 解析结果以切片形式指向输入缓冲区，不复制参数。
+ */
+
+/**
+ * 单个请求的参数数量上限。
+ */
+#define RESP_MAX_ARGS 1024
+
+/**
+ * 单个批量字符串的长度上限（512MB）。
+ */
+#define RESP_MAX_BULK (512L * 1024 * 1024)
+
+/**
+ * 内联命令一行的长度上限，超过仍没有换行视为协议错误。
+ */
+#define RESP_MAX_INLINE (64 * 1024)
+
+/**
+ * 从缓冲区开头解析一个完整的请求。
+ * @param buf 输入缓冲区。
+ * @param len 缓冲区中的字节数。
+ * @param argv 输出参数，各参数的切片，指向 buf 内。
+ * @param argc 输出参数，参数个数；空的内联行返回 0 个参数。
+ * @param consumed 输出参数，这个请求占用的字节数。
+ * @return 解析出完整请求返回 1，数据还不完整返回 0，协议错误返回 -1。
+ */
+int resp_parse_command(const char* buf, size_t len, mk_view_t* argv, int* argc, size_t* consumed);
+
+/**
+ * 可增长的输出缓冲区，应答依次追加到末尾。
+ */
+typedef struct resp_buf {
+    char* data;
+    size_t len;
+    size_t cap;
+    // 追加时内存不足，之后的追加都被忽略，由调用方断开连接
+    int oom;
+} resp_buf_t;
+
+/**
+ * 释放缓冲区的内存并清空。
+ */
+void resp_buf_free(resp_buf_t* b);
+
+/**
+ * 追加原始字节。
+ */
+void resp_append_raw(resp_buf_t* b, const char* data, size_t len);
+
+/**
+ * 追加简单字符串应答：+<s>\r\n。
+ */
+void resp_append_simple(resp_buf_t* b, const char* s);
+
+/**
+ * 追加错误应答：-<msg>\r\n。
+ */
+void resp_append_error(resp_buf_t* b, const char* msg);
+
+/**
+ * 追加整数应答：:<n>\r\n。
+ */
+void resp_append_int(resp_buf_t* b, long long n);
+
+/**
+ * 追加批量字符串应答：$<len>\r\n<data>\r\n。
+ */
+void resp_append_bulk(resp_buf_t* b, const char* data, size_t len);
+
+/**
+ * 追加空批量字符串应答：$-1\r\n。
+ */
+void resp_append_nil(resp_buf_t* b);
+
+/**
+ * 追加数组头：*<n>\r\n，之后由调用方追加 n 个元素。
+ */
+void resp_append_array(resp_buf_t* b, size_t n);
+
+#endif // RESP_H
@@ -0,0 +1,82 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 大小类别数量上限。
+ */
+#define MK_SLAB_MAX_CLASSES 64
+
+/**
+ * 超过最大类别的块直接走 malloc，使用这个类别编号标记。
+ */
+#define MK_SLAB_LARGE 255
+
+/**
+ * 超大块前面链表头的字节数，统计内存时计入。
+ */
+#define MK_SLAB_LARGE_HEADER (2 * sizeof(void*))
+
+/**
+ * 按大小类别组织的 slab 分配器。
+ * 每个类别从整页（arena）中切分等长的块，释放的块挂回该类别的空闲链表；
+ * 页只在 mk_slab_destroy 时整体归还，销毁时无需逐个释放。
+ */
+typedef struct mk_slab {
+    // 各类别的块大小，递增
+    size_t class_size[MK_SLAB_MAX_CLASSES];
+    // 类别数量
+    int class_count;
+    // 各类别的空闲链表（空闲块的前 8 字节存放下一个空闲块指针）
+    void* free_list[MK_SLAB_MAX_CLASSES];
+    // 各类别当前页中尚未切分的区域
+    char* page_cursor[MK_SLAB_MAX_CLASSES];
+    char* page_end[MK_SLAB_MAX_CLASSES];
+    // 所有已分配页组成的单链表（页首存放下一页指针）
+    void* pages;
+    // 超大块组成的双向链表，销毁时统一释放
+    struct mk_slab_large* large;
+} mk_slab_t;
+
+/**
+ * 初始化分配器。
+ * @param slab 分配器。
+ */
+void mk_slab_init(mk_slab_t* slab);
+
+/**
+ * 释放分配器持有的所有页和超大块。
+ * @param slab 分配器。
+ */
+void mk_slab_destroy(mk_slab_t* slab);
+
+/**
+ * 分配至少 size 字节的块。
+ * @param slab 分配器。
+ * @param size 需要的字节数。
+ * @param cls_out 输出参数，返回块所属的类别（释放时需要）。
+ * @param usable_out 输出参数，返回块实际可用的字节数。
+ * @return 成功返回块指针，失败返回 NULL。
+ */
+void* mk_slab_alloc(mk_slab_t* slab, size_t size, uint8_t* cls_out, size_t* usable_out);
+
+/**
+ * 释放块，块会挂回所属类别的空闲链表。
+ * @param slab 分配器。
+ * @param ptr 块指针。
+ * @param cls 分配时返回的类别。
+ */
+void mk_slab_free(mk_slab_t* slab, void* ptr, uint8_t cls);
+
+/**
+ * 把 src 持有的所有页、超大块和空闲块转交给 dst，之后 src 为空。
+ * 两个分配器必须使用相同的类别划分（均由 mk_slab_init 初始化）。
+ * src 当前页中尚未切分的剩余部分不再使用。
+ * @param dst 接收方。
+ * @param src 被合并的分配器。
+ */
+void mk_slab_merge(mk_slab_t* dst, mk_slab_t* src);
+
+#endif // SLAB_H
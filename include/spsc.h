@@ -0,0 +1,53 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stddef.h>
+
+/**
+ * 单生产者单消费者的无锁环形队列，元素是指针。
+ * 只有一个线程 push、一个线程 pop 时不需要任何锁；
+ * 读写下标各占一条缓存行，双方各自缓存对方的下标，只有缓存的值显示满或空时才去读真实值。
+ */
+typedef struct mk_spsc {
+    // 消费者写：下一个要取出的位置；以及消费者缓存的 tail
+    _Alignas(64) size_t head;
+    size_t cached_tail;
+    // 生产者写：下一个要放入的位置；以及生产者缓存的 head
+    _Alignas(64) size_t tail;
+    size_t cached_head;
+    // 初始化后只读
+    _Alignas(64) void** items;
+    size_t mask;
+} mk_spsc_t;
+
+/**
+ * 初始化队列。
+ * @param capacity 容量，向上取整为 2 的幂。
+ * @return 成功返回 0，内存不足返回 -1。
+ */
+int mk_spsc_init(mk_spsc_t* q, size_t capacity);
+
+/**
+ * 释放队列的存储，不释放队列中剩余的元素。
+ */
+void mk_spsc_destroy(mk_spsc_t* q);
+
+/**
+ * 放入一个元素，只能由生产者线程调用。
+ * @return 成功返回 0，队列已满返回 -1。
+ */
+int mk_spsc_push(mk_spsc_t* q, void* item);
+
+/**
+ * 取出一个元素，只能由消费者线程调用。
+ * @return 取出的元素，队列为空返回 NULL。
+ */
+void* mk_spsc_pop(mk_spsc_t* q);
+
+/**
+ * 队列是否为空，可以由任意线程调用，结果只是某一时刻的近似值。
+ * @return 为空返回 1，否则返回 0。
+ */
+int mk_spsc_empty(const mk_spsc_t* q);
+
+#endif // SPSC_H
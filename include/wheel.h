@@ -0,0 +1,58 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include "minikv_internal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 分层时间轮，登记带过期时间的节点，按到期顺序交给调用方删除。
+ * 共 6 层，每层 64 个槽：第 0 层每槽 1 毫秒，第 i 层每槽 64^i 毫秒，覆盖约 2 年；
+ * 更远的过期时间先挂在最高层，转到时重新计算位置。
+ * 上层的槽在时间走到它的起点时整体下放（cascade）到下层，最终在第 0 层的槽里到期。
+ * 每层用一个 64 位掩码记录非空的槽，推进时直接跳到下一个有定时器的槽，
+ * 推进的开销只与到期和下放的定时器数量有关，与 key 总数和经过的时间长短无关。
+ * 按节点指针查找定时器的散列表用于 key 被覆盖或删除时 O(1) 摘下定时器。
+ * 不加锁，由所属实例（或分片）的写锁保护。
+ */
+typedef struct mk_wheel mk_wheel_t;
+
+/**
+ * 创建空时间轮。
+ * @param now 当前时间（毫秒）。
+ * @return 成功返回时间轮，失败返回 NULL。
+ */
+mk_wheel_t* mk_wheel_create(uint64_t now);
+
+/**
+ * 释放时间轮，不释放其中登记的节点。
+ */
+void mk_wheel_destroy(mk_wheel_t* wheel);
+
+/**
+ * 登记或更新节点的过期时间。
+ * 同一个 key 的节点被替换时 old 是旧节点，定时器改为指向 node；old 为 NULL 或未登记时新建定时器。
+ * @param expire 过期时间（毫秒），早于当前时间的在下一次推进时到期。
+ * @return 成功返回 0，内存不足返回 -1。
+ */
+int mk_wheel_set(mk_wheel_t* wheel, const mk_node_t* old, mk_node_t* node, uint64_t expire);
+
+/**
+ * 摘下节点的定时器，节点没有登记时什么也不做。
+ */
+void mk_wheel_remove(mk_wheel_t* wheel, const mk_node_t* node);
+
+/**
+ * 推进到 now，依次对到期的节点调用 expire（调用前定时器已经摘下），最多 max 个。
+ * 达到 max 时停在当前的槽，下次调用继续。
+ * @return 到期的节点数量。
+ */
+size_t mk_wheel_advance(mk_wheel_t* wheel, uint64_t now, size_t max,
+                        void (*expire)(mk_node_t* node, void* user_data), void* user_data);
+
+/**
+ * 登记的定时器数量。
+ */
+size_t mk_wheel_count(const mk_wheel_t* wheel);
+
+#endif // WHEEL_H
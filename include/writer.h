@@ -0,0 +1,68 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 每块缓冲区的大小，按页对齐分配
+#define MK_WRITER_BLOCK (256 * 1024)
+// 缓冲区块数，写满后用一次 writev 提交
+#define MK_WRITER_BLOCKS 4
+
+/**
+ * 保存文件用的写入器：内容先写进 "<path>.<pid>.<n>.tmp"，完成时 fsync、rename 替换目标文件，再 fsync 所在目录，
+ * 中途出错或崩溃时目标文件保持原样。
+ * 数据先拷进几块按页对齐的大缓冲区，全部写满后用一次 writev 提交；超过一块的数据不拷贝，直接跟在后面一起提交。
+ */
+typedef struct mk_writer {
+    int fd;
+    char* tmp_path;
+    char* blocks[MK_WRITER_BLOCKS];
+    // 各块已用的字节数，当前块之前的块不一定写满（reserve 放不下时换下一块）
+    size_t used[MK_WRITER_BLOCKS];
+    int cur;
+    // 已提交给内核的字节数
+    uint64_t bytes;
+    // 从打开到完成（含 fsync 和 rename）的耗时，finish 之后有效
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    int error;
+} mk_writer_t;
+
+/**
+ * 为目标文件创建临时文件并分配缓冲区。
+ * @return 成功返回 0，失败返回 -1（不需要再调用 mk_writer_finish）。
+ */
+int mk_writer_open(mk_writer_t* w, const char* filepath);
+
+/**
+ * 在当前块中预留 n 字节连续空间，调用方直接在其中编码，再用 mk_writer_advance 确认实际写入的长度。
+ * @return 预留的空间；n 超过一块或已经出错时返回 NULL，改用 mk_writer_put。
+ */
+char* mk_writer_reserve(mk_writer_t* w, size_t n);
+
+/**
+ * 确认在 mk_writer_reserve 返回的空间中写入了 n 字节。
+ */
+void mk_writer_advance(mk_writer_t* w, size_t n);
+
+/**
+ * 追加 n 字节，返回前不再引用 data。
+ * @return 成功返回 0，写入失败返回 -1。
+ */
+int mk_writer_put(mk_writer_t* w, const void* data, size_t n);
+
+/**
+ * 提交缓冲区后在文件偏移 off 处覆盖写入 n 字节，用于回填文件头。
+ * @return 成功返回 0，失败返回 -1。
+ */
+int mk_writer_pwrite(mk_writer_t* w, const void* data, size_t n, uint64_t off);
+
+/**
+ * 提交剩余数据，fsync 后 rename 成目标文件并 fsync 所在目录；出错时删除临时文件。
+ * 无论成败都释放缓冲区和临时路径。
+ * @return 成功返回 0，失败返回 1。
+ */
+int mk_writer_finish(mk_writer_t* w, const char* filepath);
+
+#endif // 头文件保护结束
@@ -0,0 +1,223 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minikv.h"
+#include "aof.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// 日志句柄
+struct mk_aof {
+    // 以 O_APPEND 打开的文件描述符
+    int fd;
+    // fsync 策略
+    int policy;
+    // MK_FSYNC_INTERVAL 下两次 fsync 的最小间隔
+    unsigned interval_ms;
+    // 上一次 fsync 的时间
+    long long last_sync_ms;
+    // 自上次 fsync 后是否有新写入
+    int dirty;
+};
+
+// 单调时钟毫秒数
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 打开日志文件
+mk_aof_t* mk_aof_open(const char* path, int policy, unsigned interval_ms) {
+    mk_aof_t* aof = (mk_aof_t*)malloc(sizeof(mk_aof_t));
+    if (!aof) return NULL;
+    // O_APPEND 保证每次 write 都追加在文件末尾
+    aof->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (aof->fd < 0) {
+        free(aof);
+        return NULL;
+    }
+    aof->policy = policy;
+    aof->interval_ms = interval_ms;
+    aof->last_sync_ms = now_ms();
+    aof->dirty = 0;
+    return aof;
+}
+
+// 完整写入 len 字节，处理被信号打断或部分写入的情况
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 立即 fsync
+int mk_aof_sync(mk_aof_t* aof) {
+    if (!aof) return -1;
+    if (!aof->dirty) return 0;
+    if (fsync(aof->fd) != 0) return -1;
+    aof->dirty = 0;
+    aof->last_sync_ms = now_ms();
+    return 0;
+}
+
+// 写入一条完整记录后按策略 fsync
+static int append_record(mk_aof_t* aof, const char* header, size_t hlen, const char* key, size_t klen, const char* value, size_t vlen) {
+    // 记录较小时拼成一次 write，避免一条记录被拆成多次系统调用
+    size_t total = hlen + klen + vlen + 1;
+    char stack_buf[512];
+    char* buf = total <= sizeof(stack_buf) ? stack_buf : (char*)malloc(total);
+    if (!buf) return -1;
+    memcpy(buf, header, hlen);
+    memcpy(buf + hlen, key, klen);
+    if (vlen) memcpy(buf + hlen + klen, value, vlen);
+    buf[total - 1] = '\n';
+    int ret = write_all(aof->fd, buf, total);
+    if (buf != stack_buf) free(buf);
+    if (ret != 0) return -1;
+    aof->dirty = 1;
+    // 按策略决定是否立即落盘
+    if (aof->policy == MK_FSYNC_ALWAYS) return mk_aof_sync(aof);
+    if (aof->policy == MK_FSYNC_INTERVAL && now_ms() - aof->last_sync_ms >= (long long)aof->interval_ms) {
+        return mk_aof_sync(aof);
+    }
+    return 0;
+}
+
+// 追加 set 记录
+int mk_aof_append_set(mk_aof_t* aof, const char* key, size_t klen, const char* value, size_t vlen) {
+    if (!aof) return -1;
+    char header[64];
+    int hlen = snprintf(header, sizeof(header), "S %zu %zu\n", klen, vlen);
+    return append_record(aof, header, (size_t)hlen, key, klen, value, vlen);
+}
+
+// 追加带过期时间的 set 记录
+int mk_aof_append_set_ex(mk_aof_t* aof, const char* key, size_t klen, const char* value, size_t vlen,
+                         uint64_t expire_at) {
+    if (!aof) return -1;
+    char header[96];
+    int hlen = snprintf(header, sizeof(header), "X %zu %zu %llu\n", klen, vlen, (unsigned long long)expire_at);
+    return append_record(aof, header, (size_t)hlen, key, klen, value, vlen);
+}
+
+// 追加 del 记录
+int mk_aof_append_del(mk_aof_t* aof, const char* key, size_t klen) {
+    if (!aof) return -1;
+    char header[64];
+    int hlen = snprintf(header, sizeof(header), "D %zu\n", klen);
+    return append_record(aof, header, (size_t)hlen, key, klen, NULL, 0);
+}
+
+// 清空日志
+int mk_aof_truncate(mk_aof_t* aof) {
+    if (!aof) return -1;
+    if (ftruncate(aof->fd, 0) != 0) return -1;
+    aof->dirty = 1;
+    return mk_aof_sync(aof);
+}
+
+// 关闭日志
+void mk_aof_close(mk_aof_t* aof) {
+    if (!aof) return;
+    if (aof->policy != MK_FSYNC_NEVER) mk_aof_sync(aof);
+    close(aof->fd);
+    free(aof);
+}
+
+// 读取恰好 len 字节并补上 '\0'，读不全或内存不足返回 NULL
+static char* read_exact(FILE* fp, size_t len) {
+    char* buf = (char*)malloc(len + 1);
+    if (!buf) return NULL;
+    if (fread(buf, 1, len, fp) != len) {
+        free(buf);
+        return NULL;
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+// 重放的结果：末尾有写了一半的记录时截掉，中间损坏时报错且不改动文件
+#define REPLAY_OK 0
+#define REPLAY_TORN 1
+#define REPLAY_CORRUPT (-3)
+#define REPLAY_NOMEM (-1)
+
+// 按顺序重放日志
+int mk_aof_replay(const char* path, mk_aof_set_fn on_set, mk_aof_del_fn on_del, void* ctx) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return 1; // 日志不存在
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0) {
+        fclose(fp);
+        return -1;
+    }
+    char header[96];
+    // 最后一条完整记录的结束位置
+    long good_end = 0;
+    int status = REPLAY_OK;
+    while (status == REPLAY_OK && fgets(header, sizeof(header), fp)) {
+        size_t klen = 0, vlen = 0;
+        unsigned long long expire_at = 0;
+        char tag = 0;
+        // 没有换行的记录头：到了文件末尾是写了一半，否则是超长的垃圾
+        if (!strchr(header, '\n')) {
+            status = feof(fp) ? REPLAY_TORN : REPLAY_CORRUPT;
+            break;
+        }
+        if (header[0] == 'S' && sscanf(header, "S %zu %zu", &klen, &vlen) == 2) {
+            tag = 'S';
+        } else if (header[0] == 'X' && sscanf(header, "X %zu %zu %llu", &klen, &vlen, &expire_at) == 3) {
+            // 带过期时间的 set，之后与普通 set 相同
+            tag = 'S';
+        } else if (header[0] == 'D' && sscanf(header, "D %zu", &klen) == 1) {
+            tag = 'D';
+        } else {
+            status = REPLAY_CORRUPT;
+            break;
+        }
+        // 节点中的长度是 32 位的，更长的不可能是本库写出的记录
+        if (klen > UINT32_MAX || vlen > UINT32_MAX) {
+            status = REPLAY_CORRUPT;
+            break;
+        }
+        // 记录超出文件剩余的字节数：只可能是最后一条写了一半，不分配缓冲区
+        long pos = ftell(fp);
+        uint64_t left = pos >= 0 && (uint64_t)pos <= (uint64_t)st.st_size ? (uint64_t)st.st_size - (uint64_t)pos : 0;
+        if ((uint64_t)klen + (tag == 'S' ? (uint64_t)vlen : 0) + 1 > left) {
+            status = REPLAY_TORN;
+            break;
+        }
+        // 按长度读取 key、value 和结尾的换行；长度已经核对过，读不全只可能是内存不足
+        char* key = read_exact(fp, klen);
+        char* value = (key && tag == 'S') ? read_exact(fp, vlen) : NULL;
+        if (!key || (tag == 'S' && !value)) {
+            status = REPLAY_NOMEM;
+        } else if (fgetc(fp) != '\n') {
+            status = REPLAY_CORRUPT;
+        } else {
+            if (tag == 'S') on_set(ctx, key, klen, value, vlen, (uint64_t)expire_at);
+            else on_del(ctx, key, klen);
+            good_end = ftell(fp);
+        }
+        free(key);
+        free(value);
+    }
+    fclose(fp);
+    if (status != REPLAY_TORN) return status;
+    // 截掉末尾不完整的记录，否则之后追加的记录会跟在垃圾数据后面无法重放
+    if (truncate(path, good_end) != 0) return -2;
+    return 0;
+}
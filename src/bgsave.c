@@ -0,0 +1,110 @@
+#define _DEFAULT_SOURCE
+#include "minikv.h"
+#include "minikv_internal.h"
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/*
+ * 后台保存：
+ *   1. 锁住所有分片，fork 出子进程后立即解锁，子进程里的内存是 fork 那一刻的副本；
+ *   2. 子进程照常写临时文件、fsync、rename，每处理一个节点在共享页上加 1，结束时以退出码报告结果；
+ *   3. 父进程在查询或等待时用 waitpid 回收子进程。
+ * 共享页在下一次后台保存或销毁实例时才释放，完成之后仍能查到最后一次的进度。
+ */
+
+// 单调时钟的毫秒数
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+// 回收已结束的子进程，block 非 0 时一直等到结束，调用方持有 bg->lock
+// 进程忽略了 SIGCHLD 时 waitpid 拿不到退出码，按失败处理
+static void reap(mk_bgsave_t* bg, int block) {
+    if (!bg->pid) return;
+    int status = 0;
+    pid_t r;
+    do {
+        r = waitpid(bg->pid, &status, block ? 0 : WNOHANG);
+    } while (r < 0 && errno == EINTR);
+    if (r == 0) return;
+    bg->result = (r == bg->pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+    bg->finished_ms = monotonic_ms();
+    bg->pid = 0;
+}
+
+int mk_bgsave(mk_t* kv, const char* filepath, int binary) {
+    if (!kv || !filepath) return -1;
+    mk_bgsave_t* bg = &kv->bgsave;
+    pthread_mutex_lock(&bg->lock);
+    reap(bg, 0);
+    if (bg->pid) {
+        pthread_mutex_unlock(&bg->lock);
+        return -2;
+    }
+    uint64_t* shared = (uint64_t*)mmap(NULL, 2 * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        pthread_mutex_unlock(&bg->lock);
+        return -1;
+    }
+    // 持锁期间没有写操作，子进程拿到的是某一时刻的完整数据
+    mk_lock_all(kv);
+    shared[0] = mk_count(kv);
+    shared[1] = 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        // 子进程只有这一个线程，继承来的读锁没有人争用；用 _exit 跳过父进程注册的清理函数
+        int ret = mk_save_unlocked(kv, filepath, binary, &shared[1]);
+        _exit(ret ? 1 : 0);
+    }
+    mk_unlock_all(kv);
+    if (pid < 0) {
+        munmap(shared, 2 * sizeof(uint64_t));
+        pthread_mutex_unlock(&bg->lock);
+        return -1;
+    }
+    if (bg->shared) munmap(bg->shared, 2 * sizeof(uint64_t));
+    bg->shared = shared;
+    bg->pid = pid;
+    bg->started_ms = monotonic_ms();
+    pthread_mutex_unlock(&bg->lock);
+    return 0;
+}
+
+int mk_bgsave_status(mk_t* kv, mk_bgsave_status_t* out) {
+    if (!kv || !out) return -1;
+    mk_bgsave_t* bg = &kv->bgsave;
+    pthread_mutex_lock(&bg->lock);
+    reap(bg, 0);
+    out->running = bg->pid != 0;
+    out->last_result = bg->result;
+    out->keys_total = bg->shared ? (size_t)bg->shared[0] : 0;
+    out->keys_written = bg->shared ? (size_t)__atomic_load_n(&bg->shared[1], __ATOMIC_RELAXED) : 0;
+    if (!bg->shared) out->elapsed_ms = 0;
+    else out->elapsed_ms = (bg->pid ? monotonic_ms() : bg->finished_ms) - bg->started_ms;
+    pthread_mutex_unlock(&bg->lock);
+    return 0;
+}
+
+// 轮询等待，不在持锁时阻塞，其他线程照样可以查询状态
+int mk_bgsave_wait(mk_t* kv) {
+    if (!kv) return -1;
+    mk_bgsave_status_t st;
+    const struct timespec pause = { 0, 1000000 };
+    while (mk_bgsave_status(kv, &st) == 0 && st.running) nanosleep(&pause, NULL);
+    return st.last_result;
+}
+
+void mk_bgsave_cleanup(mk_t* kv) {
+    mk_bgsave_t* bg = &kv->bgsave;
+    pthread_mutex_lock(&bg->lock);
+    reap(bg, 1);
+    if (bg->shared) munmap(bg->shared, 2 * sizeof(uint64_t));
+    bg->shared = NULL;
+    pthread_mutex_unlock(&bg->lock);
+}
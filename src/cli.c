@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 
 // 打印单个键值对的回调函数
 void print_item(const char* key, const char* value, void* user_data) {
@@ -11,25 +12,155 @@ void print_item(const char* key, const char* value, void* user_data) {
     printf("%s=%s\n", key, value);
 }
 
-// 键值对结构体，用于排序输出
-typedef struct {
-    char* key;
-    char* value;
-} kv_pair;
+// 按 key 顺序输出全部键值对，指定前缀时只输出该前缀下的 key
+// 实例已开启有序索引，直接按索引顺序流式输出，不需要复制和排序；遍历失败返回 1
+static int list_items(mk_t* kv, const char* prefix) {
+    long n = prefix ? mk_prefix(kv, prefix, print_item, NULL) : mk_range(kv, NULL, NULL, print_item, NULL);
+    if (n < 0) {
+        fprintf(stderr, "Error: Failed to list keys\n");
+        return 1;
+    }
+    return 0;
+}
+
+// 输出实例的统计信息，每行一项 name:value，探测长度分布只列出非零的档
+static void print_info(mk_t* kv) {
+    mk_stats_t st;
+    if (mk_stats(kv, &st) != 0) return;
+    printf("keys:%zu\n", st.count);
+    printf("buckets:%zu\n", st.buckets);
+    printf("load_factor:%.3f\n", st.load_factor);
+    printf("max_probe:%zu\n", st.max_probe);
+    printf("avg_probe:%.3f\n", st.avg_probe);
+    printf("probe_hist:");
+    const char* sep = "";
+    for (int i = 0; i < MK_STATS_PROBE_BUCKETS; i++) {
+        if (!st.probe_hist[i]) continue;
+        printf("%s%d%s=%zu", sep, i + 1, i == MK_STATS_PROBE_BUCKETS - 1 ? "+" : "", st.probe_hist[i]);
+        sep = ",";
+    }
+    printf("\n");
+    printf("key_bytes:%zu\n", st.key_bytes);
+    printf("value_bytes:%zu\n", st.value_bytes);
+    printf("header_bytes:%zu\n", st.header_bytes);
+    printf("node_bytes:%zu\n", st.node_bytes);
+    printf("bucket_bytes:%zu\n", st.bucket_bytes);
+    printf("used_memory:%zu\n", st.memory);
+    printf("resizes:%llu\n", (unsigned long long)st.resizes);
+    printf("resize_time_us:%llu\n", (unsigned long long)st.resize_us);
+    printf("saves:%llu\n", (unsigned long long)st.saves);
+    printf("save_bytes:%llu\n", (unsigned long long)st.save_bytes);
+    printf("save_time_us:%llu\n", (unsigned long long)st.save_us);
+    printf("last_save_mb_per_sec:%.1f\n", st.last_save_mb_per_sec);
+}
+
+// 保存成功后输出文件名和这次的写入吞吐
+static void print_saved(mk_t* kv, const char* filepath) {
+    mk_stats_t st;
+    if (mk_stats(kv, &st) != 0) return;
+    printf("Saved %s (%.1f MB/s)\n", filepath, st.last_save_mb_per_sec);
+}
 
-// 比较两个键值对的 key，用于 qsort 排序
-int compare_kv(const void* a, const void* b) {
-    return strcmp(((kv_pair*)a)->key, ((kv_pair*)b)->key);
+// 输出各操作的延迟：每种操作一行汇总，其后每个非空档一行 "[下界, 上界) ns 次数"
+// 编译时去掉了延迟记录时返回 1
+static int print_latency(mk_t* kv) {
+    mk_latency_t lat;
+    for (int op = 0; op < MK_OP_COUNT; op++) {
+        if (mk_latency(kv, (mk_op_t)op, &lat) != 0) {
+            fprintf(stderr, "Error: latency recording is not available\n");
+            return 1;
+        }
+        if (lat.count == 0) continue;
+        printf("%s: count=%llu avg=%lluns p50=%lluns p90=%lluns p99=%lluns p999=%lluns max=%lluns\n",
+               mk_op_name((mk_op_t)op), (unsigned long long)lat.count,
+               (unsigned long long)(lat.total_ns / lat.count), (unsigned long long)lat.p50_ns,
+               (unsigned long long)lat.p90_ns, (unsigned long long)lat.p99_ns,
+               (unsigned long long)lat.p999_ns, (unsigned long long)lat.max_ns);
+        for (int i = 0; i < MK_LATENCY_BUCKETS; i++) {
+            if (!lat.buckets[i]) continue;
+            uint64_t low, high;
+            mk_latency_bucket(i, &low, &high);
+            printf("  [%llu, %llu) ns %llu\n", (unsigned long long)low, (unsigned long long)high,
+                   (unsigned long long)lat.buckets[i]);
+        }
+    }
+    return 0;
 }
 
-// 遍历时收集键值对的回调函数
-void collect_items(const char* key, const char* value, void* user_data) {
-    struct { kv_pair* arr; int idx; } *ctx = user_data;
-    ctx->arr[ctx->idx].key = strdup(key);
-    ctx->arr[ctx->idx].value = strdup(value);
-    ctx->idx++;
+// 按数据文件现有的格式保存：二进制快照仍写二进制，其余写文本
+static int save_store(mk_t* kv, const char* filepath) {
+    return mk_file_is_binary(filepath) ? mk_save_binary(kv, filepath) : mk_save(kv, filepath);
 }
 
+// 把数据文件转换为指定格式（text 或 binary）
+static int convert_store(mk_t* kv, const char* format, const char* filepath) {
+    int ret;
+    if (format && strcmp(format, "binary") == 0) {
+        ret = mk_save_binary(kv, filepath);
+    } else if (format && strcmp(format, "text") == 0) {
+        ret = mk_save(kv, filepath);
+    } else {
+        fprintf(stderr, "Error: convert requires text|binary\n");
+        return 1;
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Error: Failed to save file\n");
+        return 1;
+    }
+    return 0;
+}
+
+// 如果数据文件旁边已有 "<file>.log"，说明该文件处于日志模式，打开日志继续追加
+// 日志存在却打不开时返回非 0：否则之后的 set/del 会整体重写数据文件，而日志中已有的记录不再被重放
+static int open_log_if_present(mk_t* kv, const char* filepath, mk_fsync_t policy) {
+    char log_path[4096];
+    snprintf(log_path, sizeof(log_path), "%s.log", filepath);
+    if (access(log_path, F_OK) != 0) return 0;
+    return mk_log_open(kv, filepath, policy, 0);
+}
+
+// 处理 log on/off 和 compact 命令，返回 0 表示成功
+static int handle_log_command(mk_t* kv, const char* cmd, const char* arg, const char* filepath) {
+    // 折叠日志到快照
+    if (strcmp(cmd, "compact") == 0) {
+        if (!mk_log_is_open(kv)) {
+            fprintf(stderr, "Error: log mode is not enabled for %s\n", filepath);
+            return 1;
+        }
+        if (mk_log_compact(kv) != 0) {
+            fprintf(stderr, "Error: Failed to compact log\n");
+            return 1;
+        }
+        return 0;
+    }
+    // 开启日志模式：创建空日志，之后的 set/del 只追加记录
+    if (arg && strcmp(arg, "on") == 0) {
+        if (mk_log_is_open(kv)) return 0;
+        if (mk_log_open(kv, filepath, MK_FSYNC_ALWAYS, 0) != 0) {
+            fprintf(stderr, "Error: Failed to open log\n");
+            return 1;
+        }
+        return 0;
+    }
+    // 关闭日志模式：先折叠日志到快照，再删除日志文件
+    if (arg && strcmp(arg, "off") == 0) {
+        if (!mk_log_is_open(kv)) return 0;
+        if (mk_log_compact(kv) != 0) {
+            fprintf(stderr, "Error: Failed to compact log\n");
+            return 1;
+        }
+        mk_log_close(kv);
+        char log_path[4096];
+        snprintf(log_path, sizeof(log_path), "%s.log", filepath);
+        unlink(log_path);
+        return 0;
+    }
+    fprintf(stderr, "Error: log requires on|off\n");
+    return 1;
+}
+
+static int run_batch(mk_t* kv, const char* filepath, const char* script, const char* checkpoint);
+
 // 通用命令处理入口
 int process_command(int argc, char* argv[]) {
     // 检查参数数量是否足够
@@ -39,7 +170,13 @@ int process_command(int argc, char* argv[]) {
         fprintf(stderr, "  get <key>\n");
         fprintf(stderr, "  set <key> <value>\n");
         fprintf(stderr, "  del <key>\n");
-        fprintf(stderr, "  list\n");
+        fprintf(stderr, "  list [prefix]\n");
+        fprintf(stderr, "  info\n");
+        fprintf(stderr, "  latency\n");
+        fprintf(stderr, "  log on|off\n");
+        fprintf(stderr, "  compact\n");
+        fprintf(stderr, "  convert text|binary\n");
+        fprintf(stderr, "  batch [script|-] [checkpoint]\n");
         return 1;
     }
 
@@ -53,9 +190,24 @@ int process_command(int argc, char* argv[]) {
         fprintf(stderr, "Error: Failed to create kv instance\n");
         return 1;
     }
+    // 记录各操作的延迟，供 latency 命令输出
+    mk_latency_enable(kv, 1);
 
-    // 尝试加载文件
-    mk_load(kv, filepath);
+    // 加载文件（含日志重放）；文件不存在时从空实例开始
+    // 文件损坏或不是本程序写出的快照时直接退出，否则之后的 set/del 会用只含新 key 的数据覆盖原文件
+    int loaded = mk_load(kv, filepath);
+    if (loaded != 0 && loaded != 1) {
+        fprintf(stderr, "Error: Failed to load file %s\n", filepath);
+        mk_destroy(kv);
+        return 1;
+    }
+    // 日志模式下 set/del 只追加记录，不再整体重写文件
+    // batch 自己决定何时落盘，日志不必每条记录都 fsync
+    if (open_log_if_present(kv, filepath, strcmp(command, "batch") == 0 ? MK_FSYNC_NEVER : MK_FSYNC_ALWAYS) != 0) {
+        fprintf(stderr, "Error: Failed to open log %s.log\n", filepath);
+        mk_destroy(kv);
+        return 1;
+    }
 
     int ret = 0;
 
@@ -87,9 +239,9 @@ int process_command(int argc, char* argv[]) {
             if (mk_set(kv, argv[3], argv[4]) != 0) {
                 fprintf(stderr, "Error: Failed to set value (invalid key?)\n");
                 ret = 1;
-            } else {
+            } else if (!mk_log_is_open(kv)) {
                 // 检查保存文件是否成功
-                if (mk_save(kv, filepath) != 0) {
+                if (save_store(kv, filepath) != 0) {
                     fprintf(stderr, "Error: Failed to save file\n");
                     ret = 1;
                 }
@@ -103,9 +255,12 @@ int process_command(int argc, char* argv[]) {
             fprintf(stderr, "Usage: %s <file> del <key>\n", argv[0]);
             ret = 1;
         } else {
-            mk_del(kv, argv[3]);
-            // 检查保存文件是否成功
-            if (mk_save(kv, filepath) != 0) {
+            // 检查删除是否成功（日志模式下可能追加失败）
+            if (mk_del(kv, argv[3]) != 0) {
+                fprintf(stderr, "Error: Failed to delete key\n");
+                ret = 1;
+            } else if (!mk_log_is_open(kv) && save_store(kv, filepath) != 0) {
+                // 检查保存文件是否成功
                 fprintf(stderr, "Error: Failed to save file\n");
                 ret = 1;
             }
@@ -113,26 +268,34 @@ int process_command(int argc, char* argv[]) {
     } 
     // 处理 list 命令
     else if (strcmp(command, "list") == 0) {
-        size_t count = mk_count(kv);
-        // 检查是否有键值对需要显示
-        if (count > 0) {
-            struct { kv_pair* arr; int idx; } ctx;
-            ctx.arr = malloc(sizeof(kv_pair) * count);
-            ctx.idx = 0;
-            // 检查内存分配是否成功
-            if (ctx.arr) {
-                mk_foreach(kv, collect_items, &ctx);
-                qsort(ctx.arr, count, sizeof(kv_pair), compare_kv);
-                // 遍历并输出所有键值对
-                for (size_t i = 0; i < count; i++) {
-                    printf("%s=%s\n", ctx.arr[i].key, ctx.arr[i].value);
-                    free(ctx.arr[i].key);
-                    free(ctx.arr[i].value);
-                }
-                free(ctx.arr);
-            }
+        // list 需要有序输出，加载完后一次性建立有序索引
+        if (mk_index_enable(kv) != 0) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            ret = 1;
+        } else {
+            ret = list_items(kv, argc > 3 ? argv[3] : NULL);
         }
     } 
+    // 处理 info 命令
+    else if (strcmp(command, "info") == 0) {
+        print_info(kv);
+    }
+    // 处理 latency 命令：单次执行只有加载的耗时，批处理和交互模式中可以看到各操作的分布
+    else if (strcmp(command, "latency") == 0) {
+        ret = print_latency(kv);
+    }
+    // 处理 log / compact 命令
+    else if (strcmp(command, "log") == 0 || strcmp(command, "compact") == 0) {
+        ret = handle_log_command(kv, command, argc > 3 ? argv[3] : NULL, filepath);
+    }
+    // 处理 convert 命令
+    else if (strcmp(command, "convert") == 0) {
+        ret = convert_store(kv, argc > 3 ? argv[3] : NULL, filepath);
+    }
+    // 处理 batch 命令
+    else if (strcmp(command, "batch") == 0) {
+        ret = run_batch(kv, filepath, argc > 3 ? argv[3] : "-", argc > 4 ? argv[4] : NULL);
+    }
     // 处理未知命令
     else {
         fprintf(stderr, "Unknown command: %s\n", command);
@@ -210,10 +373,10 @@ int perform_kv_action(mk_t* kv, const char* cmd, char** args, int args_count, co
             fprintf(stderr, "Error: Failed to set value\n");
             return 1;
         }
-        // 如果指定了文件，则立即保存
-        if (filepath) {
+        // 如果指定了文件且不在日志模式，则立即保存
+        if (filepath && !mk_log_is_open(kv)) {
             // 检查保存是否成功
-            if (mk_save(kv, filepath) != 0) {
+            if (save_store(kv, filepath) != 0) {
                 fprintf(stderr, "Error: Failed to save file\n");
                 return 1;
             }
@@ -226,11 +389,15 @@ int perform_kv_action(mk_t* kv, const char* cmd, char** args, int args_count, co
             fprintf(stderr, "Error: del requires <key>\n");
             return 1;
         }
-        mk_del(kv, args[0]);
-        // 如果指定了文件，则立即保存
-        if (filepath) {
+        // 检查删除是否成功（日志模式下可能追加失败）
+        if (mk_del(kv, args[0]) != 0) {
+            fprintf(stderr, "Error: Failed to delete key\n");
+            return 1;
+        }
+        // 如果指定了文件且不在日志模式，则立即保存
+        if (filepath && !mk_log_is_open(kv)) {
             // 检查保存是否成功
-            if (mk_save(kv, filepath) != 0) {
+            if (save_store(kv, filepath) != 0) {
                 fprintf(stderr, "Error: Failed to save file\n");
                 return 1;
             }
@@ -238,26 +405,16 @@ int perform_kv_action(mk_t* kv, const char* cmd, char** args, int args_count, co
     } 
     // 处理 list 操作
     else if (strcmp(cmd, "list") == 0) {
-        size_t count = mk_count(kv);
-        // 检查是否有数据需要列出
-        if (count > 0) {
-            struct { kv_pair* arr; int idx; } ctx;
-            ctx.arr = malloc(sizeof(kv_pair) * count);
-            ctx.idx = 0;
-            // 检查内存分配是否成功
-            if (ctx.arr) {
-                mk_foreach(kv, collect_items, &ctx);
-                qsort(ctx.arr, count, sizeof(kv_pair), compare_kv);
-                // 遍历输出所有键值对
-                for (size_t i = 0; i < count; i++) {
-                    printf("%s=%s\n", ctx.arr[i].key, ctx.arr[i].value);
-                    free(ctx.arr[i].key);
-                    free(ctx.arr[i].value);
-                }
-                free(ctx.arr);
-            }
-        }
+        if (list_items(kv, args_count > 0 ? args[0] : NULL) != 0) return 1;
     } 
+    // 处理 info 操作
+    else if (strcmp(cmd, "info") == 0) {
+        print_info(kv);
+    }
+    // 处理 latency 操作
+    else if (strcmp(cmd, "latency") == 0) {
+        return print_latency(kv);
+    }
     // 处理 load 操作
     else if (strcmp(cmd, "load") == 0) {
         // 检查是否在 -f 模式下使用 load
@@ -294,7 +451,65 @@ int perform_kv_action(mk_t* kv, const char* cmd, char** args, int args_count, co
             fprintf(stderr, "Error: Failed to save to file %s\n", args[0]);
             return 1;
         }
-        printf("Saved %s\n", args[0]);
+        print_saved(kv, args[0]);
+    }
+    // 处理 log / compact 操作，只能配合 -f 使用
+    else if (strcmp(cmd, "log") == 0 || strcmp(cmd, "compact") == 0) {
+        if (!filepath) {
+            fprintf(stderr, "Error: %s requires -f <file>\n", cmd);
+            return 1;
+        }
+        return handle_log_command(kv, cmd, args_count > 0 ? args[0] : NULL, filepath);
+    }
+    // 处理 savebin 操作：以二进制快照格式保存
+    else if (strcmp(cmd, "savebin") == 0) {
+        // 检查是否在 -f 模式下使用 savebin
+        if (filepath) {
+            fprintf(stderr, "Error: savebin command cannot be used with -f\n");
+            return 1;
+        }
+        // 检查参数数量
+        if (args_count < 1) {
+            fprintf(stderr, "Error: savebin requires <file>\n");
+            return 1;
+        }
+        // 检查保存是否成功
+        if (mk_save_binary(kv, args[0]) != 0) {
+            fprintf(stderr, "Error: Failed to save to file %s\n", args[0]);
+            return 1;
+        }
+        print_saved(kv, args[0]);
+    }
+    // 处理 bgsave 操作：fork 子进程在后台保存，立即返回
+    else if (strcmp(cmd, "bgsave") == 0) {
+        if (filepath) {
+            fprintf(stderr, "Error: bgsave command cannot be used with -f\n");
+            return 1;
+        }
+        if (args_count < 1) {
+            fprintf(stderr, "Error: bgsave requires <file> [binary]\n");
+            return 1;
+        }
+        int ret = mk_bgsave(kv, args[0], args_count > 1 && strcmp(args[1], "binary") == 0);
+        if (ret == -2) {
+            fprintf(stderr, "Error: Background save already in progress\n");
+            return 1;
+        }
+        if (ret != 0) {
+            fprintf(stderr, "Error: Failed to start background save\n");
+            return 1;
+        }
+        printf("Background saving started\n");
+    }
+    // 处理 bgstatus 操作：查看后台保存的进度
+    else if (strcmp(cmd, "bgstatus") == 0) {
+        mk_bgsave_status_t st;
+        mk_bgsave_status(kv, &st);
+        printf("running:%d\n", st.running);
+        printf("last_result:%s\n", st.last_result == 0 ? "ok" : st.last_result < 0 ? "err" : "none");
+        printf("keys_written:%zu\n", st.keys_written);
+        printf("keys_total:%zu\n", st.keys_total);
+        printf("elapsed_ms:%llu\n", (unsigned long long)st.elapsed_ms);
     } else {
         fprintf(stderr, "Unknown command: %s\n", cmd);
         return 1;
@@ -302,6 +517,83 @@ int perform_kv_action(mk_t* kv, const char* cmd, char** args, int args_count, co
     return 0;
 }
 
+// 把批处理期间的修改落盘：日志模式下 fsync 日志，否则整体保存数据文件
+static int persist_batch(mk_t* kv, const char* filepath) {
+    int ret = mk_log_is_open(kv) ? mk_log_sync(kv) : save_store(kv, filepath);
+    if (ret != 0) fprintf(stderr, "Error: Failed to save file\n");
+    return ret;
+}
+
+// 批处理：逐行读取命令，在同一个实例上执行，只在检查点和结束时落盘
+// 每行一条 get/set/del/list 命令，save 立即落盘一次；空行和 # 开头的行忽略
+// checkpoint 为每多少次写操作落盘一次，不指定或为 0 时只在结束时落盘
+// 出错的行报告行号后继续执行，有任何一行出错时返回 1
+static int run_batch(mk_t* kv, const char* filepath, const char* script, const char* checkpoint) {
+    long every = 0;
+    if (checkpoint) {
+        char* end;
+        every = strtol(checkpoint, &end, 10);
+        if (*checkpoint == '\0' || *end != '\0' || every < 0) {
+            fprintf(stderr, "Error: checkpoint must be a non-negative number\n");
+            return 1;
+        }
+    }
+    FILE* in = strcmp(script, "-") == 0 ? stdin : fopen(script, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Failed to open %s\n", script);
+        return 1;
+    }
+
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    char* args[64];
+    long lineno = 0;
+    long dirty = 0;
+    int ret = 0;
+    while ((len = getline(&line, &cap, in)) != -1) {
+        lineno++;
+        // 去除行末换行符，兼容 CRLF
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        int n = parse_line(line, args, 63);
+        if (n == 0 || args[0][0] == '#') continue;
+
+        int failed;
+        if (strcmp(args[0], "save") == 0) {
+            failed = persist_batch(kv, filepath);
+            if (!failed) dirty = 0;
+        } else if (strcmp(args[0], "get") == 0 || strcmp(args[0], "set") == 0 ||
+                   strcmp(args[0], "del") == 0 || strcmp(args[0], "list") == 0 ||
+                   strcmp(args[0], "info") == 0 || strcmp(args[0], "latency") == 0) {
+            // list 第一次出现时才建立有序索引，纯写入的脚本不需要维护它
+            if (strcmp(args[0], "list") == 0 && mk_index_enable(kv) != 0) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                failed = 1;
+            } else {
+                // 不传文件路径，set/del 只修改内存，由这里统一落盘
+                failed = perform_kv_action(kv, args[0], &args[1], n - 1, NULL);
+            }
+            if (!failed && (strcmp(args[0], "set") == 0 || strcmp(args[0], "del") == 0)) dirty++;
+        } else {
+            fprintf(stderr, "Unknown command: %s\n", args[0]);
+            failed = 1;
+        }
+        if (failed) {
+            fprintf(stderr, "Error: %s line %ld\n", script, lineno);
+            ret = 1;
+        }
+        if (every > 0 && dirty >= every) {
+            if (persist_batch(kv, filepath) != 0) ret = 1;
+            dirty = 0;
+        }
+    }
+    if (dirty > 0 && persist_batch(kv, filepath) != 0) ret = 1;
+
+    free(line);
+    if (in != stdin) fclose(in);
+    return ret;
+}
+
 // 解析并执行单行命令
 void execute_interactive_command(mk_t* kv, int argc, char* argv[]) {
     // 寻找 -f 参数
@@ -352,11 +644,23 @@ void execute_interactive_command(mk_t* kv, int argc, char* argv[]) {
         // 如果指定了 -f，创建临时环境
         temp_kv = mk_create();
         // 检查内存分配是否成功
-        if (!temp_kv) {
+        if (!temp_kv || mk_index_enable(temp_kv) != 0) {
+            mk_destroy(temp_kv);
             fprintf(stderr, "Error: Memory allocation failed\n");
             return;
         }
-        mk_load(temp_kv, filepath);
+        mk_latency_enable(temp_kv, 1);
+        int loaded = mk_load(temp_kv, filepath);
+        if (loaded != 0 && loaded != 1) {
+            mk_destroy(temp_kv);
+            fprintf(stderr, "Error: Failed to load file %s\n", filepath);
+            return;
+        }
+        if (open_log_if_present(temp_kv, filepath, MK_FSYNC_ALWAYS) != 0) {
+            mk_destroy(temp_kv);
+            fprintf(stderr, "Error: Failed to open log %s.log\n", filepath);
+            return;
+        }
         target_kv = temp_kv;
     }
 
@@ -375,12 +679,15 @@ void interactive_mode() {
     char* argv[64];
     
     // 初始化内部 KV 存储实例
+    // 交互模式会反复 list，开启有序索引
     mk_t* global_kv = mk_create();
     // 检查实例创建是否成功
-    if (!global_kv) {
+    if (!global_kv || mk_index_enable(global_kv) != 0) {
+        mk_destroy(global_kv);
         fprintf(stderr, "Error: Failed to initialize memory kv\n");
         return;
     }
+    mk_latency_enable(global_kv, 1);
     printf("MiniKV Interactive Mode. Type 'h' or 'help' for commands, 'q' or 'quit' to exit.\n");
     // 循环读取命令
     while (1) {
@@ -411,9 +718,16 @@ void interactive_mode() {
             printf("  get <key> [-f <file>]\n");
             printf("  set <key> <value> [-f <file>]\n");
             printf("  del <key> [-f <file>]\n");
-            printf("  list [-f <file>]\n");
+            printf("  list [prefix] [-f <file>]\n");
+            printf("  info [-f <file>]\n");
+            printf("  latency [-f <file>]\n");
             printf("  load <file> (internal only)\n");
             printf("  save <file> (internal only)\n");
+            printf("  savebin <file> (internal only, binary snapshot)\n");
+            printf("  bgsave <file> [binary] (internal only, background save)\n");
+            printf("  bgstatus\n");
+            printf("  log on|off -f <file>\n");
+            printf("  compact -f <file>\n");
             printf("  quit / q : Exit\n");
             continue;
         }
@@ -0,0 +1,98 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ebr.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+// 每个线程的登记记录，按缓存行对齐，pin/unpin 只写自己的缓存行
+typedef struct mk_ebr_thread {
+    // pin 住时为 (epoch << 1) | 1，不在读临界区时为 0
+    _Alignas(64) uint64_t local;
+    // 记录是否属于某个存活的线程，线程退出后可以被新线程复用
+    int in_use;
+    // 所有记录组成的单链表，只增不删
+    struct mk_ebr_thread* next;
+} mk_ebr_thread_t;
+
+// 全局 epoch
+static uint64_t global_epoch = 1;
+// 登记记录链表头
+static mk_ebr_thread_t* thread_list = NULL;
+// 线程退出时归还记录
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+// 当前线程的记录和 pin 的嵌套层数
+static _Thread_local mk_ebr_thread_t* self = NULL;
+static _Thread_local unsigned nesting = 0;
+
+// 线程退出时把记录标记为空闲
+static void thread_exit(void* p) {
+    mk_ebr_thread_t* rec = (mk_ebr_thread_t*)p;
+    __atomic_store_n(&rec->local, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&rec->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void create_exit_key(void) {
+    pthread_key_create(&exit_key, thread_exit);
+}
+
+// 为当前线程登记记录：优先复用已退出线程的记录，没有再新分配
+static mk_ebr_thread_t* register_thread(void) {
+    pthread_once(&exit_key_once, create_exit_key);
+    mk_ebr_thread_t* rec = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE);
+    for (; rec; rec = rec->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&rec->in_use, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) break;
+    }
+    if (!rec) {
+        rec = (mk_ebr_thread_t*)aligned_alloc(_Alignof(mk_ebr_thread_t), sizeof(mk_ebr_thread_t));
+        // 分配失败时无法登记，退化为中止，避免在没有保护的情况下读取节点
+        if (!rec) abort();
+        rec->local = 0;
+        rec->in_use = 1;
+        rec->next = __atomic_load_n(&thread_list, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&thread_list, &rec->next, rec, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    pthread_setspecific(exit_key, rec);
+    return rec;
+}
+
+// 进入读临界区
+// 记录 epoch 使用 seq_cst 写入，之后读到的共享指针都不早于这次写入
+void mk_ebr_pin(void) {
+    if (nesting++ > 0) return;
+    if (!self) self = register_thread();
+    uint64_t epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&self->local, (epoch << 1) | 1, __ATOMIC_SEQ_CST);
+}
+
+// 离开读临界区
+void mk_ebr_unpin(void) {
+    if (--nesting > 0) return;
+    __atomic_store_n(&self->local, 0, __ATOMIC_RELEASE);
+}
+
+// 读取退休时间戳；先用全屏障保证摘下对象的写入在读取 epoch 之前对其他线程可见
+uint64_t mk_ebr_retire_epoch(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+}
+
+// 尝试推进全局 epoch
+uint64_t mk_ebr_try_advance(void) {
+    uint64_t epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    mk_ebr_thread_t* rec = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE);
+    for (; rec; rec = rec->next) {
+        uint64_t local = __atomic_load_n(&rec->local, __ATOMIC_SEQ_CST);
+        // 还有线程停留在更早的 epoch，不能推进
+        if ((local & 1) && (local >> 1) != epoch) return epoch;
+    }
+    __atomic_compare_exchange_n(&global_epoch, &epoch, epoch + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+}
+
+// 全局 epoch 比退休时前进了两次，退休前 pin 住的读线程都已经离开
+int mk_ebr_can_free(uint64_t retired) {
+    return __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE) >= retired + 2;
+}
@@ -0,0 +1,115 @@
+#define _POSIX_C_SOURCE 200809L
+#include "hash.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// 混合用的常数，取自 wyhash
+#define MK_HASH_S0 0xa0761d6478bd642fULL
+#define MK_HASH_S1 0xe7037ed1a0b428dbULL
+#define MK_HASH_S2 0x8ebc6af09c88c6e3ULL
+#define MK_HASH_S3 0x589965cc75374cc3ULL
+
+// 64x64 位乘法，低 64 位写回 a，高 64 位写回 b
+static inline void mum(uint64_t* a, uint64_t* b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+// 乘法后把高低两半异或到一起
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+    mum(&a, &b);
+    return a ^ b;
+}
+
+// 读取 8 字节和 4 字节，memcpy 允许非对齐地址，编译后是一条普通的 load
+static inline uint64_t read8(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t read4(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// 1~3 字节：首、中、尾三个字节拼在一起
+static inline uint64_t read3(const uint8_t* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+// 计算哈希
+// 16 字节以内直接读首尾两段（可能重叠）；更长的数据每 16 字节混合一次，
+// 超过 48 字节时用三条相互独立的乘法链，让 CPU 可以并行执行
+uint64_t mk_hash(const void* key, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t a, b;
+    seed ^= mix(seed ^ MK_HASH_S0, MK_HASH_S1);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (read4(p) << 32) | read4(p + off);
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - off);
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ MK_HASH_S1, read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ MK_HASH_S2, read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ MK_HASH_S3, read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ MK_HASH_S1, read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // 最后 16 字节（与前面可能重叠）
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= MK_HASH_S1;
+    b ^= seed;
+    mum(&a, &b);
+    return mix(a ^ MK_HASH_S0 ^ len, b ^ MK_HASH_S1);
+}
+
+// 进程级的随机种子基数
+static uint64_t seed_base;
+static uint64_t seed_counter;
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+
+// 读取随机数作为种子基数，读不到时退化为时间、进程号和地址的组合
+static void init_seed_base(void) {
+    FILE* fp = fopen("/dev/urandom", "rb");
+    if (fp) {
+        size_t n = fread(&seed_base, 1, sizeof(seed_base), fp);
+        fclose(fp);
+        if (n == sizeof(seed_base)) return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    seed_base = (uint64_t)ts.tv_nsec ^ ((uint64_t)ts.tv_sec << 32) ^ ((uint64_t)getpid() << 16) ^ (uint64_t)(uintptr_t)&ts;
+}
+
+// 生成种子：基数加上递增计数器再混合一次，每次调用得到不同的值
+uint64_t mk_hash_random_seed(void) {
+    pthread_once(&seed_once, init_seed_base);
+    uint64_t n = __atomic_add_fetch(&seed_counter, 1, __ATOMIC_RELAXED);
+    return mix(seed_base ^ MK_HASH_S2, n * MK_HASH_S3 ^ MK_HASH_S0);
+}
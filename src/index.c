@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L
+#include "index.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// 跳表最大层数，每层晋升概率 1/4，足够容纳 2^64 级别的数据量
+#define MK_INDEX_MAX_LEVEL 32
+
+// 索引项：节点指针加上各层的后继，层数在插入时随机决定
+typedef struct mk_index_entry {
+    mk_node_t* node;
+    struct mk_index_entry* next[];
+} mk_index_entry_t;
+
+struct mk_index {
+    // 头结点不对应任何 key，拥有全部层
+    mk_index_entry_t* head;
+    // 当前使用的最高层数
+    int level;
+    // 生成随机层数用的 xorshift 状态
+    uint64_t rng;
+    // 并发实例中保护整个跳表
+    pthread_mutex_t lock;
+    int locked;
+};
+
+// 按字节比较两个 key，内容相同时短的在前
+static int compare_keys(const char* a, size_t alen, const char* b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c != 0) return c;
+    return alen < blen ? -1 : (alen > blen ? 1 : 0);
+}
+
+// 比较索引项与给定 key
+static int compare_entry(const mk_index_entry_t* e, const char* key, size_t klen) {
+    return compare_keys(NODE_KEY(e->node), e->node->klen, key, klen);
+}
+
+static void lock_index(mk_index_t* index) {
+    if (index->locked) pthread_mutex_lock(&index->lock);
+}
+
+static void unlock_index(mk_index_t* index) {
+    if (index->locked) pthread_mutex_unlock(&index->lock);
+}
+
+// 随机层数：每多一层的概率为 1/4
+static int random_level(mk_index_t* index) {
+    uint64_t x = index->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    index->rng = x;
+    int level = 1;
+    while (level < MK_INDEX_MAX_LEVEL && (x & 3) == 0) {
+        level++;
+        x >>= 2;
+    }
+    return level;
+}
+
+// 在每一层找到最后一个小于 key 的索引项，记入 update（可以为 NULL）
+// 返回第 0 层中第一个不小于 key 的索引项
+static mk_index_entry_t* seek(mk_index_t* index, const char* key, size_t klen, mk_index_entry_t** update) {
+    mk_index_entry_t* x = index->head;
+    for (int i = index->level - 1; i >= 0; i--) {
+        while (x->next[i] && compare_entry(x->next[i], key, klen) < 0) x = x->next[i];
+        if (update) update[i] = x;
+    }
+    return x->next[0];
+}
+
+// 创建空索引
+mk_index_t* mk_index_create(int locked) {
+    mk_index_t* index = (mk_index_t*)malloc(sizeof(mk_index_t));
+    if (!index) return NULL;
+    index->head = (mk_index_entry_t*)calloc(1, sizeof(mk_index_entry_t) + MK_INDEX_MAX_LEVEL * sizeof(mk_index_entry_t*));
+    if (!index->head) {
+        free(index);
+        return NULL;
+    }
+    index->level = 1;
+    index->rng = 0x9e3779b97f4a7c15ULL;
+    index->locked = locked;
+    pthread_mutex_init(&index->lock, NULL);
+    return index;
+}
+
+// 释放索引，沿第 0 层逐个释放索引项
+void mk_index_destroy(mk_index_t* index) {
+    if (!index) return;
+    mk_index_entry_t* x = index->head;
+    while (x) {
+        mk_index_entry_t* next = x->next[0];
+        free(x);
+        x = next;
+    }
+    pthread_mutex_destroy(&index->lock);
+    free(index);
+}
+
+// 批量建索引时的排序项：key 前 8 字节按大端序拼成整数，大部分比较不必访问节点
+typedef struct {
+    uint64_t prefix;
+    mk_node_t* node;
+} sort_item_t;
+
+// 取 key 的前 8 字节（不足补 0）作为大端序整数，整数大小与字节序一致
+static uint64_t key_prefix(const mk_node_t* node) {
+    uint64_t p = 0;
+    size_t n = node->klen < 8 ? node->klen : 8;
+    for (size_t i = 0; i < n; i++) p |= (uint64_t)(unsigned char)NODE_KEY(node)[i] << (56 - 8 * i);
+    return p;
+}
+
+// qsort 比较函数，用于前缀相同的一段，直接比较完整的 key
+static int compare_items(const void* a, const void* b) {
+    const mk_node_t* x = ((const sort_item_t*)a)->node;
+    const mk_node_t* y = ((const sort_item_t*)b)->node;
+    return compare_keys(NODE_KEY(x), x->klen, NODE_KEY(y), y->klen);
+}
+
+// 按前缀做 LSD 基数排序，每轮 8 位；所有项在某一字节上相同时跳过这一轮
+// 排序结果在 items 中，tmp 是同样大小的辅助数组
+static void radix_sort(sort_item_t* items, sort_item_t* tmp, size_t n) {
+    size_t counts[256];
+    for (int shift = 0; shift < 64; shift += 8) {
+        memset(counts, 0, sizeof(counts));
+        for (size_t j = 0; j < n; j++) counts[(items[j].prefix >> shift) & 0xff]++;
+        if (counts[(items[0].prefix >> shift) & 0xff] == n) continue;
+        size_t pos = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[b];
+            counts[b] = pos;
+            pos += c;
+        }
+        for (size_t j = 0; j < n; j++) tmp[counts[(items[j].prefix >> shift) & 0xff]++] = items[j];
+        memcpy(items, tmp, n * sizeof(sort_item_t));
+    }
+}
+
+// 批量建立索引：排序后从小到大追加，每层只需记住当前的尾部
+// 先按前缀基数排序，前缀相同的一段（通常很短）再比较完整的 key
+int mk_index_build(mk_index_t* index, mk_node_t** nodes, size_t n) {
+    mk_index_entry_t* tail[MK_INDEX_MAX_LEVEL];
+    sort_item_t* items = (sort_item_t*)malloc((n ? n : 1) * 2 * sizeof(sort_item_t));
+    if (!items) return -1;
+    for (size_t j = 0; j < n; j++) items[j] = (sort_item_t){ key_prefix(nodes[j]), nodes[j] };
+    if (n > 0) radix_sort(items, items + n, n);
+    for (size_t j = 0; j < n;) {
+        size_t k = j + 1;
+        while (k < n && items[k].prefix == items[j].prefix) k++;
+        if (k - j > 1) qsort(items + j, k - j, sizeof(sort_item_t), compare_items);
+        j = k;
+    }
+    for (size_t j = 0; j < n; j++) nodes[j] = items[j].node;
+    free(items);
+    lock_index(index);
+    for (int i = 0; i < MK_INDEX_MAX_LEVEL; i++) tail[i] = index->head;
+    int ret = 0;
+    for (size_t j = 0; j < n; j++) {
+        int level = random_level(index);
+        mk_index_entry_t* e = (mk_index_entry_t*)malloc(sizeof(mk_index_entry_t) + (size_t)level * sizeof(mk_index_entry_t*));
+        if (!e) {
+            ret = -1;
+            break;
+        }
+        e->node = nodes[j];
+        for (int i = 0; i < level; i++) {
+            e->next[i] = NULL;
+            tail[i]->next[i] = e;
+            tail[i] = e;
+        }
+        if (level > index->level) index->level = level;
+    }
+    unlock_index(index);
+    return ret;
+}
+
+// 插入节点
+int mk_index_insert(mk_index_t* index, mk_node_t* node) {
+    mk_index_entry_t* update[MK_INDEX_MAX_LEVEL];
+    lock_index(index);
+    seek(index, NODE_KEY(node), node->klen, update);
+    int level = random_level(index);
+    mk_index_entry_t* e = (mk_index_entry_t*)malloc(sizeof(mk_index_entry_t) + (size_t)level * sizeof(mk_index_entry_t*));
+    if (!e) {
+        unlock_index(index);
+        return -1;
+    }
+    // 新增的层从头结点开始
+    for (int i = index->level; i < level; i++) update[i] = index->head;
+    if (level > index->level) index->level = level;
+    e->node = node;
+    for (int i = 0; i < level; i++) {
+        e->next[i] = update[i]->next[i];
+        update[i]->next[i] = e;
+    }
+    unlock_index(index);
+    return 0;
+}
+
+// 让索引项指向替换后的节点
+void mk_index_replace(mk_index_t* index, mk_node_t* node) {
+    lock_index(index);
+    mk_index_entry_t* e = seek(index, NODE_KEY(node), node->klen, NULL);
+    if (e && compare_entry(e, NODE_KEY(node), node->klen) == 0) e->node = node;
+    unlock_index(index);
+}
+
+// 删除索引项，在每一层摘下后释放
+void mk_index_remove(mk_index_t* index, const mk_node_t* node) {
+    mk_index_entry_t* update[MK_INDEX_MAX_LEVEL];
+    lock_index(index);
+    mk_index_entry_t* e = seek(index, NODE_KEY(node), node->klen, update);
+    if (e && compare_entry(e, NODE_KEY(node), node->klen) == 0) {
+        for (int i = 0; i < index->level && update[i]->next[i] == e; i++) update[i]->next[i] = e->next[i];
+        while (index->level > 1 && !index->head->next[index->level - 1]) index->level--;
+        free(e);
+    }
+    unlock_index(index);
+}
+
+// 有序遍历：先 O(log n) 定位起点，再沿第 0 层顺序前进
+size_t mk_index_range(mk_index_t* index, const char* start, size_t slen, const char* end, size_t elen, int prefix,
+                      void (*callback)(const mk_node_t* node, void* user_data), void* user_data) {
+    size_t visited = 0;
+    lock_index(index);
+    mk_index_entry_t* x = start ? seek(index, start, slen, NULL) : index->head->next[0];
+    for (; x; x = x->next[0]) {
+        const mk_node_t* node = x->node;
+        if (prefix) {
+            if (node->klen < slen || memcmp(NODE_KEY(node), start, slen) != 0) break;
+        } else if (end && compare_keys(NODE_KEY(node), node->klen, end, elen) >= 0) {
+            break;
+        }
+        callback(node, user_data);
+        visited++;
+    }
+    unlock_index(index);
+    return visited;
+}
@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+#include "latency.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 每个 2 的幂区间等分的档数的位数
+#define MK_LATENCY_SUB_BITS 3
+#define MK_LATENCY_SUB (1 << MK_LATENCY_SUB_BITS)
+
+_Static_assert(MK_LATENCY_BUCKETS == (64 - MK_LATENCY_SUB_BITS + 1) * MK_LATENCY_SUB,
+               "MK_LATENCY_BUCKETS must cover every 64-bit value");
+
+static const char* const op_names[MK_OP_COUNT] = { "get", "set", "del", "resize", "load", "save" };
+
+// 单调时钟的纳秒数
+uint64_t mk_latency_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 耗时所在的档位：最高位决定区间，其后 3 位决定区间内的档
+static int bucket_of(uint64_t ns) {
+    if (ns < MK_LATENCY_SUB) return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (msb - MK_LATENCY_SUB_BITS)) & (MK_LATENCY_SUB - 1));
+    return (msb - MK_LATENCY_SUB_BITS + 1) * MK_LATENCY_SUB + sub;
+}
+
+// 记录一次耗时，最大值用 CAS 更新，只有刷新最大值时才会重试
+void mk_latency_record(mk_latency_hist_t* hist, mk_op_t op, uint64_t start) {
+    if (!hist) return;
+    uint64_t ns = mk_latency_now() - start;
+    __atomic_fetch_add(&hist->counts[op][bucket_of(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->total_ns[op], ns, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&hist->max_ns[op], __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&hist->max_ns[op], &max, ns, 0,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// 第 idx 档覆盖的范围 [low, high)，最后一档的上界截到 UINT64_MAX
+int mk_latency_bucket(int idx, uint64_t* low, uint64_t* high) {
+    if (idx < 0 || idx >= MK_LATENCY_BUCKETS || !low || !high) return -1;
+    if (idx < MK_LATENCY_SUB) {
+        *low = (uint64_t)idx;
+        *high = (uint64_t)idx + 1;
+        return 0;
+    }
+    int shift = idx / MK_LATENCY_SUB - 1;
+    uint64_t width = 1ULL << shift;
+    *low = (uint64_t)(MK_LATENCY_SUB + idx % MK_LATENCY_SUB) << shift;
+    *high = *low > UINT64_MAX - width ? UINT64_MAX : *low + width;
+    return 0;
+}
+
+const char* mk_op_name(mk_op_t op) {
+    return (unsigned)op < MK_OP_COUNT ? op_names[op] : NULL;
+}
+
+// 开启或暂停记录，第一次开启时分配直方图并挂到实例和各分片上
+int mk_latency_enable(mk_t* kv, int on) {
+#ifdef MK_NO_LATENCY
+    (void)kv;
+    (void)on;
+    return -1;
+#else
+    if (!kv) return -1;
+    mk_latency_hist_t* hist = kv->latency;
+    if (!hist) {
+        if (!on) return 0;
+        hist = (mk_latency_hist_t*)calloc(1, sizeof(mk_latency_hist_t));
+        if (!hist) return -1;
+        // 先挂到分片上：写操作按分片记录扩容，读操作按实例判断是否开启
+        for (size_t i = 0; kv->shards && i <= kv->shard_mask; i++) {
+            __atomic_store_n(&kv->shards[i].kv->latency, hist, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&kv->latency, hist, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&hist->enabled, on ? 1 : 0, __ATOMIC_RELAXED);
+    return 0;
+#endif
+}
+
+// 清空计数，与正在进行的记录交错时个别计数可能留下
+void mk_latency_reset(mk_t* kv) {
+    if (!kv || !kv->latency) return;
+    mk_latency_hist_t* hist = kv->latency;
+    for (int op = 0; op < MK_OP_COUNT; op++) {
+        for (int i = 0; i < MK_LATENCY_BUCKETS; i++) __atomic_store_n(&hist->counts[op][i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&hist->total_ns[op], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&hist->max_ns[op], 0, __ATOMIC_RELAXED);
+    }
+}
+
+// 复制一种操作的直方图并计算分位数，分位数取所在档的上界，不超过最大值
+int mk_latency(const mk_t* kv, mk_op_t op, mk_latency_t* out) {
+    if (!kv || !out || (unsigned)op >= MK_OP_COUNT || !kv->latency) return -1;
+    const mk_latency_hist_t* hist = kv->latency;
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < MK_LATENCY_BUCKETS; i++) {
+        out->buckets[i] = __atomic_load_n(&hist->counts[op][i], __ATOMIC_RELAXED);
+        out->count += out->buckets[i];
+    }
+    out->total_ns = __atomic_load_n(&hist->total_ns[op], __ATOMIC_RELAXED);
+    out->max_ns = __atomic_load_n(&hist->max_ns[op], __ATOMIC_RELAXED);
+    const double qs[4] = { 0.5, 0.9, 0.99, 0.999 };
+    uint64_t* dst[4] = { &out->p50_ns, &out->p90_ns, &out->p99_ns, &out->p999_ns };
+    for (int q = 0; q < 4 && out->count; q++) {
+        // 排名向上取整，至少为 1
+        uint64_t rank = (uint64_t)(qs[q] * (double)out->count);
+        if ((double)rank < qs[q] * (double)out->count || rank == 0) rank++;
+        uint64_t seen = 0;
+        for (int i = 0; i < MK_LATENCY_BUCKETS; i++) {
+            seen += out->buckets[i];
+            if (seen < rank) continue;
+            uint64_t low, high;
+            mk_latency_bucket(i, &low, &high);
+            *dst[q] = high - 1 < out->max_ns ? high - 1 : out->max_ns;
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,209 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minikv.h"
+#include "minikv_internal.h"
+#include "parser.h"
+#include "latency.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * 多线程加载文本文件：
+ *   1. 整个文件 mmap 进来，按线程数切成若干块，切分点挪到下一个换行之后；
+ *   2. 每个工作线程解析自己的块，计算哈希，并在线程私有的 slab 里构造好节点，
+ *      按行序记录到自己的分区里；
+ *   3. 主线程把各线程的 slab 并入实例，再按块的顺序把节点依次放进哈希表。
+ * 块按文件顺序合并、块内按行序合并，因此重复 key 仍然是后出现的生效，
+ * 与顺序加载的语义一致。
+ */
+
+// 每个线程至少处理的字节数，文件太小时减少线程数
+#define MK_LOAD_MIN_CHUNK (256 * 1024)
+// 线程数上限
+#define MK_LOAD_MAX_THREADS 64
+
+// 单个工作线程的分区
+typedef struct {
+    // 目标实例，只用来读取哈希种子
+    const mk_t* kv;
+    // 负责解析的区间 [begin, end)
+    const char* begin;
+    const char* end;
+    // 线程私有的节点分配器
+    mk_slab_t slab;
+    // 按行序排列的节点
+    mk_node_t** nodes;
+    size_t count;
+    size_t cap;
+    // 分配失败时置 1
+    int error;
+} load_part_t;
+
+// 把节点追加到分区
+static int part_push(load_part_t* part, mk_node_t* node) {
+    if (part->count == part->cap) {
+        size_t cap = part->cap ? part->cap * 2 : 1024;
+        mk_node_t** bigger = (mk_node_t**)realloc(part->nodes, cap * sizeof(mk_node_t*));
+        if (!bigger) return -1;
+        part->nodes = bigger;
+        part->cap = cap;
+    }
+    part->nodes[part->count++] = node;
+    return 0;
+}
+
+// 工作线程：逐行解析并构造节点
+static void* load_worker(void* arg) {
+    load_part_t* part = (load_part_t*)arg;
+    const char* p = part->begin;
+    // 转义行的解码缓冲区
+    char* scratch = NULL;
+    size_t scratch_cap = 0;
+    while (p < part->end && !part->error) {
+        // 用 memchr 找行尾，行长度不受限制
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(part->end - p));
+        const char* line_end = nl ? nl : part->end;
+        const char* key;
+        const char* val;
+        size_t klen, vlen;
+        // 带过期时间的行先去掉 "@<过期时刻> " 前缀
+        uint64_t expire_at = 0;
+        size_t skip = parse_expire_prefix(p, (size_t)(line_end - p), &expire_at);
+        int parsed = parse_entry_slice(p + skip, (size_t)(line_end - p) - skip, &scratch, &scratch_cap,
+                                       &key, &klen, &val, &vlen);
+        if (parsed < 0) {
+            part->error = 1;
+            break;
+        }
+        if (parsed) {
+            // 直接从映射中的切片计算哈希并拷贝出节点
+            mk_node_t* node = mk_node_new(&part->slab, key, klen, mk_hash_bytes(part->kv, key, klen), val, vlen,
+                                          expire_at);
+            if (!node || part_push(part, node) != 0) {
+                part->error = 1;
+                break;
+            }
+        }
+        p = line_end + 1;
+    }
+    free(scratch);
+    return NULL;
+}
+
+// 多线程加载文本文件
+static int load_parallel(mk_t* kv, const char* filepath, int nthreads) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        // 快照不存在时仍然尝试重放日志，与 mk_load 一致
+        int replayed = mk_replay_log(kv, filepath);
+        return replayed < 0 ? -1 : replayed;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char* base = NULL;
+    if (size > 0) {
+        base = (const char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        posix_madvise((void*)base, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    // 确定线程数：未指定时取在线 CPU 数，并保证每块不会太小
+    if (nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > MK_LOAD_MAX_THREADS) nthreads = MK_LOAD_MAX_THREADS;
+    if ((size_t)nthreads > size / MK_LOAD_MIN_CHUNK) nthreads = (int)(size / MK_LOAD_MIN_CHUNK);
+    if (nthreads < 1) nthreads = 1;
+
+    load_part_t* parts = (load_part_t*)calloc((size_t)nthreads, sizeof(load_part_t));
+    pthread_t* threads = (pthread_t*)calloc((size_t)nthreads, sizeof(pthread_t));
+    int ret = (parts && threads) ? 0 : -1;
+    int started = 0;
+    if (ret == 0) {
+        // 切分文件：每个切分点挪到其后第一个换行之后，保证不会切断一行
+        const char* file_end = base + size;
+        const char* begin = base;
+        for (int i = 0; i < nthreads; i++) {
+            const char* end = file_end;
+            if (i < nthreads - 1) {
+                end = base + size / (size_t)nthreads * (size_t)(i + 1);
+                if (end < begin) end = begin;
+                const char* nl = (const char*)memchr(end, '\n', (size_t)(file_end - end));
+                end = nl ? nl + 1 : file_end;
+            }
+            parts[i].kv = kv;
+            parts[i].begin = begin;
+            parts[i].end = end;
+            mk_slab_init(&parts[i].slab);
+            begin = end;
+        }
+        // 第 0 块由当前线程处理，其余块交给新线程
+        for (int i = 1; i < nthreads; i++) {
+            if (pthread_create(&threads[i], NULL, load_worker, &parts[i]) != 0) {
+                parts[i].error = 1;
+                break;
+            }
+            started = i;
+        }
+        load_worker(&parts[0]);
+        for (int i = 1; i <= started; i++) pthread_join(threads[i], NULL);
+        for (int i = 0; i < nthreads; i++) {
+            if (parts[i].error) ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        // 先把所有线程的 slab 并入实例，被覆盖的旧节点才能正常归还
+        size_t total = 0;
+        for (int i = 0; i < nthreads; i++) {
+            mk_slab_merge(&kv->slab, &parts[i].slab);
+            total += parts[i].count;
+        }
+        // 按块顺序、块内行序放入哈希表，后出现的同名 key 覆盖先出现的
+        mk_reserve(kv, mk_count(kv) + total);
+        for (int i = 0; i < nthreads && ret == 0; i++) {
+            for (size_t j = 0; j < parts[i].count; j++) {
+                if (mk_put_node(kv, parts[i].nodes[j]) != 0) {
+                    ret = -1;
+                    break;
+                }
+            }
+        }
+    } else if (parts) {
+        // 出错时丢弃各线程已经构造的节点
+        for (int i = 0; i < nthreads; i++) mk_slab_destroy(&parts[i].slab);
+    }
+    if (parts) {
+        for (int i = 0; i < nthreads; i++) free(parts[i].nodes);
+    }
+    free(parts);
+    free(threads);
+    if (base) munmap((void*)base, size);
+    if (ret != 0) return ret;
+
+    // 与 mk_load 一样，快照之后按顺序重放日志，最后回收已经过期的 key
+    if (mk_replay_log(kv, filepath) < 0) return -1;
+    mk_expire(kv);
+    return 0;
+}
+
+// 多线程加载，整个加载过程记一次延迟
+int mk_load_parallel(mk_t* kv, const char* filepath, int nthreads) {
+    if (!kv || !filepath) return -1;
+    // 二进制快照本身就是 mmap 加载，无需多线程
+    if (mk_file_is_binary(filepath)) return mk_load(kv, filepath);
+    uint64_t timer = mk_latency_begin(kv);
+    int ret = load_parallel(kv, filepath, nthreads);
+    mk_latency_end(kv, MK_OP_LOAD, timer);
+    return ret;
+}
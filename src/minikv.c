@@ -1,53 +1,159 @@
 #define _POSIX_C_SOURCE 200809L
 #include "minikv.h"
+#include "minikv_internal.h"
 #include "parser.h"
+#include "aof.h"
+#include "ebr.h"
+#include "hash.h"
+#include "index.h"
+#include "wheel.h"
+#include "latency.h"
+#include "writer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
-// 单个键值对节点（用于哈希桶内链表）
-typedef struct mk_node {
-    char* key;
-    char* value;
-    struct mk_node* next;
-} mk_node_t;
-
-// 简易哈希表
-struct mk_t {
-    // 桶指针数组，指向链表头节点
-    mk_node_t** buckets;
-    // 桶的数量
-    size_t bucket_count;
-    // 当前存储的键值对数量
-    size_t count;
-};
-
-
+// 初始槽位数量
+#define MK_INITIAL_CAPACITY 256
+// 每次写操作最多迁移的节点数
+#define MK_REHASH_STEP 8
+// 加载文本文件时读缓冲区的初始大小
+#define MK_LOAD_BUFFER_SIZE (1 << 20)
+// 每次写操作最多跳过的空槽数，防止稀疏旧表让单次操作耗时过长
+#define MK_REHASH_EMPTY_VISITS (MK_REHASH_STEP * 10)
+// 并发实例默认的分片数量
+#define MK_DEFAULT_SHARDS 64
+// 并发实例的分片数量上限
+#define MK_MAX_SHARDS 4096
+// 分片每攒够这么多待回收对象尝试回收一次
+#define MK_RETIRE_BATCH 64
+// 无锁读遇到进行中的结构修改时，自旋这么多次后让出 CPU
+#define MK_READ_SPINS 64
+// 批量操作每组处理的 key 数，一组的预取在解析前都能到达缓存又不至于互相挤出
+#define MK_BATCH 16
+// 删除后负载低于 1/MK_SHRINK_RATIO 时缩容
+#define MK_SHRINK_RATIO 8
+// 文本行 "@<过期时刻> " 前缀的最大长度（20 位十进制数加 '@' 和空格）
+#define MK_EXPIRE_PREFIX 22
+// 并发实例的游标中，分片编号从这一位开始，低位是分片内的桶游标
+#define MK_SCAN_SHARD_SHIFT 48
+// mk_scan 每返回一个键值对最多检查的空桶数，防止稀疏表让单次调用耗时过长
+#define MK_SCAN_EMPTY_VISITS 10
+// 每次写操作最多顺带回收的过期 key 数
+#define MK_EXPIRE_STEP 16
+// 淘汰时每次取样的 key 数
+#define MK_EVICT_SAMPLES 5
+// 每个样本最多试探的随机位置数，负载不低于 1/MK_SHRINK_RATIO 时很少全部落空
+#define MK_EVICT_PROBES 16
+// LFU 计数的初始值，新 key 不会因为计数为 0 立即被淘汰
+#define MK_LFU_INIT 5
+// LFU 计数的对数因子，越大计数增长越慢，约 100 万次访问达到上限
+#define MK_LFU_LOG_FACTOR 10
 
+// 当前毫秒级 Unix 时间
+uint64_t mk_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
 
+// 单调时钟的纳秒数，只用于统计耗时
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
 
 // 获取键值对数量
 size_t mk_count(const mk_t* kv) {
     // 如果没有kv实例返回0，否则返回count
-    return kv ? kv->count : 0;
+    if (!kv) return 0;
+    // 并发实例依次累加各分片的计数
+    if (kv->shards) {
+        size_t total = 0;
+        for (size_t i = 0; i <= kv->shard_mask; i++) {
+            pthread_rwlock_rdlock(&kv->shards[i].lock);
+            total += kv->shards[i].kv->count;
+            pthread_rwlock_unlock(&kv->shards[i].lock);
+        }
+        return total;
+    }
+    return kv->count;
 }
 
-// djb2 哈希函数
-static unsigned long hash_key(const char* str) {
-    unsigned long hash = 5381;
-    int c;
-    // hash = hash * 33 + c（核心递推公式）
-    while ((c = (unsigned char)*str++)) {
-        hash = ((hash << 5) + hash) + (unsigned long)c;
-    }
-    return hash;
+// 计算以 '\0' 结尾的 key 的哈希，顺便通过 len_out 返回 key 长度
+// 先用 strlen 求长度再按 8 字节一组计算，比逐字节的递推快
+uint64_t mk_hash_key(const mk_t* kv, const char* str, size_t* len_out) {
+    *len_out = strlen(str);
+    return mk_hash(str, *len_out, kv->seed);
+}
+
+// 按长度计算哈希，结果与 mk_hash_key 相同，key 不需要以 '\0' 结尾
+uint64_t mk_hash_bytes(const mk_t* kv, const char* key, size_t len) {
+    return mk_hash(key, len, kv->seed);
+}
+
+// 计算理想槽位下标
+static size_t slot_index(size_t capacity, uint64_t hash) {
+    return (size_t)hash & (capacity - 1);
+}
+
+// 按哈希高位选择分片，低位留给分片内的表做下标和指纹，两者互不相关
+static mk_shard_t* shard_of(const mk_t* kv, uint64_t hash) {
+    return &kv->shards[(size_t)(hash >> 40) & kv->shard_mask];
+}
+
+// 写操作前锁住 key 所在的分片，返回实际存放数据的实例
+// 普通实例不加锁，直接返回自身
+static mk_t* lock_write(mk_t* kv, uint64_t hash) {
+    if (!kv->shards) return kv;
+    mk_shard_t* shard = shard_of(kv, hash);
+    pthread_rwlock_wrlock(&shard->lock);
+    return shard->kv;
+}
+
+// 释放 key 所在分片的锁
+static void unlock_hash(const mk_t* kv, uint64_t hash) {
+    if (kv->shards) pthread_rwlock_unlock(&shard_of(kv, hash)->lock);
+}
+
+// 按下标顺序给所有分片加读锁，固定顺序保证多个调用方之间不会死锁
+static void lock_all(const mk_t* kv) {
+    if (!kv->shards) return;
+    for (size_t i = 0; i <= kv->shard_mask; i++) pthread_rwlock_rdlock(&kv->shards[i].lock);
+}
+
+// 释放 lock_all 加的锁
+static void unlock_all(const mk_t* kv) {
+    if (!kv->shards) return;
+    for (size_t i = 0; i <= kv->shard_mask; i++) pthread_rwlock_unlock(&kv->shards[i].lock);
+}
+
+// 供其他模块使用的 lock_all / unlock_all
+void mk_lock_all(const mk_t* kv) {
+    lock_all(kv);
+}
+
+void mk_unlock_all(const mk_t* kv) {
+    unlock_all(kv);
 }
 
-// 计算桶索引
-// C不支持默认参数
-static size_t bucket_index(const mk_t* kv, const char* key) {
-    return (size_t)(hash_key(key) % kv->bucket_count);
+// 并发实例中锁住日志和映射列表
+static void lock_meta(mk_t* kv) {
+    if (kv->shards) pthread_mutex_lock(&kv->meta_lock);
+}
+
+// 释放 lock_meta 加的锁
+static void unlock_meta(mk_t* kv) {
+    if (kv->shards) pthread_mutex_unlock(&kv->meta_lock);
 }
 
 // 创建kv哈希表
@@ -55,235 +161,1776 @@ mk_t* mk_create(void) {
     // 创建哈希表实例
     mk_t* kv = (mk_t*)malloc(sizeof(mk_t));
     if (!kv) return NULL;
-    // 初始化桶数量为256
-    kv->bucket_count = 256;
-    // 初始化键值对数量为0
+    // 初始化节点分配器
+    mk_slab_init(&kv->slab);
+    // 初始化槽位数量
+    kv->table.capacity = MK_INITIAL_CAPACITY;
+    // 初始化键值对数量为0，没有进行中的迁移
     kv->count = 0;
-    // 分配桶指针数组，calloc会初始化为NULL以便分辨空桶
-    kv->buckets = (mk_node_t**)calloc(kv->bucket_count, sizeof(mk_node_t*));
+    kv->old.slots = NULL;
+    kv->old.capacity = 0;
+    kv->rehash_idx = 0;
+    // 默认不开启日志
+    kv->aof = NULL;
+    kv->snapshot_path = NULL;
+    kv->mappings = NULL;
+    // 默认是普通实例
+    kv->shards = NULL;
+    kv->shard_mask = 0;
+    kv->owner = NULL;
+    // 每个实例使用独立的随机种子，外部无法构造出集中到同一簇的 key
+    kv->seed = mk_hash_random_seed();
+    kv->index = NULL;
+    kv->wheel = NULL;
+    // 默认不限制内存
+    kv->maxmemory = 0;
+    kv->evict = 0;
+    kv->memory = kv->table.capacity * sizeof(mk_slot_t);
+    kv->resizes = 0;
+    kv->resize_ns = 0;
+    kv->saves = 0;
+    kv->save_bytes = 0;
+    kv->save_ns = 0;
+    kv->last_save_bytes = 0;
+    kv->last_save_ns = 0;
+    kv->latency = NULL;
+    kv->bgsave = (mk_bgsave_t){ .pid = 0, .shared = NULL, .started_ms = 0, .finished_ms = 0, .result = 1 };
+    pthread_mutex_init(&kv->bgsave.lock, NULL);
+    pthread_mutex_init(&kv->meta_lock, NULL);
+    // 分配槽位数组，calloc会把dist初始化为0，即全部为空槽
+    kv->table.slots = (mk_slot_t*)calloc(kv->table.capacity, sizeof(mk_slot_t));
     // 分配失败则释放kv实例并返回NULL
-    if (!kv->buckets) {
+    if (!kv->table.slots) {
+        pthread_mutex_destroy(&kv->bgsave.lock);
+        pthread_mutex_destroy(&kv->meta_lock);
         free(kv);
         return NULL;
     }
     return kv;
 }
 
-// 根据kv创建新节点
-mk_node_t* create_node(const char* key, const char* value) {
-    mk_node_t* node = (mk_node_t*)malloc(sizeof(mk_node_t));
-    if (!node) return NULL;
-    node->key = strdup(key);
-    node->value = strdup(value);
-    node->next = NULL;
-    if (!node->key || !node->value) {
-        free(node->key);
-        free(node->value);
-        free(node);
+// 创建线程安全的分片实例
+// 每个分片是一个独立的普通实例，有自己的表、slab 和读写锁
+mk_t* mk_create_concurrent(int nshards) {
+    // 分片数量取 2 的幂，用掩码选择分片
+    size_t want = nshards > 0 ? (size_t)nshards : MK_DEFAULT_SHARDS;
+    if (want > MK_MAX_SHARDS) want = MK_MAX_SHARDS;
+    size_t n = 1;
+    while (n < want) n *= 2;
+    mk_t* kv = mk_create();
+    if (!kv) return NULL;
+    // 分片按缓存行对齐分配
+    kv->shards = (mk_shard_t*)aligned_alloc(_Alignof(mk_shard_t), n * sizeof(mk_shard_t));
+    if (!kv->shards) {
+        mk_destroy(kv);
+        return NULL;
+    }
+    kv->shard_mask = n - 1;
+    int failed = 0;
+    for (size_t i = 0; i < n; i++) {
+        mk_shard_t* shard = &kv->shards[i];
+        pthread_rwlock_init(&shard->lock, NULL);
+        shard->seq = 0;
+        shard->retired = NULL;
+        shard->retired_count = 0;
+        shard->retired_cap = 0;
+        shard->kv = mk_create();
+        if (!shard->kv) {
+            failed = 1;
+            continue;
+        }
+        // 分片与实例使用同一个种子，选择分片和分片内查找用的是同一个哈希值
+        shard->kv->owner = shard;
+        shard->kv->seed = kv->seed;
+    }
+    if (failed) {
+        mk_destroy(kv);
         return NULL;
     }
+    return kv;
+}
+
+// 从指定的 slab 创建新节点，同时记录 key 的哈希值和长度
+// 节点头、key、value 一次分配，块内剩余空间留给之后的原地覆盖
+// key/value 按长度拷贝，输入不要求以 '\0' 结尾；有过期时间时放在块的最后 8 字节
+mk_node_t* mk_node_new(mk_slab_t* slab, const char* key, size_t klen, uint64_t hash,
+                       const char* value, size_t vlen, uint64_t expire_at) {
+    uint8_t cls;
+    size_t usable;
+    size_t tail = expire_at ? sizeof(uint64_t) : 0;
+    size_t need = offsetof(mk_node_t, data) + klen + 1 + vlen + 1 + tail;
+    mk_node_t* node = (mk_node_t*)mk_slab_alloc(slab, need, &cls, &usable);
+    if (!node) return NULL;
+    node->hash = hash;
+    node->klen = (uint32_t)klen;
+    node->vlen = (uint32_t)vlen;
+    node->vcap = (uint32_t)(usable - (need - vlen));
+    node->cls = cls;
+    node->flags = expire_at ? MK_NODE_EXPIRES : 0;
+    // 依次拷贝 key 和 value，各自补上 '\0'
+    memcpy(NODE_KEY(node), key, klen);
+    NODE_KEY(node)[klen] = '\0';
+    memcpy(NODE_VALUE(node), value, vlen);
+    NODE_VALUE(node)[vlen] = '\0';
+    if (expire_at) memcpy(NODE_EXPIRE(node), &expire_at, sizeof(expire_at));
     return node;
 }
 
-// 扩容哈希表
-// 参数为哈希表指针kv和新的桶数量
-static int mk_resize(mk_t* kv, size_t new_bucket_count) {
-    if (!kv) return -1;
-    // 同样calloc分配新桶指针数组
-    mk_node_t** new_buckets = (mk_node_t**)calloc(new_bucket_count, sizeof(mk_node_t*));
-    if (!new_buckets) return -2;
-    // 重新分配所有节点到新桶
-    for (size_t i = 0; i < kv->bucket_count; i++) {
-        // 遍历旧桶中的链表，将节点重新分配到新桶
-        mk_node_t* node = kv->buckets[i];
-        while (node) {
-            mk_node_t* next = node->next;
-            // 桶数量变了，哈希值取模也要变
-            size_t idx = (size_t)(hash_key(node->key) % new_bucket_count);
-            // 典型的头插法，注意new_buckets[idx]是原来的头节点地址
-            // 新节点先指向原来的头节点，桶指向新节点
-            node->next = new_buckets[idx];
-            new_buckets[idx] = node;
-            node = next;
-        }
-    }
-    // 释放旧桶指针数组
-    free(kv->buckets);
-    // 更新哈希表结构体的桶指针和桶数量
-    kv->buckets = new_buckets;
-    kv->bucket_count = new_bucket_count;
+// 节点占用的字节数：slab 块的大小，超大块再加上链表头
+// 块的大小由节点字段算出：mk_node_new 把块内剩余空间都记在 vcap 里
+// mmap 快照中的记录按记录本身的长度计算
+static size_t node_bytes(const mk_node_t* node) {
+    size_t tail = (node->flags & MK_NODE_EXPIRES) ? sizeof(uint64_t) : 0;
+    size_t vcap = node->cls == MK_NODE_MAPPED ? node->vlen : node->vcap;
+    size_t size = offsetof(mk_node_t, data) + node->klen + 1 + vcap + 1 + tail;
+    if (node->cls == MK_NODE_MAPPED) size = (size + 7) & ~(size_t)7;
+    if (node->cls == MK_SLAB_LARGE) size += MK_SLAB_LARGE_HEADER;
+    return size;
+}
+
+// 线程私有的 xorshift 伪随机数，用于淘汰取样和 LFU 的概率递增，第一次使用时取随机种子
+static uint64_t next_random(void) {
+    static _Thread_local uint64_t state = 0;
+    if (!state) state = mk_hash_random_seed() | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// LRU 时钟：以秒为单位的当前时间取低 16 位，约 18 小时回绕一次，空闲时间按回绕后的差计算
+static uint16_t lru_clock(void) {
+    return (uint16_t)(mk_now_ms() / 1000);
+}
+
+// LFU 访问信息：高 8 位是对数计数，低 8 位是上次衰减的时间（分钟，取低 8 位）
+// 每过一分钟计数减 1，空闲再久也最多减到 0
+static unsigned lfu_counter(uint16_t access, uint64_t minutes) {
+    unsigned counter = access >> 8;
+    unsigned elapsed = (unsigned)((minutes - access) & 0xff);
+    return elapsed >= counter ? 0 : counter - elapsed;
+}
+
+// LFU 计数按概率递增：计数越大越难增加，8 位能区分从几次到上百万次的访问频率
+static uint16_t lfu_touch(uint16_t access, uint64_t minutes) {
+    unsigned counter = lfu_counter(access, minutes);
+    if (counter < 255) {
+        unsigned base = counter > MK_LFU_INIT ? counter - MK_LFU_INIT : 0;
+        if (next_random() % (base * MK_LFU_LOG_FACTOR + 1) == 0) counter++;
+    }
+    return (uint16_t)(counter << 8 | (minutes & 0xff));
+}
+
+// 新写入的 key 的访问信息
+static uint16_t initial_access(const mk_t* kv) {
+    int evict = __atomic_load_n(&kv->evict, __ATOMIC_RELAXED);
+    if (evict == MK_EVICT_LRU) return lru_clock();
+    if (evict == MK_EVICT_LFU) return (uint16_t)(MK_LFU_INIT << 8 | ((mk_now_ms() / 60000) & 0xff));
     return 0;
 }
 
-// 释放桶内链表
-static void free_bucket_list(mk_node_t* node) {
-    while (node) {
-        mk_node_t* next = node->next;
-        free(node->key);
-        free(node->value);
-        free(node);
-        node = next;
+// 记录一次访问；没有开启内存上限时什么也不做
+// 无锁读线程也会调用，与写线程的并发更新可能丢失一次，淘汰本来就是近似的
+static void touch_slot(const mk_t* kv, mk_slot_t* slot) {
+    int evict = __atomic_load_n(&kv->evict, __ATOMIC_RELAXED);
+    if (!evict) return;
+    uint16_t old = __atomic_load_n(&slot->access, __ATOMIC_RELAXED);
+    uint16_t access = evict == MK_EVICT_LRU ? lru_clock() : lfu_touch(old, mk_now_ms() / 60000);
+    if (access != old) __atomic_store_n(&slot->access, access, __ATOMIC_RELAXED);
+}
+
+// 回收分片中已经安全的对象：先尝试推进 epoch，再释放列表开头足够旧的对象
+static void reclaim(mk_t* kv) {
+    mk_shard_t* shard = kv->owner;
+    mk_ebr_try_advance();
+    size_t n = 0;
+    while (n < shard->retired_count && mk_ebr_can_free(shard->retired[n].epoch)) {
+        mk_retired_t* r = &shard->retired[n++];
+        if (r->cls == MK_RETIRED_ARRAY) free(r->ptr);
+        else mk_slab_free(&kv->slab, r->ptr, (uint8_t)r->cls);
+    }
+    shard->retired_count -= n;
+    memmove(shard->retired, shard->retired + n, shard->retired_count * sizeof(mk_retired_t));
+}
+
+// 延迟释放：对象已经从表中摘下，但无锁读线程可能还在访问
+// 记下当前 epoch 挂到分片的待回收列表，等读线程全部离开后再释放
+static void retire(mk_t* kv, void* ptr, int cls) {
+    mk_shard_t* shard = kv->owner;
+    if (shard->retired_count == shard->retired_cap) {
+        size_t cap = shard->retired_cap ? shard->retired_cap * 2 : MK_RETIRE_BATCH;
+        mk_retired_t* bigger = (mk_retired_t*)realloc(shard->retired, cap * sizeof(mk_retired_t));
+        // 内存不足时放弃回收：节点在销毁时随 slab 整体释放，槽位数组只能泄漏
+        if (!bigger) return;
+        shard->retired = bigger;
+        shard->retired_cap = cap;
     }
+    mk_retired_t* r = &shard->retired[shard->retired_count++];
+    r->ptr = ptr;
+    r->epoch = mk_ebr_retire_epoch();
+    r->cls = cls;
+    if (shard->retired_count % MK_RETIRE_BATCH == 0) reclaim(kv);
+}
+
+// 释放单个节点，块归还给 slab
+// mmap 快照中的节点不需要释放，映射在实例销毁时整体解除
+// 分片中的节点可能正被无锁读线程访问，改为延迟回收
+static void free_node(mk_t* kv, mk_node_t* node) {
+    if (node->cls == MK_NODE_MAPPED) return;
+    if (kv->owner) retire(kv, node, node->cls);
+    else mk_slab_free(&kv->slab, node, node->cls);
+}
+
+// 写入槽位；分片的读线程可能同时在读，逐个字段原子写入，节点指针以 release 发布
+// 普通实例中这些原子写和普通写生成的指令相同
+static void store_slot(mk_slot_t* dst, mk_slot_t src) {
+    __atomic_store_n(&dst->hash, src.hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->dist, src.dist, __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->access, src.access, __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->node, src.node, __ATOMIC_RELEASE);
+}
+
+// 读取槽位；访问信息可能正被无锁读线程更新，原子读取
+static mk_slot_t load_slot(const mk_slot_t* src) {
+    mk_slot_t slot = { src->hash, src->dist, __atomic_load_n(&src->access, __ATOMIC_RELAXED), src->node };
+    return slot;
+}
+
+// 更新表头，分片的读线程会在 seq 的保护下无锁读取
+static void set_table(mk_table_t* t, mk_slot_t* slots, size_t capacity) {
+    __atomic_store_n(&t->slots, slots, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->capacity, capacity, __ATOMIC_RELAXED);
+}
+
+// 开始一次结构修改：分片的 seq 变为奇数，期间的无锁读会重试
+// 覆盖已有 key 只是原子替换节点指针，不需要调用
+static void write_begin(mk_t* kv) {
+    if (!kv->owner) return;
+    __atomic_store_n(&kv->owner->seq, kv->owner->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// 结束结构修改，seq 恢复为偶数
+static void write_end(mk_t* kv) {
+    if (!kv->owner) return;
+    __atomic_store_n(&kv->owner->seq, kv->owner->seq + 1, __ATOMIC_RELEASE);
+}
+
+// 在单张表中查找 key 所在的槽位下标，找不到返回 -1
+// Robin Hood 保证同一簇内的探测距离单调，遇到比当前距离更短的槽即可提前结束
+static long find_slot(const mk_table_t* t, const char* key, size_t klen, uint64_t hash) {
+    size_t mask = t->capacity - 1;
+    size_t idx = slot_index(t->capacity, hash);
+    uint32_t dist = 1;
+    while (1) {
+        const mk_slot_t* slot = &t->slots[idx];
+        // 空槽（dist为0）或者对方比我们更靠近理想位置，说明 key 不存在
+        if (slot->dist < dist) return -1;
+        // 依次比较指纹、完整哈希、长度，全部相同才比较 key 内容
+        if (slot->hash == (uint32_t)hash) {
+            const mk_node_t* node = slot->node;
+            if (node->hash == hash && node->klen == klen && memcmp(NODE_KEY(node), key, klen) == 0) {
+                return (long)idx;
+            }
+        }
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+}
+
+// 在新旧两张表中查找 key，找到时通过 table_out 返回所在的表
+static mk_slot_t* find_entry(const mk_t* kv, const char* key, size_t klen, uint64_t hash, mk_table_t** table_out) {
+    const mk_table_t* tables[2] = { &kv->table, &kv->old };
+    for (int i = 0; i < 2; i++) {
+        // 没有进行中的迁移时跳过旧表
+        if (!tables[i]->slots) continue;
+        long idx = find_slot(tables[i], key, klen, hash);
+        if (idx >= 0) {
+            if (table_out) *table_out = (mk_table_t*)tables[i];
+            return &tables[i]->slots[idx];
+        }
+    }
+    return NULL;
+}
+
+// 把节点插入槽位数组（调用方保证 key 不存在且有空槽）
+// Robin Hood：遇到探测距离比自己短的“富”槽位就交换，继续为被换出的节点找位置
+// 哈希值取自节点本身，访问信息随节点一起搬动
+static void insert_slot(mk_table_t* t, mk_node_t* node, uint16_t access) {
+    size_t mask = t->capacity - 1;
+    size_t idx = slot_index(t->capacity, node->hash);
+    mk_slot_t carry = { (uint32_t)node->hash, 1, access, node };
+    while (t->slots[idx].dist != 0) {
+        if (t->slots[idx].dist < carry.dist) {
+            mk_slot_t tmp = load_slot(&t->slots[idx]);
+            store_slot(&t->slots[idx], carry);
+            carry = tmp;
+        }
+        idx = (idx + 1) & mask;
+        carry.dist++;
+    }
+    store_slot(&t->slots[idx], carry);
+}
+
+// 删除槽位后向前回填（backward shift），保持探测序列连续，无需墓碑标记
+static void remove_slot(mk_table_t* t, mk_slot_t* slot) {
+    size_t mask = t->capacity - 1;
+    size_t idx = (size_t)(slot - t->slots);
+    while (1) {
+        size_t next = (idx + 1) & mask;
+        // 下一个槽为空或者已在理想位置，回填结束
+        if (t->slots[next].dist <= 1) break;
+        mk_slot_t moved = load_slot(&t->slots[next]);
+        moved.dist--;
+        store_slot(&t->slots[idx], moved);
+        idx = next;
+    }
+    store_slot(&t->slots[idx], (mk_slot_t){ 0, 0, 0, NULL });
+}
+
+// 渐进式迁移：把旧表中最多 max_nodes 个节点搬到新表
+// 只在簇的边界（空槽或位于理想位置的槽）停下，这样旧表剩余部分仍是合法的
+// Robin Hood 表：被搬空的前缀不会截断任何尚未迁移节点的探测序列
+static void rehash_step(mk_t* kv, size_t max_nodes) {
+    if (!kv->old.slots) return;
+    uint64_t start = monotonic_ns();
+    write_begin(kv);
+    size_t empty_visits = MK_REHASH_EMPTY_VISITS;
+    while (kv->rehash_idx < kv->old.capacity) {
+        mk_slot_t* slot = &kv->old.slots[kv->rehash_idx];
+        // 到达簇边界且本次额度已用完，停止
+        if (slot->dist <= 1 && (max_nodes == 0 || empty_visits == 0)) break;
+        if (slot->dist == 0) {
+            empty_visits--;
+        } else {
+            // 直接复用节点中保存的哈希值插入新表
+            insert_slot(&kv->table, slot->node, __atomic_load_n(&slot->access, __ATOMIC_RELAXED));
+            store_slot(slot, (mk_slot_t){ 0, 0, 0, NULL });
+            if (max_nodes > 0) max_nodes--;
+        }
+        kv->rehash_idx++;
+    }
+    // 旧表全部迁移完毕，释放旧槽位数组
+    if (kv->rehash_idx >= kv->old.capacity) {
+        mk_slot_t* old_slots = kv->old.slots;
+        kv->memory -= kv->old.capacity * sizeof(mk_slot_t);
+        set_table(&kv->old, NULL, 0);
+        kv->rehash_idx = 0;
+        if (kv->owner) retire(kv, old_slots, MK_RETIRED_ARRAY);
+        else free(old_slots);
+    }
+    write_end(kv);
+    kv->resize_ns += monotonic_ns() - start;
+}
+
+// 扩容哈希表
+// 参数为哈希表指针kv和新的槽位数量（2 的幂）
+// 只分配新表并把当前表挂为旧表，节点迁移由之后的写操作分摊完成
+static int mk_resize(mk_t* kv, size_t new_capacity) {
+    if (!kv) return -1;
+    uint64_t timer = mk_latency_begin(kv);
+    // 上一轮迁移尚未完成（写入速度超过迁移速度），先一次性完成它
+    while (kv->old.slots) rehash_step(kv, SIZE_MAX);
+    uint64_t start = monotonic_ns();
+    // 同样calloc分配新槽位数组
+    mk_slot_t* new_slots = (mk_slot_t*)calloc(new_capacity, sizeof(mk_slot_t));
+    if (!new_slots) {
+        // 分配失败前可能已经完成了上一轮迁移，这段停顿照样记下
+        mk_latency_end(kv, MK_OP_RESIZE, timer);
+        return -2;
+    }
+    kv->memory += new_capacity * sizeof(mk_slot_t);
+    // 当前表变为旧表，从下标 0 开始迁移
+    write_begin(kv);
+    set_table(&kv->old, kv->table.slots, kv->table.capacity);
+    kv->rehash_idx = 0;
+    // 更新哈希表结构体的槽位指针和槽位数量
+    set_table(&kv->table, new_slots, new_capacity);
+    write_end(kv);
+    kv->resizes++;
+    kv->resize_ns += monotonic_ns() - start;
+    mk_latency_end(kv, MK_OP_RESIZE, timer);
+    return 0;
 }
 
 // 销毁kv哈希表
 void mk_destroy(mk_t* kv) {
     if (!kv) return;
-    // 遍历桶指针数组，释放每个桶的链表
-    for (size_t i = 0; i < kv->bucket_count; i++) {
-        free_bucket_list(kv->buckets[i]);
+    // 等后台保存的子进程结束，避免留下僵尸进程
+    mk_bgsave_cleanup(kv);
+    // 关闭日志，按策略落盘
+    mk_log_close(kv);
+    // 节点全部来自 slab，整页释放即可，无需逐个遍历
+    mk_slab_destroy(&kv->slab);
+    // 释放新旧两张表的槽位数组
+    free(kv->table.slots);
+    free(kv->old.slots);
+    // 并发实例逐个销毁分片，必须在解除映射之前
+    // 待回收的节点随分片的 slab 一起释放，槽位数组单独释放
+    if (kv->shards) {
+        for (size_t i = 0; i <= kv->shard_mask; i++) {
+            mk_shard_t* shard = &kv->shards[i];
+            mk_destroy(shard->kv);
+            for (size_t j = 0; j < shard->retired_count; j++) {
+                if (shard->retired[j].cls == MK_RETIRED_ARRAY) free(shard->retired[j].ptr);
+            }
+            free(shard->retired);
+            pthread_rwlock_destroy(&shard->lock);
+        }
+        free(kv->shards);
     }
-    // 释放桶指针数组
-    free(kv->buckets);
+    // 索引属于实例，分片只是共用
+    if (!kv->owner) mk_index_destroy(kv->index);
+    if (!kv->owner) free(kv->latency);
+    mk_wheel_destroy(kv->wheel);
+    // 解除快照映射
+    mk_snapshot_release(kv);
+    pthread_mutex_destroy(&kv->bgsave.lock);
+    pthread_mutex_destroy(&kv->meta_lock);
     // 释放哈希表实例
     free(kv);
 }
 
+// 节点替换 old 之后同步时间轮：有过期时间的登记或更新定时器，没有的摘下 old 原来的定时器
+// 时间轮在第一次遇到带过期时间的节点时创建；登记失败不影响写入，过期的节点读取时照样不可见，只是要等下次覆盖或删除才回收
+static void sync_expire(mk_t* kv, const mk_node_t* old, mk_node_t* node) {
+    if (node->flags & MK_NODE_EXPIRES) {
+        if (!kv->wheel) kv->wheel = mk_wheel_create(mk_now_ms());
+        if (kv->wheel) mk_wheel_set(kv->wheel, old, node, mk_node_expire(node));
+    } else if (kv->wheel && old) {
+        mk_wheel_remove(kv->wheel, old);
+    }
+}
+
+// 在单个实例的表中写入键值对，不做参数校验也不写日志
+// 调用方已经算好 key 的长度和哈希；expire_at 为 0 表示不过期
+static int set_entry(mk_t* kv, const char* key, size_t klen, uint64_t hash,
+                     const char* value, size_t vlen, uint64_t expire_at) {
+    // 每次写操作顺带迁移一小批旧表节点
+    rehash_step(kv, MK_REHASH_STEP);
+    // 检查是否已存在该key，存在则更新value
+    mk_slot_t* slot = find_entry(kv, key, klen, hash, NULL);
+    if (slot) {
+        mk_node_t* current = slot->node;
+        // 新值放得下则原地覆盖，不需要重新分配；快照中的节点只读，总是复制出来
+        // 分片中的节点可能正被无锁读线程访问，同样不能原地修改
+        // 过期时间占用 value 之后的 8 字节，可用空间按新旧节点是否带过期时间重新划分
+        size_t room = current->vcap + ((current->flags & MK_NODE_EXPIRES) ? sizeof(uint64_t) : 0);
+        size_t tail = expire_at ? sizeof(uint64_t) : 0;
+        if (current->cls != MK_NODE_MAPPED && !kv->owner && vlen + tail <= room) {
+            memcpy(NODE_VALUE(current), value, vlen);
+            NODE_VALUE(current)[vlen] = '\0';
+            current->vlen = (uint32_t)vlen;
+            current->vcap = (uint32_t)(room - tail);
+            current->flags = expire_at ? MK_NODE_EXPIRES : 0;
+            if (expire_at) memcpy(NODE_EXPIRE(current), &expire_at, sizeof(expire_at));
+            sync_expire(kv, current, current);
+            touch_slot(kv, slot);
+            return 0;
+        }
+        // 否则分配新节点，原子替换槽位中的指针后释放旧节点
+        mk_node_t* bigger = mk_node_new(&kv->slab, key, klen, hash, value, vlen, expire_at);
+        if (!bigger) return -1;
+        __atomic_store_n(&slot->node, bigger, __ATOMIC_RELEASE);
+        if (kv->index) mk_index_replace(kv->index, bigger);
+        sync_expire(kv, current, bigger);
+        touch_slot(kv, slot);
+        kv->memory += node_bytes(bigger) - node_bytes(current);
+        free_node(kv, current);
+        return 0;
+    }
+    // 简单的负载因子检查，插入后超过0.75则先扩容，保证总有空槽
+    // 每次写至少推进 MK_REHASH_STEP 个旧槽位，新表达到阈值前旧表通常已迁移完
+    if ((kv->count + 1) > (kv->table.capacity * 3) / 4) {
+        if (mk_resize(kv, kv->table.capacity * 2) != 0) return -1;
+    }
+    // 到这里说明key不存在，创建新节点并插入
+    mk_node_t* new_node = mk_node_new(&kv->slab, key, klen, hash, value, vlen, expire_at);
+    if (!new_node) return -1;
+    // 节点还没有发布，索引插入失败时直接归还
+    if (kv->index && mk_index_insert(kv->index, new_node) != 0) {
+        mk_slab_free(&kv->slab, new_node, new_node->cls);
+        return -1;
+    }
+    write_begin(kv);
+    insert_slot(&kv->table, new_node, initial_access(kv));
+    // 更新键值对数量和占用的内存
+    kv->count++;
+    kv->memory += node_bytes(new_node);
+    write_end(kv);
+    if (expire_at) sync_expire(kv, NULL, new_node);
+    return 0;
+}
+
+// 写入键值对的内部实现，并发实例中锁住 key 所在的分片
+int mk_set_entry(mk_t* kv, const char* key, size_t klen, uint64_t hash,
+                 const char* value, size_t vlen, uint64_t expire_at) {
+    mk_t* target = lock_write(kv, hash);
+    int ret = set_entry(target, key, klen, hash, value, vlen, expire_at);
+    unlock_hash(kv, hash);
+    return ret;
+}
+
+// 直接把现成的节点放入单个实例的表中，key 已存在则替换旧节点
+static int put_node(mk_t* kv, mk_node_t* node) {
+    rehash_step(kv, MK_REHASH_STEP);
+    mk_slot_t* slot = find_entry(kv, NODE_KEY(node), node->klen, node->hash, NULL);
+    if (slot) {
+        mk_node_t* current = slot->node;
+        __atomic_store_n(&slot->node, node, __ATOMIC_RELEASE);
+        if (kv->index) mk_index_replace(kv->index, node);
+        sync_expire(kv, current, node);
+        touch_slot(kv, slot);
+        kv->memory += node_bytes(node) - node_bytes(current);
+        free_node(kv, current);
+        return 0;
+    }
+    if ((kv->count + 1) > (kv->table.capacity * 3) / 4) {
+        if (mk_resize(kv, kv->table.capacity * 2) != 0) return -1;
+    }
+    if (kv->index && mk_index_insert(kv->index, node) != 0) return -1;
+    write_begin(kv);
+    insert_slot(&kv->table, node, initial_access(kv));
+    kv->count++;
+    kv->memory += node_bytes(node);
+    write_end(kv);
+    sync_expire(kv, NULL, node);
+    return 0;
+}
+
+// 把现成的节点放入表中
+// 并发实例中来自实例 slab 的节点先复制到所属分片的 slab，之后才能由分片正常释放
+int mk_put_node(mk_t* kv, mk_node_t* node) {
+    if (!kv->shards) return put_node(kv, node);
+    uint64_t hash = node->hash;
+    mk_t* target = lock_write(kv, hash);
+    if (node->cls != MK_NODE_MAPPED) {
+        mk_node_t* copy = mk_node_new(&target->slab, NODE_KEY(node), node->klen, hash, NODE_VALUE(node), node->vlen,
+                                      mk_node_expire(node));
+        // 实例 slab 被所有分片共用，归还时需要加锁
+        lock_meta(kv);
+        mk_slab_free(&kv->slab, node, node->cls);
+        unlock_meta(kv);
+        node = copy;
+    }
+    int ret = node ? put_node(target, node) : -1;
+    unlock_hash(kv, hash);
+    return ret;
+}
+
+// 预留槽位：一次性扩到能容纳 n 个键值对的大小并同步完成迁移
+// 批量加载本来就是整体操作，同步迁移可以省掉之后每次写入的迁移开销
+static int reserve(mk_t* kv, size_t n) {
+    size_t capacity = kv->table.capacity;
+    while (n > (capacity * 3) / 4) {
+        // n 来自文件头等外部输入，翻倍溢出或槽位数组的字节数超出 size_t 时直接失败
+        if (capacity > SIZE_MAX / 2 / sizeof(mk_slot_t)) return -1;
+        capacity *= 2;
+    }
+    if (capacity == kv->table.capacity) return 0;
+    if (mk_resize(kv, capacity) != 0) return -1;
+    while (kv->old.slots) rehash_step(kv, SIZE_MAX);
+    return 0;
+}
+
+// 预留槽位，并发实例按分片平均分摊并留出余量应对分布不均
+int mk_reserve(mk_t* kv, size_t n) {
+    if (!kv->shards) return reserve(kv, n);
+    size_t per = n / (kv->shard_mask + 1);
+    if (per > SIZE_MAX / 2) return -1;
+    per += per / 8 + 16;
+    int ret = 0;
+    for (size_t i = 0; i <= kv->shard_mask; i++) {
+        pthread_rwlock_wrlock(&kv->shards[i].lock);
+        if (reserve(kv->shards[i].kv, per) != 0) ret = -1;
+        pthread_rwlock_unlock(&kv->shards[i].lock);
+    }
+    return ret;
+}
+
+// 大量删除后缩容：负载低于 1/MK_SHRINK_RATIO 时缩到负载约 1/4，不小于初始容量
+// 与扩容一样只换表，节点由之后的写操作渐进迁移；迁移中不再触发新的缩容
+// 缩容失败（内存不足）不影响删除本身
+static void shrink(mk_t* kv) {
+    if (kv->old.slots || kv->table.capacity <= MK_INITIAL_CAPACITY) return;
+    if (kv->count >= kv->table.capacity / MK_SHRINK_RATIO) return;
+    size_t capacity = kv->table.capacity / 2;
+    while (capacity > MK_INITIAL_CAPACITY && kv->count < capacity / MK_SHRINK_RATIO) capacity /= 2;
+    mk_resize(kv, capacity);
+}
+
+// 删除键值对的内部实现，删除了返回 1，key 不存在返回 0
+// 已经过期的 key 同样会被删除，但按不存在返回 0
+static int del_entry(mk_t* kv, const char* key, size_t klen, uint64_t hash) {
+    rehash_step(kv, MK_REHASH_STEP);
+    mk_table_t* table = NULL;
+    mk_slot_t* slot = find_entry(kv, key, klen, hash, &table);
+    if (!slot) return 0;
+    // 释放当前节点
+    mk_node_t* node = slot->node;
+    write_begin(kv);
+    remove_slot(table, slot);
+    // 更新键值对数量和占用的内存
+    kv->count--;
+    kv->memory -= node_bytes(node);
+    write_end(kv);
+    // 先从索引摘下，有序遍历不会再读到它
+    if (kv->index) mk_index_remove(kv->index, node);
+    if (kv->wheel) mk_wheel_remove(kv->wheel, node);
+    int live = !mk_node_expired(node);
+    free_node(kv, node);
+    shrink(kv);
+    return live;
+}
+
+// 时间轮的到期回调：定时器已经摘下，删除节点
+static void expire_node(mk_node_t* node, void* user_data) {
+    del_entry((mk_t*)user_data, NODE_KEY(node), node->klen, node->hash);
+}
+
+// 回收单个实例中到 now 为止过期的 key，最多 max 个
+// 过期不写日志：重放时 key 带着过期时间恢复，加载完成后同样会被回收
+static size_t expire_due(mk_t* kv, uint64_t now, size_t max) {
+    if (!kv->wheel || mk_wheel_count(kv->wheel) == 0) return 0;
+    return mk_wheel_advance(kv->wheel, now, max, expire_node, kv);
+}
+
+// 淘汰取样：随机取 MK_EVICT_SAMPLES 个非空槽位，返回其中最该淘汰的节点
+// 每个样本在随机位置上试探，空槽就换一个随机位置，不向后找：向后找时前面空位多的 key 更容易被取到，
+// 热点 key 周围的冷 key 被淘汰后空位变多，热点反而越来越容易被取样淘汰；连续取样同理会取到聚在一起的热点
+// 试探 MK_EVICT_PROBES 次都是空槽（表中 key 很少）时才从最后的位置向后找
+// LRU 选空闲最久的，LFU 选衰减后计数最小的；已经过期的节点直接选中；keep 不参与取样
+// 迁移期间随机选一张表取样，表中只剩 keep 时返回 NULL
+static mk_node_t* pick_victim(mk_t* kv, const mk_node_t* keep) {
+    int evict = kv->evict;
+    uint64_t now = mk_now_ms();
+    uint16_t clock = (uint16_t)(now / 1000);
+    mk_node_t* victim = NULL;
+    unsigned best = 0;
+    for (int n = 0; n < MK_EVICT_SAMPLES; n++) {
+        mk_table_t* t = kv->old.slots && (next_random() & 1) ? &kv->old : &kv->table;
+        if (!t->slots) continue;
+        size_t mask = t->capacity - 1;
+        size_t idx = 0;
+        mk_slot_t* slot = NULL;
+        for (int probe = 0; probe < MK_EVICT_PROBES && !slot; probe++) {
+            idx = (size_t)next_random() & mask;
+            if (t->slots[idx].dist != 0 && t->slots[idx].node != keep) slot = &t->slots[idx];
+        }
+        for (size_t i = 0; i <= mask && !slot; i++, idx = (idx + 1) & mask) {
+            if (t->slots[idx].dist != 0 && t->slots[idx].node != keep) slot = &t->slots[idx];
+        }
+        if (!slot) continue;
+        if (mk_node_expired(slot->node)) return slot->node;
+        uint16_t access = __atomic_load_n(&slot->access, __ATOMIC_RELAXED);
+        // 分数越大越该淘汰
+        unsigned score = evict == MK_EVICT_LRU ? (uint16_t)(clock - access)
+                                               : 255 - lfu_counter(access, now / 60000);
+        if (!victim || score > best) {
+            victim = slot->node;
+            best = score;
+        }
+    }
+    return victim;
+}
+
+// 淘汰 target 中的 key 直到占用回到上限以内，keep 是刚写入的节点，不会被淘汰
+// 日志模式下先追加删除记录再删除，重放时被淘汰的 key 不会复活
+static int evict_until_fit(mk_t* kv, mk_t* target, const mk_node_t* keep) {
+    int ret = 0;
+    while (target->memory > target->maxmemory) {
+        mk_node_t* victim = pick_victim(target, keep);
+        if (!victim) break;
+        lock_meta(kv);
+        if (kv->aof && mk_aof_append_del(kv->aof, NODE_KEY(victim), victim->klen) != 0) ret = -3;
+        unlock_meta(kv);
+        del_entry(target, NODE_KEY(victim), victim->klen, victim->hash);
+    }
+    return ret;
+}
+
+// 写入键值对并记日志，调用方已经校验过 key 并算好哈希
+// 写操作顺带回收所在实例（分片）中少量到期的 key，过期回收的开销分摊到各次写入
+static int set_hashed(mk_t* kv, const char* key, size_t klen, uint64_t hash,
+                      const char* value, size_t vlen, uint64_t expire_at) {
+    uint64_t timer = mk_latency_begin(kv);
+    mk_t* target = lock_write(kv, hash);
+    if (target->wheel) expire_due(target, mk_now_ms(), MK_EXPIRE_STEP);
+    int ret = set_entry(target, key, klen, hash, value, vlen, expire_at) != 0 ? -1 : 0;
+    // 日志模式下追加一条 set 记录，带过期时间的写成单独的记录
+    // 仍然持有分片锁，同一个 key 的日志顺序与内存中的修改顺序一致
+    if (ret == 0) {
+        lock_meta(kv);
+        if (kv->aof) {
+            int failed = expire_at ? mk_aof_append_set_ex(kv->aof, key, klen, value, vlen, expire_at)
+                                   : mk_aof_append_set(kv->aof, key, klen, value, vlen);
+            if (failed) ret = -3;
+        }
+        unlock_meta(kv);
+    }
+    // 超过内存上限时淘汰其他 key，先把刚写入的节点找出来排除在外
+    if (ret != -1 && target->maxmemory && target->memory > target->maxmemory) {
+        mk_slot_t* slot = find_entry(target, key, klen, hash, NULL);
+        if (evict_until_fit(kv, target, slot ? slot->node : NULL) != 0) ret = -3;
+    }
+    unlock_hash(kv, hash);
+    mk_latency_end(kv, MK_OP_SET, timer);
+    return ret;
+}
+
+// 设置内存上限，并发实例平分到各分片；新上限更低时立即淘汰
+int mk_set_maxmemory(mk_t* kv, size_t bytes, mk_evict_t policy) {
+    if (!kv || (policy != MK_EVICT_LRU && policy != MK_EVICT_LFU)) return -1;
+    int ret = 0;
+    if (!kv->shards) {
+        kv->maxmemory = bytes;
+        kv->evict = bytes ? (int)policy : 0;
+        if (bytes) ret = evict_until_fit(kv, kv, NULL);
+        return ret;
+    }
+    size_t per = bytes / (kv->shard_mask + 1);
+    // 上限太小时每个分片至少 1 字节，仍然算开启
+    if (bytes && per == 0) per = 1;
+    for (size_t i = 0; i <= kv->shard_mask; i++) {
+        mk_t* shard = kv->shards[i].kv;
+        pthread_rwlock_wrlock(&kv->shards[i].lock);
+        shard->maxmemory = per;
+        __atomic_store_n(&shard->evict, bytes ? (int)policy : 0, __ATOMIC_RELAXED);
+        if (per && evict_until_fit(kv, shard, NULL) != 0) ret = -3;
+        pthread_rwlock_unlock(&kv->shards[i].lock);
+    }
+    kv->maxmemory = bytes;
+    kv->evict = bytes ? (int)policy : 0;
+    return ret;
+}
+
+// 节点和槽位数组占用的字节数，并发实例累加各分片
+size_t mk_memory_usage(const mk_t* kv) {
+    if (!kv) return 0;
+    size_t total = kv->memory;
+    for (size_t i = 0; kv->shards && i <= kv->shard_mask; i++) {
+        pthread_rwlock_rdlock(&kv->shards[i].lock);
+        total += kv->shards[i].kv->memory;
+        pthread_rwlock_unlock(&kv->shards[i].lock);
+    }
+    return total;
+}
+
+// 把一张表中的槽位和节点累加到统计中，probe_sum 累计探测长度之和
+static void table_stats(const mk_table_t* t, mk_stats_t* out, size_t* probe_sum) {
+    if (!t->slots) return;
+    out->buckets += t->capacity;
+    out->bucket_bytes += t->capacity * sizeof(mk_slot_t);
+    for (size_t i = 0; i < t->capacity; i++) {
+        const mk_slot_t* slot = &t->slots[i];
+        if (slot->dist == 0) continue;
+        const mk_node_t* node = slot->node;
+        size_t probe = slot->dist;
+        if (probe > out->max_probe) out->max_probe = probe;
+        *probe_sum += probe;
+        out->probe_hist[probe < MK_STATS_PROBE_BUCKETS ? probe - 1 : MK_STATS_PROBE_BUCKETS - 1]++;
+        out->key_bytes += node->klen;
+        out->value_bytes += node->vlen;
+        out->header_bytes += offsetof(mk_node_t, data);
+        out->node_bytes += node_bytes(node);
+    }
+}
+
+// 累加单个实例（或分片）的统计，负载因子和平均值由调用方最后计算
+static void collect_stats(const mk_t* kv, mk_stats_t* out, size_t* probe_sum, size_t* capacity) {
+    out->count += kv->count;
+    out->memory += kv->memory;
+    out->resizes += kv->resizes;
+    out->resize_us += kv->resize_ns / 1000;
+    *capacity += kv->table.capacity;
+    table_stats(&kv->table, out, probe_sum);
+    table_stats(&kv->old, out, probe_sum);
+}
+
+// 收集统计信息，并发实例逐个分片持读锁汇总
+int mk_stats(const mk_t* kv, mk_stats_t* out) {
+    if (!kv || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    size_t probe_sum = 0;
+    size_t capacity = 0;
+    if (kv->shards) {
+        // 并发实例自身的表不存放数据，只计入它占用的内存
+        out->memory = kv->memory;
+        for (size_t i = 0; i <= kv->shard_mask; i++) {
+            pthread_rwlock_rdlock(&kv->shards[i].lock);
+            collect_stats(kv->shards[i].kv, out, &probe_sum, &capacity);
+            pthread_rwlock_unlock(&kv->shards[i].lock);
+        }
+    } else {
+        collect_stats(kv, out, &probe_sum, &capacity);
+    }
+    // 保存总是由实例本身发起，计数记在实例上
+    out->saves = __atomic_load_n(&kv->saves, __ATOMIC_RELAXED);
+    out->save_bytes = __atomic_load_n(&kv->save_bytes, __ATOMIC_RELAXED);
+    out->save_us = __atomic_load_n(&kv->save_ns, __ATOMIC_RELAXED) / 1000;
+    uint64_t last_ns = __atomic_load_n(&kv->last_save_ns, __ATOMIC_RELAXED);
+    if (last_ns) {
+        out->last_save_mb_per_sec = (double)__atomic_load_n(&kv->last_save_bytes, __ATOMIC_RELAXED) /
+                                    (1024.0 * 1024.0) / ((double)last_ns / 1e9);
+    }
+    size_t live = out->count;
+    if (capacity) out->load_factor = (double)live / (double)capacity;
+    if (live) out->avg_probe = (double)probe_sum / (double)live;
+    return 0;
+}
+
+// 删除键值对并记日志，通过 deleted 返回是否真的删除了
+static int del_hashed(mk_t* kv, const char* key, size_t klen, uint64_t hash, int* deleted) {
+    uint64_t timer = mk_latency_begin(kv);
+    mk_t* target = lock_write(kv, hash);
+    int ret = 0;
+    if (target->wheel) expire_due(target, mk_now_ms(), MK_EXPIRE_STEP);
+    *deleted = del_entry(target, key, klen, hash);
+    // 只有真的删掉了才需要记日志
+    if (*deleted) {
+        lock_meta(kv);
+        if (kv->aof && mk_aof_append_del(kv->aof, key, klen) != 0) ret = -3;
+        unlock_meta(kv);
+    }
+    unlock_hash(kv, hash);
+    mk_latency_end(kv, MK_OP_DEL, timer);
+    return ret;
+}
+
 // 设置键值对
 int mk_set(mk_t* kv, const char* key, const char* value) {
     // 参数缺失输出-1，无效key输出-2
     if (!kv || !key || !value) return -1;
     if (!is_valid_key(key)) return -2;
-    // 计算桶索引
-    size_t idx = bucket_index(kv, key);
-    // 遍历链表检查是否已存在该key，存在则更新value
-    mk_node_t* current = kv->buckets[idx];
-    while (current) {
-        if (strcmp(current->key, key) == 0) {
-            // 防止value被销毁，用strdup复制一份
-            char* new_val = strdup(value);
-            if (!new_val) return -1;
-            // 释放旧value，更新为新value
-            free(current->value);
-            current->value = new_val;
-            // 找到并更新成功返回0，否则在之后创建新节点
-            return 0;
+    size_t klen;
+    uint64_t hash = mk_hash_key(kv, key, &klen);
+    return set_hashed(kv, key, klen, hash, value, strlen(value), 0);
+}
+
+// 设置带过期时间的键值对，过期时刻按当前时间换算成绝对时间
+int mk_set_ex(mk_t* kv, const char* key, const char* value, uint64_t ttl_ms) {
+    if (!kv || !key || !value) return -1;
+    uint64_t now = mk_now_ms();
+    if (ttl_ms == 0 || ttl_ms > UINT64_MAX - now) return -1;
+    if (!is_valid_key(key)) return -2;
+    size_t klen;
+    uint64_t hash = mk_hash_key(kv, key, &klen);
+    return set_hashed(kv, key, klen, hash, value, strlen(value), now + ttl_ms);
+}
+
+// 无锁地在单张表中查找，读到的槽位可能正被写线程移动
+// 这里只保证内存访问安全（槽位数组和节点都延迟回收），结果由调用方用 seq 校验
+// 找到时通过 slot_out 返回所在的槽位
+static const mk_node_t* probe_lockfree(mk_slot_t* slots, size_t capacity, const char* key, size_t klen, uint64_t hash,
+                                       mk_slot_t** slot_out) {
+    if (!slots) return NULL;
+    size_t mask = capacity - 1;
+    size_t idx = slot_index(capacity, hash);
+    // 读到不一致的中间状态时探测序列可能不会正常结束，最多走一圈
+    for (uint32_t dist = 1; dist <= capacity; dist++) {
+        mk_slot_t* slot = &slots[idx];
+        if (__atomic_load_n(&slot->dist, __ATOMIC_RELAXED) < dist) return NULL;
+        if (__atomic_load_n(&slot->hash, __ATOMIC_RELAXED) == (uint32_t)hash) {
+            const mk_node_t* node = __atomic_load_n(&slot->node, __ATOMIC_ACQUIRE);
+            if (node && node->hash == hash && node->klen == klen && memcmp(NODE_KEY(node), key, klen) == 0) {
+                *slot_out = slot;
+                return node;
+            }
         }
-        current = current->next;
+        idx = (idx + 1) & mask;
     }
-    // 到这里说明key不存在，创建新节点并插入链表头
-    mk_node_t* new_node = create_node(key, value);
-    if (!new_node) return -1;
-    // 头插法插入对应的桶
-    new_node->next = kv->buckets[idx];
-    kv->buckets[idx] = new_node;
-    // 更新键值对数量
-    kv->count++;
+    return NULL;
+}
 
-    // 简单的负载因子检查，超过0.75则扩容
-    if (kv->count > (kv->bucket_count * 3) / 4) {
-        mk_resize(kv, kv->bucket_count * 2);
+// 并发实例的无锁查找，调用方已经 pin 住 epoch
+// 先读 seq 和表头，确认表头一致后探测，最后再确认期间没有结构修改，否则重试
+// 覆盖已有 key 不改变 seq，读到的是替换前或替换后的完整节点
+// 开启内存上限时顺便记录这次访问
+static const mk_node_t* get_lockfree(const mk_t* kv, const char* key, size_t klen, uint64_t hash) {
+    mk_shard_t* shard = shard_of(kv, hash);
+    mk_t* s = shard->kv;
+    unsigned spins = 0;
+    while (1) {
+        unsigned long seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            // 写线程正在修改结构，可能已被调度出去，自旋一阵后让出 CPU
+            if (++spins % MK_READ_SPINS == 0) sched_yield();
+            continue;
+        }
+        mk_slot_t* table = __atomic_load_n(&s->table.slots, __ATOMIC_RELAXED);
+        size_t table_cap = __atomic_load_n(&s->table.capacity, __ATOMIC_RELAXED);
+        mk_slot_t* old = __atomic_load_n(&s->old.slots, __ATOMIC_RELAXED);
+        size_t old_cap = __atomic_load_n(&s->old.capacity, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) != seq) continue;
+        mk_slot_t* slot = NULL;
+        const mk_node_t* node = probe_lockfree(table, table_cap, key, klen, hash, &slot);
+        if (!node) node = probe_lockfree(old, old_cap, key, klen, hash, &slot);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == seq) {
+            if (node) touch_slot(s, slot);
+            return node;
+        }
     }
-    return 0;
+}
+
+// 查找 key 所在的节点，已经过期的节点视为不存在
+// 查找是只读操作，不推进迁移和过期回收，它们只由写操作驱动
+static const mk_node_t* lookup_node(const mk_t* kv, const char* key, size_t klen, uint64_t hash) {
+    const mk_node_t* node;
+    // 并发实例不加锁，pin 住 epoch 期间读到的节点不会被释放
+    if (kv->shards) {
+        mk_ebr_pin();
+        node = get_lockfree(kv, key, klen, hash);
+        mk_ebr_unpin();
+    } else {
+        mk_slot_t* slot = find_entry(kv, key, klen, hash, NULL);
+        node = slot ? slot->node : NULL;
+        if (slot) touch_slot(kv, slot);
+    }
+    return node && !mk_node_expired(node) ? node : NULL;
 }
 
 // 根据key获取value
 const char* mk_get(const mk_t* kv, const char* key) {
     if (!kv || !key) return NULL;
-    // 计算出桶索引
-    size_t idx = bucket_index(kv, key);
-    // 遍历链表查找key
-    mk_node_t* current = kv->buckets[idx];
-    while (current) {
-        if (strcmp(current->key, key) == 0) {
-            return current->value;
-        }
-        current = current->next;
-    }
+    uint64_t timer = mk_latency_begin(kv);
+    size_t klen;
+    uint64_t hash = mk_hash_key(kv, key, &klen);
+    const mk_node_t* node = lookup_node(kv, key, klen, hash);
+    mk_latency_end(kv, MK_OP_GET, timer);
     // 找不到返回NULL
-    return NULL;
+    return node ? NODE_VALUE(node) : NULL;
+}
+
+// 按长度获取 value，返回 value 的指针和长度
+int mk_get_n(const mk_t* kv, const char* key, size_t klen, mk_view_t* out) {
+    if (!kv || !key || !out) return -1;
+    uint64_t timer = mk_latency_begin(kv);
+    const mk_node_t* node = lookup_node(kv, key, klen, mk_hash_bytes(kv, key, klen));
+    mk_latency_end(kv, MK_OP_GET, timer);
+    if (!node) {
+        out->data = NULL;
+        out->len = 0;
+        return 0;
+    }
+    out->data = NODE_VALUE(node);
+    out->len = node->vlen;
+    return 1;
+}
+
+// 进入读临界区，并发实例中期间 mk_get 返回的指针保持有效
+void mk_read_begin(const mk_t* kv) {
+    if (kv && kv->shards) mk_ebr_pin();
+}
+
+// 离开读临界区
+void mk_read_end(const mk_t* kv) {
+    if (kv && kv->shards) mk_ebr_unpin();
+}
+
+// 查询剩余存活时间，并发实例中读取节点期间 pin 住 epoch
+long long mk_ttl(const mk_t* kv, const char* key) {
+    if (!kv || !key) return -2;
+    size_t klen;
+    uint64_t hash = mk_hash_key(kv, key, &klen);
+    mk_read_begin(kv);
+    const mk_node_t* node = lookup_node(kv, key, klen, hash);
+    long long ttl = -2;
+    if (node) {
+        uint64_t expire = mk_node_expire(node);
+        uint64_t now = mk_now_ms();
+        // lookup_node 之后时钟可能刚好走过过期时刻
+        if (!expire) ttl = -1;
+        else if (expire > now) ttl = (long long)(expire - now);
+    }
+    mk_read_end(kv);
+    return ttl;
+}
+
+// 回收所有到期的 key，并发实例逐个分片持有写锁回收
+size_t mk_expire(mk_t* kv) {
+    if (!kv) return 0;
+    uint64_t now = mk_now_ms();
+    if (!kv->shards) return expire_due(kv, now, SIZE_MAX);
+    size_t expired = 0;
+    for (size_t i = 0; i <= kv->shard_mask; i++) {
+        pthread_rwlock_wrlock(&kv->shards[i].lock);
+        expired += expire_due(kv->shards[i].kv, now, SIZE_MAX);
+        pthread_rwlock_unlock(&kv->shards[i].lock);
+    }
+    return expired;
 }
 
 // 删除键值对
 int mk_del(mk_t* kv, const char* key) {
     if (!kv || !key) return -1;
-    size_t idx = bucket_index(kv, key);
-    mk_node_t* current = kv->buckets[idx];
-    mk_node_t* prev = NULL;
-
-    while (current) {
-        if (strcmp(current->key, key) == 0) {
-            // 有前驱节点，更新前驱节点的next指针
-            if (prev) {
-                prev->next = current->next;
-            } 
-            // 没有前驱节点，直接更改头指针
-            else {
-                kv->buckets[idx] = current->next;
+    size_t klen;
+    uint64_t hash = mk_hash_key(kv, key, &klen);
+    int deleted;
+    return del_hashed(kv, key, klen, hash, &deleted);
+}
+
+// 按长度设置键值对，key 和 value 可以是任意字节
+int mk_set_n(mk_t* kv, const char* key, size_t klen, const char* value, size_t vlen) {
+    if (!kv || !key || (!value && vlen > 0)) return -1;
+    // 节点中的长度字段是 32 位
+    if (klen == 0 || klen > UINT32_MAX) return -2;
+    if (vlen > UINT32_MAX) return -1;
+    return set_hashed(kv, key, klen, mk_hash_bytes(kv, key, klen), value ? value : "", vlen, 0);
+}
+
+// 按长度删除键值对
+int mk_del_n(mk_t* kv, const char* key, size_t klen) {
+    if (!kv || !key) return -1;
+    int deleted;
+    return del_hashed(kv, key, klen, mk_hash_bytes(kv, key, klen), &deleted);
+}
+
+// 预取 key 理想槽位所在的缓存行，迁移期间旧表也一起预取
+// 并发实例中表头可能正在变化，预取不会出错，读到旧值只是白白预取一次
+static void prefetch_slot(const mk_t* kv, uint64_t hash) {
+    const mk_t* s = kv->shards ? shard_of(kv, hash)->kv : kv;
+    const mk_table_t* tables[2] = { &s->table, &s->old };
+    for (int i = 0; i < 2; i++) {
+        mk_slot_t* slots = __atomic_load_n(&tables[i]->slots, __ATOMIC_RELAXED);
+        if (!slots) continue;
+        size_t capacity = __atomic_load_n(&tables[i]->capacity, __ATOMIC_RELAXED);
+        __builtin_prefetch(&slots[slot_index(capacity, hash)], 0, 1);
+    }
+}
+
+// 槽位到达缓存后，预取簇内第一个指纹匹配的节点，这是查找中的第二次缓存未命中
+// 并发实例中调用方已经 pin 住 epoch，表头用 seq 确认一致后才读取槽位
+static void prefetch_node(const mk_t* kv, uint64_t hash) {
+    const mk_t* s = kv;
+    unsigned long seq = 0;
+    if (kv->shards) {
+        mk_shard_t* shard = shard_of(kv, hash);
+        s = shard->kv;
+        seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+    }
+    mk_slot_t* slots = __atomic_load_n(&s->table.slots, __ATOMIC_RELAXED);
+    size_t capacity = __atomic_load_n(&s->table.capacity, __ATOMIC_RELAXED);
+    if (kv->shards) {
+        // 结构修改中或表头已经变化，跳过预取
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((seq & 1) || __atomic_load_n(&s->owner->seq, __ATOMIC_RELAXED) != seq) return;
+    }
+    size_t mask = capacity - 1;
+    size_t idx = slot_index(capacity, hash);
+    // 只看理想位置附近的几个槽，大部分 key 都落在这里
+    for (uint32_t dist = 1; dist <= 4; dist++) {
+        mk_slot_t* slot = &slots[idx];
+        if (__atomic_load_n(&slot->dist, __ATOMIC_RELAXED) < dist) return;
+        if (__atomic_load_n(&slot->hash, __ATOMIC_RELAXED) == (uint32_t)hash) {
+            __builtin_prefetch(__atomic_load_n(&slot->node, __ATOMIC_RELAXED), 0, 1);
+            return;
+        }
+        idx = (idx + 1) & mask;
+    }
+}
+
+// 批量读取：每组先计算所有 key 的哈希并预取槽位，再预取节点，最后依次查找
+// 一组内各个 key 的内存访问相互重叠，不必每个 key 都完整等待一次缓存未命中
+int mk_mget(const mk_t* kv, const char* const* keys, size_t n, const char** values) {
+    if (!kv || (n > 0 && (!keys || !values))) return -1;
+    size_t lens[MK_BATCH];
+    uint64_t hashes[MK_BATCH];
+    int found = 0;
+    // 并发实例在整批期间 pin 住 epoch
+    if (kv->shards) mk_ebr_pin();
+    for (size_t i = 0; i < n && i < MK_BATCH; i++) __builtin_prefetch(keys[i], 0, 1);
+    for (size_t base = 0; base < n; base += MK_BATCH) {
+        size_t m = n - base < MK_BATCH ? n - base : MK_BATCH;
+        for (size_t i = 0; i < m; i++) {
+            const char* key = keys[base + i];
+            hashes[i] = key ? mk_hash_key(kv, key, &lens[i]) : 0;
+            if (key) prefetch_slot(kv, hashes[i]);
+            // 顺便预取下一组的 key 字符串，计算哈希时不必等待
+            if (base + MK_BATCH + i < n) __builtin_prefetch(keys[base + MK_BATCH + i], 0, 1);
+        }
+        for (size_t i = 0; i < m; i++) {
+            if (keys[base + i]) prefetch_node(kv, hashes[i]);
+        }
+        for (size_t i = 0; i < m; i++) {
+            const char* key = keys[base + i];
+            const char* value = NULL;
+            if (key && kv->shards) {
+                const mk_node_t* node = get_lockfree(kv, key, lens[i], hashes[i]);
+                value = node && !mk_node_expired(node) ? NODE_VALUE(node) : NULL;
+            } else if (key) {
+                mk_slot_t* slot = find_entry(kv, key, lens[i], hashes[i], NULL);
+                if (slot) touch_slot(kv, slot);
+                value = slot && !mk_node_expired(slot->node) ? NODE_VALUE(slot->node) : NULL;
             }
-            // 释放当前节点
-            free(current->key);
-            free(current->value);
-            free(current);
-            // 更新键值对数量
-            kv->count--;
-            return 0;
+            values[base + i] = value;
+            if (value) found++;
+        }
+    }
+    if (kv->shards) mk_ebr_unpin();
+    return found;
+}
+
+// 批量写入：先校验全部 key，有无效 key 时整批不执行
+// 写入前同样先批量计算哈希并预取槽位
+int mk_mset(mk_t* kv, const char* const* keys, const char* const* values, size_t n) {
+    if (!kv || (n > 0 && (!keys || !values))) return -1;
+    for (size_t i = 0; i < n; i++) {
+        if (!keys[i] || !values[i]) return -1;
+        if (!is_valid_key(keys[i])) return -2;
+    }
+    size_t lens[MK_BATCH];
+    uint64_t hashes[MK_BATCH];
+    for (size_t base = 0; base < n; base += MK_BATCH) {
+        size_t m = n - base < MK_BATCH ? n - base : MK_BATCH;
+        for (size_t i = 0; i < m; i++) {
+            hashes[i] = mk_hash_key(kv, keys[base + i], &lens[i]);
+            prefetch_slot(kv, hashes[i]);
+        }
+        for (size_t i = 0; i < m; i++) {
+            const char* value = values[base + i];
+            int ret = set_hashed(kv, keys[base + i], lens[i], hashes[i], value, strlen(value), 0);
+            if (ret != 0) return ret;
         }
-        // prev设为当前节点，继续遍历
-        prev = current;
-        current = current->next;
     }
     return 0;
 }
 
+// 批量删除，返回实际删除的数量
+int mk_mdel(mk_t* kv, const char* const* keys, size_t n) {
+    if (!kv || (n > 0 && !keys)) return -1;
+    size_t lens[MK_BATCH];
+    uint64_t hashes[MK_BATCH];
+    int removed = 0;
+    for (size_t base = 0; base < n; base += MK_BATCH) {
+        size_t m = n - base < MK_BATCH ? n - base : MK_BATCH;
+        for (size_t i = 0; i < m; i++) {
+            const char* key = keys[base + i];
+            hashes[i] = key ? mk_hash_key(kv, key, &lens[i]) : 0;
+            if (key) prefetch_slot(kv, hashes[i]);
+        }
+        for (size_t i = 0; i < m; i++) {
+            if (!keys[base + i]) continue;
+            int deleted;
+            int ret = del_hashed(kv, keys[base + i], lens[i], hashes[i], &deleted);
+            if (ret != 0) return ret;
+            removed += deleted;
+        }
+    }
+    return removed;
+}
+
+// 重放日志中的 set 记录，已经过期的 key 同样先写入，加载结束时统一回收
+static int replay_set(void* ctx, const char* key, size_t klen, const char* value, size_t vlen, uint64_t expire_at) {
+    mk_t* kv = (mk_t*)ctx;
+    // key 可能含 '\0'，按记录中的长度计算哈希
+    uint64_t hash = mk_hash_bytes(kv, key, klen);
+    return mk_set_entry(kv, key, klen, hash, value, vlen, expire_at);
+}
+
+// 重放日志中的 del 记录
+static int replay_del(void* ctx, const char* key, size_t klen) {
+    mk_t* kv = (mk_t*)ctx;
+    uint64_t hash = mk_hash_bytes(kv, key, klen);
+    mk_t* target = lock_write(kv, hash);
+    del_entry(target, key, klen, hash);
+    unlock_hash(kv, hash);
+    return 0;
+}
+
+// 重放快照对应的日志 "<filepath>.log"
+int mk_replay_log(mk_t* kv, const char* filepath) {
+    char* log_path = mk_path_with_suffix(filepath, ".log");
+    if (!log_path) return -1;
+    int replayed = mk_aof_replay(log_path, replay_set, replay_del, kv);
+    free(log_path);
+    return replayed;
+}
+
+// 生成 "<filepath><suffix>" 形式的路径，调用方负责释放
+char* mk_path_with_suffix(const char* filepath, const char* suffix) {
+    size_t len = strlen(filepath);
+    size_t slen = strlen(suffix);
+    char* path = (char*)malloc(len + slen + 1);
+    if (!path) return NULL;
+    memcpy(path, filepath, len);
+    memcpy(path + len, suffix, slen + 1);
+    return path;
+}
+
+// 保存用的临时文件路径 "<filepath>.<pid>.<n>.tmp"，调用方负责释放
+// 并发实例的保存只持有分片读锁，多个线程可以同时保存到同一路径，序号保证临时文件互不相同
+char* mk_temp_path(const char* filepath) {
+    static unsigned long seq = 0;
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%ld.%lu.tmp", (long)getpid(), __atomic_fetch_add(&seq, 1, __ATOMIC_RELAXED));
+    return mk_path_with_suffix(filepath, suffix);
+}
+
+// 文本加载的状态：转义行需要一块解码缓冲区
+typedef struct {
+    mk_t* kv;
+    char* scratch;
+    size_t scratch_cap;
+} text_loader_t;
+
+// 解析一行并写入实例，普通行的 key/value 以切片形式直接从读缓冲区拷进节点
+// 带过期时间的行以 "@<过期时刻> " 开头
+static int load_line(text_loader_t* loader, const char* line, size_t len) {
+    const char* key;
+    const char* val;
+    size_t klen, vlen;
+    uint64_t expire_at = 0;
+    size_t skip = parse_expire_prefix(line, len, &expire_at);
+    int ret = parse_entry_slice(line + skip, len - skip, &loader->scratch, &loader->scratch_cap,
+                                &key, &klen, &val, &vlen);
+    if (ret > 0) mk_set_entry(loader->kv, key, klen, mk_hash_bytes(loader->kv, key, klen), val, vlen, expire_at);
+    return ret < 0 ? -1 : 0;
+}
+
+// 流式读取文本：用大块缓冲区 read，memchr 定位换行
+// 行长度不受缓冲区大小限制，放不下的行会让缓冲区加倍
+static int load_text(mk_t* kv, int fd) {
+    size_t cap = MK_LOAD_BUFFER_SIZE;
+    size_t len = 0;
+    char* buf = (char*)malloc(cap);
+    if (!buf) return -1;
+    text_loader_t loader = { kv, NULL, 0 };
+    int ret = 0;
+    int eof = 0;
+    while (ret == 0) {
+        // 填充缓冲区剩余空间
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0) {
+            ret = -1;
+            break;
+        }
+        if (n == 0) eof = 1;
+        len += (size_t)n;
+        // 处理缓冲区中所有完整的行
+        char* p = buf;
+        char* end = buf + len;
+        while (p < end && ret == 0) {
+            char* nl = (char*)memchr(p, '\n', (size_t)(end - p));
+            if (!nl) break;
+            ret = load_line(&loader, p, (size_t)(nl - p));
+            p = nl + 1;
+        }
+        // 文件结束，最后一行可能没有换行符
+        if (eof || ret != 0) {
+            if (ret == 0 && p < end) ret = load_line(&loader, p, (size_t)(end - p));
+            break;
+        }
+        // 不完整的行移到缓冲区开头，等待下一次读取
+        len = (size_t)(end - p);
+        memmove(buf, p, len);
+        // 一整行都放不下，缓冲区加倍
+        if (len == cap) {
+            char* bigger = (char*)realloc(buf, cap * 2);
+            if (!bigger) {
+                ret = -1;
+                break;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    free(loader.scratch);
+    free(buf);
+    return ret;
+}
+
 // 从文件加载键值对
 // 参数是kv实例和文件路径
+static int load_file(mk_t* kv, const char* filepath) {
+    // 二进制快照直接 mmap，不走文本解析
+    int binary = mk_file_is_binary(filepath);
+    if (binary && mk_snapshot_load(kv, filepath) != 0) return -1;
+    // 打开文本文件读取
+    int fd = binary ? -1 : open(filepath, O_RDONLY);
+    if (fd >= 0) {
+        int ret = load_text(kv, fd);
+        // 关闭文件
+        close(fd);
+        if (ret != 0) return ret;
+    }
+    // 快照之后按顺序重放日志
+    int replayed = mk_replay_log(kv, filepath);
+    if (replayed < 0) return -1;
+    // 快照和日志都不存在
+    if (!binary && fd < 0 && replayed == 1) return 1;
+    // 回收文件中已经过期的 key
+    mk_expire(kv);
+    return 0;
+}
+
+// 加载文件，整个加载过程（含日志重放）记一次延迟
 int mk_load(mk_t* kv, const char* filepath) {
     if (!kv || !filepath) return -1;
-    // fopen打开文件读取
-    FILE* fp = fopen(filepath, "r");
-    if (!fp) return 1; // 文件不存在或不可读
-    // 逐行读取文件到buffer
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), fp)) {
-        char* key = NULL;
-        char* val = NULL;
-        
-        // 使用新的解析函数
-        if (parse_key_value_line(buffer, &key, &val)) {
-            // 设置键值对
-            mk_set(kv, key, val);
-        }
-    }
-    // 关闭文件
-    fclose(fp);
-    return 0;
+    uint64_t timer = mk_latency_begin(kv);
+    int ret = load_file(kv, filepath);
+    mk_latency_end(kv, MK_OP_LOAD, timer);
+    return ret;
+}
+
+// 把一行编码到 dst，返回长度；dst 的大小按 MK_EXPIRE_PREFIX 加上行本身预留
+static size_t encode_text_line(const mk_node_t* node, int plain, char* dst) {
+    size_t n = 0;
+    if (node->flags & MK_NODE_EXPIRES) {
+        n = (size_t)snprintf(dst, MK_EXPIRE_PREFIX + 1, "@%llu ", (unsigned long long)mk_node_expire(node));
+    }
+    if (plain) {
+        memcpy(dst + n, NODE_KEY(node), node->klen);
+        n += node->klen;
+        dst[n++] = '=';
+        memcpy(dst + n, NODE_VALUE(node), node->vlen);
+        n += node->vlen;
+    } else {
+        n += escape_entry(NODE_KEY(node), node->klen, NODE_VALUE(node), node->vlen, dst + n);
+    }
+    dst[n++] = '\n';
+    return n;
+}
+
+// 把单个节点写成 key=value 行，直接编码进写缓冲，只有超过一块的行才先编码到 buf
+// 无法按普通行原样读回的键值对（含换行、'\0'、首尾空白或特殊字符的 key）写成转义行
+// 带过期时间的行前面加上 "@<过期时刻> "，已经过期的不写
+static void write_text_line(const mk_node_t* node, void* user_data) {
+    mk_dump_t* w = (mk_dump_t*)user_data;
+    if (w->progress) __atomic_fetch_add(w->progress, 1, __ATOMIC_RELAXED);
+    if (w->out->error || mk_node_expired(node)) return;
+    int plain = is_plain_entry(NODE_KEY(node), node->klen, NODE_VALUE(node), node->vlen);
+    size_t need = plain ? MK_EXPIRE_PREFIX + node->klen + node->vlen + 2
+                        : MK_EXPIRE_PREFIX + escaped_entry_size(node->klen, node->vlen) + 1;
+    char* dst = mk_writer_reserve(w->out, need);
+    if (!dst) {
+        if (w->out->error) return;
+        if (w->cap < need) {
+            char* bigger = (char*)realloc(w->buf, need);
+            if (!bigger) {
+                w->out->error = 1;
+                return;
+            }
+            w->buf = bigger;
+            w->cap = need;
+        }
+        dst = w->buf;
+    }
+    size_t n = encode_text_line(node, plain, dst);
+    if (dst == w->buf) mk_writer_put(w->out, dst, n);
+    else mk_writer_advance(w->out, n);
+}
+
+// 以文本格式保存，经写入器先写临时文件、落盘后再 rename 替换目标文件
+// 目标文件可能正被 mmap（二进制快照），原地截断重写会让映射失效
+static int save_text(mk_t* kv, const char* filepath, uint64_t* progress) {
+    mk_dump_t* d = mk_dump_open(filepath, 0, kv->seed, progress);
+    if (!d) return 1;
+    mk_dump_add(d, kv);
+    return mk_dump_finish(d, kv);
+}
+
+mk_dump_t* mk_dump_open(const char* filepath, int binary, uint64_t seed, uint64_t* progress) {
+    mk_dump_t* d = (mk_dump_t*)calloc(1, sizeof(mk_dump_t));
+    if (!d) return NULL;
+    d->out = (mk_writer_t*)malloc(sizeof(mk_writer_t));
+    d->filepath = strdup(filepath);
+    if (!d->out || !d->filepath || mk_writer_open(d->out, filepath) != 0) {
+        free(d->out);
+        free(d->filepath);
+        free(d);
+        return NULL;
+    }
+    d->binary = binary;
+    d->seed = seed;
+    d->progress = progress;
+    if (binary) mk_snapshot_begin(d);
+    return d;
+}
+
+int mk_dump_add(mk_dump_t* d, const mk_t* kv) {
+    // 记录里的哈希值按实例的种子计算，种子不同的实例不能写进同一个快照
+    if (d->binary && kv->seed != d->seed) d->out->error = 1;
+    if (d->out->error) return -1;
+    mk_foreach_node(kv, d->binary ? mk_snapshot_write_node : write_text_line, d);
+    return d->out->error ? -1 : 0;
+}
+
+// 释放分段保存本身的内存，写入器由调用方先结束
+static void free_dump(mk_dump_t* d) {
+    free(d->buf);
+    free(d->filepath);
+    free(d->out);
+    free(d);
+}
+
+int mk_dump_finish(mk_dump_t* d, mk_t* kv) {
+    if (!d) return 1;
+    if (d->binary) mk_snapshot_end(d);
+    int ret = mk_writer_finish(d->out, d->filepath);
+    if (ret == 0 && kv) mk_note_save(kv, d->out);
+    free_dump(d);
+    return ret;
+}
+
+void mk_dump_abort(mk_dump_t* d) {
+    if (!d) return;
+    // 标记出错后结束写入器会删除临时文件，不会 rename
+    d->out->error = 1;
+    mk_writer_finish(d->out, d->filepath);
+    free_dump(d);
 }
 
 // 保存键值对到文件
 int mk_save(mk_t* kv, const char* filepath) {
     if (!kv || !filepath) return -1;
-    // 以写模式打开文件
-    FILE* fp = fopen(filepath, "w");
-    if (!fp) return 1;
-    // 遍历所有桶和链表，写入key=value格式
-    for (size_t i = 0; i < kv->bucket_count; i++) {
-        mk_node_t* current = kv->buckets[i];
-        while (current) {
-            // 格式化写入 key=value
-            fprintf(fp, "%s=%s\n", current->key, current->value);
-            current = current->next;
-        }
-    }
-    // 关闭文件
-    fclose(fp);
-    return 0;
+    uint64_t timer = mk_latency_begin(kv);
+    // 并发实例保存期间阻塞所有写操作，得到某一时刻的完整数据
+    lock_all(kv);
+    int ret = save_text(kv, filepath, NULL);
+    unlock_all(kv);
+    mk_latency_end(kv, MK_OP_SAVE, timer);
+    return ret;
+}
+
+// 以二进制快照格式保存
+int mk_save_binary(mk_t* kv, const char* filepath) {
+    if (!kv || !filepath) return -1;
+    uint64_t timer = mk_latency_begin(kv);
+    lock_all(kv);
+    int ret = mk_snapshot_save(kv, filepath, NULL);
+    unlock_all(kv);
+    mk_latency_end(kv, MK_OP_SAVE, timer);
+    return ret;
+}
+
+// 累计保存的字节数和耗时；并发实例的多个 mk_save 可以同时持有分片读锁，因此原子更新
+void mk_note_save(mk_t* kv, const mk_writer_t* w) {
+    __atomic_fetch_add(&kv->saves, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&kv->save_bytes, w->bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&kv->save_ns, w->elapsed_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&kv->last_save_bytes, w->bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&kv->last_save_ns, w->elapsed_ns, __ATOMIC_RELAXED);
+}
+
+// 按格式写文件，不加锁（后台保存的子进程使用）
+int mk_save_unlocked(mk_t* kv, const char* filepath, int binary, uint64_t* progress) {
+    return binary ? mk_snapshot_save(kv, filepath, progress) : save_text(kv, filepath, progress);
+}
+
+// 遍历所有节点（库内部使用）
+void mk_foreach_node(const mk_t* kv, void (*callback)(const mk_node_t* node, void* user_data), void* user_data) {
+    // 并发实例依次遍历各分片，锁由调用方持有
+    if (kv->shards) {
+        for (size_t i = 0; i <= kv->shard_mask; i++) mk_foreach_node(kv->shards[i].kv, callback, user_data);
+        return;
+    }
+    const mk_table_t* tables[2] = { &kv->table, &kv->old };
+    for (int t = 0; t < 2; t++) {
+        if (!tables[t]->slots) continue;
+        for (size_t i = 0; i < tables[t]->capacity; i++) {
+            if (tables[t]->slots[i].dist == 0) continue;
+            callback(tables[t]->slots[i].node, user_data);
+        }
+    }
 }
 
 // 遍历所有键值对，调用回调函数
 void mk_foreach(const mk_t* kv, void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
     // 参数检查：kv为空或回调为空则直接返回
     if (!kv || !callback) return;
-    // 遍历所有桶
-    for (size_t i = 0; i < kv->bucket_count; i++) {
-        // 取出当前桶的链表头
-        mk_node_t* current = kv->buckets[i];
-        // 遍历当前桶内链表
-        while (current) {
+    // 并发实例逐个分片持有读锁遍历
+    if (kv->shards) {
+        for (size_t i = 0; i <= kv->shard_mask; i++) {
+            pthread_rwlock_rdlock(&kv->shards[i].lock);
+            mk_foreach(kv->shards[i].kv, callback, user_data);
+            pthread_rwlock_unlock(&kv->shards[i].lock);
+        }
+        return;
+    }
+    // 依次顺序遍历新旧两张表连续的槽位数组
+    const mk_table_t* tables[2] = { &kv->table, &kv->old };
+    for (int t = 0; t < 2; t++) {
+        if (!tables[t]->slots) continue;
+        for (size_t i = 0; i < tables[t]->capacity; i++) {
+            // 跳过空槽
+            if (tables[t]->slots[i].dist == 0) continue;
             // 对当前键值对执行回调
-            callback(current->key, current->value, user_data);
-            // 移动到下一个节点
-            current = current->next;
+            mk_node_t* current = tables[t]->slots[i].node;
+            if (mk_node_expired(current)) continue;
+            callback(NODE_KEY(current), NODE_VALUE(current), user_data);
+        }
+    }
+}
+
+// 开启索引时收集已有节点
+typedef struct {
+    mk_node_t** nodes;
+    size_t n;
+} node_collector_t;
+
+static void collect_node(const mk_node_t* node, void* user_data) {
+    node_collector_t* c = (node_collector_t*)user_data;
+    c->nodes[c->n++] = (mk_node_t*)node;
+}
+
+// 开启有序索引，已有节点排序后批量建入
+// 并发实例持有所有分片的读锁建索引，期间写操作被阻塞，建完后各分片共用这一个索引
+int mk_index_enable(mk_t* kv) {
+    if (!kv) return -1;
+    lock_all(kv);
+    int ret = 0;
+    if (!kv->index) {
+        size_t count = 0;
+        for (size_t i = 0; kv->shards && i <= kv->shard_mask; i++) count += kv->shards[i].kv->count;
+        if (!kv->shards) count = kv->count;
+        node_collector_t c = { (mk_node_t**)malloc((count ? count : 1) * sizeof(mk_node_t*)), 0 };
+        mk_index_t* index = c.nodes ? mk_index_create(kv->shards != NULL) : NULL;
+        if (index) mk_foreach_node(kv, collect_node, &c);
+        if (!index || mk_index_build(index, c.nodes, c.n) != 0) {
+            mk_index_destroy(index);
+            ret = -1;
+        } else {
+            kv->index = index;
+            for (size_t i = 0; kv->shards && i <= kv->shard_mask; i++) kv->shards[i].kv->index = index;
+        }
+        free(c.nodes);
+    }
+    unlock_all(kv);
+    return ret;
+}
+
+// 把节点回调转换成公共的 key/value 回调
+typedef struct {
+    void (*callback)(const char* key, const char* value, void* user_data);
+    void* user_data;
+} range_ctx_t;
+
+static void range_node(const mk_node_t* node, void* user_data) {
+    range_ctx_t* ctx = (range_ctx_t*)user_data;
+    if (mk_node_expired(node)) return;
+    ctx->callback(NODE_KEY(node), NODE_VALUE(node), ctx->user_data);
+}
+
+// 按 key 顺序遍历 [start, end)
+// 索引项在摘下之前节点不会被释放，持有索引锁期间读到的节点都有效
+long mk_range(const mk_t* kv, const char* start, const char* end,
+              void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
+    if (!kv || !callback || !kv->index) return -1;
+    range_ctx_t ctx = { callback, user_data };
+    return (long)mk_index_range(kv->index, start, start ? strlen(start) : 0, end, end ? strlen(end) : 0, 0,
+                                range_node, &ctx);
+}
+
+// 按 key 顺序遍历以 prefix 开头的键值对
+long mk_prefix(const mk_t* kv, const char* prefix,
+               void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
+    if (!kv || !prefix || !callback || !kv->index) return -1;
+    range_ctx_t ctx = { callback, user_data };
+    return (long)mk_index_range(kv->index, prefix, strlen(prefix), NULL, 0, 1, range_node, &ctx);
+}
+
+// 反转 64 位整数的二进制位
+static uint64_t reverse_bits(uint64_t v) {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((v & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    v = ((v >> 8) & 0x00ff00ff00ff00ffULL) | ((v & 0x00ff00ff00ff00ffULL) << 8);
+    v = ((v >> 16) & 0x0000ffff0000ffffULL) | ((v & 0x0000ffff0000ffffULL) << 16);
+    return (v >> 32) | (v << 32);
+}
+
+// 遍历理想位置为 bucket 的所有节点，返回遍历的数量
+// Robin Hood 表中一个簇内的节点按理想位置排列：从 bucket 开始向后探测，
+// 探测距离更长的属于更早的桶，继续；距离相等的属于本桶；距离更短说明本桶已经结束
+static size_t scan_bucket(const mk_table_t* t, size_t bucket,
+                          void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
+    size_t mask = t->capacity - 1;
+    size_t visited = 0;
+    for (uint32_t dist = 1; dist <= t->capacity; dist++) {
+        const mk_slot_t* slot = &t->slots[(bucket + dist - 1) & mask];
+        if (slot->dist < dist) break;
+        if (slot->dist == dist && !mk_node_expired(slot->node)) {
+            callback(NODE_KEY(slot->node), NODE_VALUE(slot->node), user_data);
+            visited++;
         }
     }
+    return visited;
+}
+
+// 遍历单个实例中游标 v 对应的桶，返回下一个游标，0 表示遍历结束
+// 游标按反转二进制位递增：表扩容或缩容后，已经遍历过的桶对应新表中的
+// 一组桶，它们的游标都排在前面，所以不会漏掉一直存在的 key（可能重复返回）
+// 迁移期间先遍历小表中的桶，再遍历大表中由它展开的所有桶
+static uint64_t scan_step(const mk_t* kv, uint64_t v, size_t* visited,
+                          void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
+    const mk_table_t* small = &kv->table;
+    const mk_table_t* large = kv->old.slots ? &kv->old : NULL;
+    if (large && large->capacity < small->capacity) {
+        const mk_table_t* tmp = small;
+        small = large;
+        large = tmp;
+    }
+    uint64_t m0 = small->capacity - 1;
+    *visited += scan_bucket(small, (size_t)(v & m0), callback, user_data);
+    if (large) {
+        uint64_t m1 = large->capacity - 1;
+        do {
+            *visited += scan_bucket(large, (size_t)(v & m1), callback, user_data);
+            // 递增 v 中高于小表掩码的部分
+            v = (((v | m0) + 1) & ~m0) | (v & m0);
+        } while (v & (m0 ^ m1));
+    }
+    // 只保留小表掩码内的位，反转后加一再反转回来
+    v |= ~m0;
+    v = reverse_bits(v);
+    v++;
+    return reverse_bits(v);
+}
+
+// 在单个实例上推进游标，直到返回了 count 个键值对、检查的桶数用完或遍历结束
+static uint64_t scan_instance(const mk_t* kv, uint64_t v, size_t count, size_t* visited, size_t* buckets,
+                              void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
+    do {
+        v = scan_step(kv, v, visited, callback, user_data);
+    } while (v != 0 && *visited < count && --*buckets > 0);
+    return v;
+}
+
+// 游标式遍历
+// 并发实例依次遍历各分片，游标高位是分片编号；每次调用期间只持有一个分片的读锁
+uint64_t mk_scan(const mk_t* kv, uint64_t cursor, size_t count,
+                 void (*callback)(const char* key, const char* value, void* user_data), void* user_data) {
+    if (!kv || !callback) return 0;
+    if (count == 0) count = 1;
+    size_t visited = 0;
+    size_t buckets = count * MK_SCAN_EMPTY_VISITS;
+    if (!kv->shards) return scan_instance(kv, cursor, count, &visited, &buckets, callback, user_data);
+    uint64_t v = cursor & ((1ULL << MK_SCAN_SHARD_SHIFT) - 1);
+    for (uint64_t i = cursor >> MK_SCAN_SHARD_SHIFT; i <= kv->shard_mask; i++) {
+        mk_shard_t* shard = &kv->shards[i];
+        pthread_rwlock_rdlock(&shard->lock);
+        v = scan_instance(shard->kv, v, count, &visited, &buckets, callback, user_data);
+        pthread_rwlock_unlock(&shard->lock);
+        // 分片内还没遍历完
+        if (v != 0) return (i << MK_SCAN_SHARD_SHIFT) | v;
+        // 这个分片刚好遍历完，本次的额度也已用完，下次从下一个分片开始
+        if (i == kv->shard_mask) break;
+        if (visited >= count || buckets == 0) return (i + 1) << MK_SCAN_SHARD_SHIFT;
+    }
+    return 0;
+}
+
+// 把节点回调转换成按长度的 key/value 回调
+typedef struct {
+    void (*callback)(const mk_view_t* key, const mk_view_t* value, void* user_data);
+    void* user_data;
+} foreach_n_ctx_t;
+
+static void foreach_n_node(const mk_node_t* node, void* user_data) {
+    foreach_n_ctx_t* ctx = (foreach_n_ctx_t*)user_data;
+    if (mk_node_expired(node)) return;
+    mk_view_t key = { NODE_KEY(node), node->klen };
+    mk_view_t value = { NODE_VALUE(node), node->vlen };
+    ctx->callback(&key, &value, ctx->user_data);
+}
+
+// 按长度遍历所有键值对，key 和 value 可以含 '\0'
+void mk_foreach_n(const mk_t* kv, void (*callback)(const mk_view_t* key, const mk_view_t* value, void* user_data), void* user_data) {
+    if (!kv || !callback) return;
+    foreach_n_ctx_t ctx = { callback, user_data };
+    // 并发实例逐个分片持有读锁遍历
+    if (kv->shards) {
+        for (size_t i = 0; i <= kv->shard_mask; i++) {
+            pthread_rwlock_rdlock(&kv->shards[i].lock);
+            mk_foreach_node(kv->shards[i].kv, foreach_n_node, &ctx);
+            pthread_rwlock_unlock(&kv->shards[i].lock);
+        }
+        return;
+    }
+    mk_foreach_node(kv, foreach_n_node, &ctx);
+}
+
+// 关闭日志的内部实现，调用方持有 meta 锁
+static void close_log(mk_t* kv) {
+    mk_aof_close(kv->aof);
+    kv->aof = NULL;
+    free(kv->snapshot_path);
+    kv->snapshot_path = NULL;
+}
+
+// 开启日志的内部实现，调用方持有 meta 锁
+static int open_log(mk_t* kv, const char* filepath, mk_fsync_t policy, unsigned interval_ms) {
+    // 已经开启过则先关闭旧日志
+    close_log(kv);
+    kv->snapshot_path = strdup(filepath);
+    char* log_path = mk_path_with_suffix(filepath, ".log");
+    if (!kv->snapshot_path || !log_path) {
+        free(log_path);
+        close_log(kv);
+        return -1;
+    }
+    kv->aof = mk_aof_open(log_path, (int)policy, interval_ms);
+    free(log_path);
+    if (!kv->aof) {
+        close_log(kv);
+        return 1;
+    }
+    return 0;
+}
+
+// 开启追加写日志模式
+int mk_log_open(mk_t* kv, const char* filepath, mk_fsync_t policy, unsigned interval_ms) {
+    if (!kv || !filepath) return -1;
+    lock_meta(kv);
+    int ret = open_log(kv, filepath, policy, interval_ms);
+    unlock_meta(kv);
+    return ret;
+}
+
+// 是否处于日志模式
+int mk_log_is_open(const mk_t* kv) {
+    if (!kv) return 0;
+    lock_meta((mk_t*)kv);
+    int open = kv->aof ? 1 : 0;
+    unlock_meta((mk_t*)kv);
+    return open;
+}
+
+// 立即 fsync 日志
+int mk_log_sync(mk_t* kv) {
+    if (!kv) return -1;
+    lock_meta(kv);
+    int ret = kv->aof ? mk_aof_sync(kv->aof) : -1;
+    unlock_meta(kv);
+    return ret;
+}
+// 压缩日志：写新快照后清空日志
+// 快照和普通保存一样先写入临时文件并落盘，再原子 rename 替换；即使清空日志前崩溃，
+// 重放旧日志到新快照上也会得到同样的结果
+// 新快照沿用原快照的格式（文本或二进制）
+// 并发实例先锁住所有分片再锁日志，与写操作的加锁顺序一致，压缩期间不会有新记录写入
+int mk_log_compact(mk_t* kv) {
+    if (!kv) return -1;
+    lock_all(kv);
+    lock_meta(kv);
+    int ret = -1;
+    if (kv->aof) {
+        ret = mk_file_is_binary(kv->snapshot_path)
+            ? mk_snapshot_save(kv, kv->snapshot_path, NULL)
+            : save_text(kv, kv->snapshot_path, NULL);
+        if (ret == 0) ret = mk_aof_truncate(kv->aof);
+    }
+    unlock_meta(kv);
+    unlock_all(kv);
+    return ret;
+}
+
+// 关闭日志模式
+void mk_log_close(mk_t* kv) {
+    if (!kv) return;
+    lock_meta(kv);
+    close_log(kv);
+    unlock_meta(kv);
 }
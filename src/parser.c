@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include "minikv.h"
+#include "parser.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,35 +40,209 @@ int is_valid_key(const char* key) {
 }
 
 // 解析单行键值对，返回是否成功解析
-// key_out和val_out是输出参数，需要预分配足够空间
+// key_out和val_out指向line内部，key和value的结尾会被改写为'\0'
+// 只计算一次行长度，之后按切片解析，不再反复 strlen
 int parse_key_value_line(char* line, char** key_out, char** val_out) {
     if (!line || !key_out || !val_out) return 0;
 
+    const char* key;
+    const char* val;
+    size_t klen, vlen;
+    if (!parse_key_value_slice(line, strlen(line), &key, &klen, &val, &vlen)) {
+        return 0;
+    }
+
+    // 在原行内截断 key 和 value
+    char* k = line + (key - line);
+    char* v = line + (val - line);
+    k[klen] = '\0';
+    v[vlen] = '\0';
+    *key_out = k;
+    *val_out = v;
+    return 1;
+}
+
+// 验证长度为 len 的键名
+int is_valid_key_n(const char* key, size_t len) {
+    if (!key || len == 0) return 0;
+    for (size_t i = 0; i < len; i++) {
+        // 检测到不属于字母/数字、下划线、点、分隔符的返回0
+        if (!isalnum((unsigned char)key[i]) && key[i] != '_' && key[i] != '.' && key[i] != '-') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 去掉切片两边的空白，返回新的起始位置并更新长度
+static const char* trim_slice(const char* str, size_t* len) {
+    size_t n = *len;
+    while (n > 0 && isspace((unsigned char)*str)) {
+        str++;
+        n--;
+    }
+    while (n > 0 && isspace((unsigned char)str[n - 1])) n--;
+    *len = n;
+    return str;
+}
+
+// 以切片形式解析单行键值对，不修改输入
+int parse_key_value_slice(const char* line, size_t len, const char** key_out, size_t* klen_out,
+                          const char** val_out, size_t* vlen_out) {
+    if (!line || !key_out || !klen_out || !val_out || !vlen_out) return 0;
+
     // 去掉行首尾空白
-    line = trim(line);
-    
+    line = trim_slice(line, &len);
+
     // 跳过空行或注释行
-    if (strlen(line) == 0 || line[0] == '#' || line[0] == ';') {
+    if (len == 0 || line[0] == '#' || line[0] == ';') {
         return 0;
     }
 
-    char* eq = strchr(line, '=');
+    const char* eq = (const char*)memchr(line, '=', len);
     if (!eq) {
         return 0; // 没有找到等号
     }
 
-    // 把"="改为"\0"分割key和value
-    *eq = '\0'; 
-    // 各自去掉空白
-    char* key = trim(line);
-    char* val = trim(eq + 1);
-    
-    // 验证key和value
-    if (!key || !val || !is_valid_key(key)) {
+    // 等号两侧各自去掉空白
+    size_t klen = (size_t)(eq - line);
+    size_t vlen = len - klen - 1;
+    const char* key = trim_slice(line, &klen);
+    const char* val = trim_slice(eq + 1, &vlen);
+
+    // 验证key
+    if (!is_valid_key_n(key, klen)) {
         return 0;
     }
 
     *key_out = key;
+    *klen_out = klen;
     *val_out = val;
+    *vlen_out = vlen;
     return 1;
-}
\ No newline at end of file
+}
+
+// 判断键值对能否写成普通行
+int is_plain_entry(const char* key, size_t klen, const char* value, size_t vlen) {
+    if (!is_valid_key_n(key, klen)) return 0;
+    // 首尾空白在解析时会被去掉
+    if (vlen > 0 && (isspace((unsigned char)value[0]) || isspace((unsigned char)value[vlen - 1]))) return 0;
+    for (size_t i = 0; i < vlen; i++) {
+        if (value[i] == '\0' || value[i] == '\r' || value[i] == '\n') return 0;
+    }
+    return 1;
+}
+
+// key 中需要编码的字节：键名字符集以外的所有字节
+static int key_needs_escape(unsigned char c) {
+    return !isalnum(c) && c != '_' && c != '.' && c != '-';
+}
+
+// value 中需要编码的字节：'%'、控制字符、空格和 DEL
+static int value_needs_escape(unsigned char c) {
+    return c == '%' || c <= ' ' || c == 0x7f;
+}
+
+// 按 %XX 编码一段字节
+static size_t escape_bytes(const char* src, size_t len, int (*needs_escape)(unsigned char), char* out) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)src[i];
+        if (needs_escape(c)) {
+            out[n++] = '%';
+            out[n++] = hex[c >> 4];
+            out[n++] = hex[c & 15];
+        } else {
+            out[n++] = (char)c;
+        }
+    }
+    return n;
+}
+
+// 转义行的最大长度：每个字节最多编码成 3 个字节，另加 '!' 和 '='
+size_t escaped_entry_size(size_t klen, size_t vlen) {
+    return 3 * (klen + vlen) + 2;
+}
+
+// 编码转义行
+size_t escape_entry(const char* key, size_t klen, const char* value, size_t vlen, char* out) {
+    size_t n = 0;
+    out[n++] = '!';
+    n += escape_bytes(key, klen, key_needs_escape, out + n);
+    out[n++] = '=';
+    n += escape_bytes(value, vlen, value_needs_escape, out + n);
+    return n;
+}
+
+// 十六进制字符转数值，非法字符返回 -1
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// 解码 %XX，返回解码后的长度，格式错误返回 -1
+static long unescape_bytes(const char* src, size_t len, char* out) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] != '%') {
+            out[n++] = src[i];
+            continue;
+        }
+        if (i + 2 >= len) return -1;
+        int hi = hex_value(src[i + 1]);
+        int lo = hex_value(src[i + 2]);
+        if (hi < 0 || lo < 0) return -1;
+        out[n++] = (char)(hi << 4 | lo);
+        i += 2;
+    }
+    return (long)n;
+}
+
+// 解析普通行或转义行
+int parse_entry_slice(const char* line, size_t len, char** scratch, size_t* scratch_cap,
+                      const char** key_out, size_t* klen_out, const char** val_out, size_t* vlen_out) {
+    if (!line || !scratch || !scratch_cap || !key_out || !klen_out || !val_out || !vlen_out) return 0;
+    line = trim_slice(line, &len);
+    // 普通行走原来的规则
+    if (len == 0 || line[0] != '!') {
+        return parse_key_value_slice(line, len, key_out, klen_out, val_out, vlen_out);
+    }
+    // 转义行：key 中的 '=' 已被编码，第一个 '=' 就是分隔符
+    const char* eq = (const char*)memchr(line, '=', len);
+    if (!eq) return 0;
+    // 解码后不会比编码前更长
+    if (*scratch_cap < len) {
+        char* bigger = (char*)realloc(*scratch, len);
+        if (!bigger) return -1;
+        *scratch = bigger;
+        *scratch_cap = len;
+    }
+    long klen = unescape_bytes(line + 1, (size_t)(eq - line - 1), *scratch);
+    if (klen <= 0) return 0;
+    long vlen = unescape_bytes(eq + 1, len - (size_t)(eq - line) - 1, *scratch + klen);
+    if (vlen < 0) return 0;
+    *key_out = *scratch;
+    *klen_out = (size_t)klen;
+    *val_out = *scratch + klen;
+    *vlen_out = (size_t)vlen;
+    return 1;
+}
+
+// 解析 "@<过期时刻> " 前缀；数字溢出或后面没有空格都按没有前缀处理
+size_t parse_expire_prefix(const char* line, size_t len, uint64_t* expire_out) {
+    *expire_out = 0;
+    if (len < 3 || line[0] != '@') return 0;
+    uint64_t expire = 0;
+    size_t i = 1;
+    for (; i < len && isdigit((unsigned char)line[i]); i++) {
+        uint64_t digit = (uint64_t)(line[i] - '0');
+        if (expire > (UINT64_MAX - digit) / 10) return 0;
+        expire = expire * 10 + digit;
+    }
+    if (i == 1 || i >= len || line[i] != ' ' || expire == 0) return 0;
+    *expire_out = expire;
+    return i + 1;
+}
@@ -0,0 +1,163 @@
+#include "resp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 解析 [p, end) 中以 \r\n 结尾的十进制整数，成功时 *next 指向 \r\n 之后
+// 返回 1 成功，0 数据不完整，-1 格式错误
+static int parse_number(const char* p, const char* end, long long* out, const char** next) {
+    const char* cr = (const char*)memchr(p, '\r', (size_t)(end - p));
+    if (!cr || cr + 1 >= end) return (end - p) > 20 ? -1 : 0;
+    if (cr[1] != '\n' || cr == p) return -1;
+    int neg = 0;
+    if (*p == '-') {
+        neg = 1;
+        p++;
+    }
+    long long n = 0;
+    for (; p < cr; p++) {
+        if (*p < '0' || *p > '9' || n > RESP_MAX_BULK) return -1;
+        n = n * 10 + (*p - '0');
+    }
+    *out = neg ? -n : n;
+    *next = cr + 2;
+    return 1;
+}
+
+// 内联命令：一行按空格和制表符分隔，行尾可以是 \r\n 或 \n
+static int parse_inline(const char* buf, size_t len, mk_view_t* argv, int* argc, size_t* consumed) {
+    const char* nl = (const char*)memchr(buf, '\n', len);
+    if (!nl) return len > RESP_MAX_INLINE ? -1 : 0;
+    const char* end = nl;
+    if (end > buf && end[-1] == '\r') end--;
+    int n = 0;
+    const char* p = buf;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end) break;
+        if (n == RESP_MAX_ARGS) return -1;
+        const char* start = p;
+        while (p < end && *p != ' ' && *p != '\t') p++;
+        argv[n].data = start;
+        argv[n].len = (size_t)(p - start);
+        n++;
+    }
+    *argc = n;
+    *consumed = (size_t)(nl + 1 - buf);
+    return 1;
+}
+
+// 解析一个请求，参数切片指向 buf 内
+int resp_parse_command(const char* buf, size_t len, mk_view_t* argv, int* argc, size_t* consumed) {
+    if (len == 0) return 0;
+    if (buf[0] != '*') return parse_inline(buf, len, argv, argc, consumed);
+    const char* end = buf + len;
+    const char* p;
+    long long n;
+    int ret = parse_number(buf + 1, end, &n, &p);
+    if (ret <= 0) return ret;
+    if (n < 0 || n > RESP_MAX_ARGS) return -1;
+    for (long long i = 0; i < n; i++) {
+        if (p >= end) return 0;
+        if (*p != '$') return -1;
+        long long blen;
+        ret = parse_number(p + 1, end, &blen, &p);
+        if (ret <= 0) return ret;
+        if (blen < 0 || blen > RESP_MAX_BULK) return -1;
+        // 内容和结尾的 \r\n 还没有全部到达
+        if ((size_t)(end - p) < (size_t)blen + 2) return 0;
+        if (p[blen] != '\r' || p[blen + 1] != '\n') return -1;
+        argv[i].data = p;
+        argv[i].len = (size_t)blen;
+        p += blen + 2;
+    }
+    *argc = (int)n;
+    *consumed = (size_t)(p - buf);
+    return 1;
+}
+
+// 释放缓冲区
+void resp_buf_free(resp_buf_t* b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+    b->oom = 0;
+}
+
+// 保证还能追加 extra 字节，容量按两倍增长
+static int reserve(resp_buf_t* b, size_t extra) {
+    if (b->oom) return -1;
+    if (b->len + extra <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) cap *= 2;
+    char* bigger = (char*)realloc(b->data, cap);
+    if (!bigger) {
+        b->oom = 1;
+        return -1;
+    }
+    b->data = bigger;
+    b->cap = cap;
+    return 0;
+}
+
+// 追加原始字节
+void resp_append_raw(resp_buf_t* b, const char* data, size_t len) {
+    if (reserve(b, len) != 0) return;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+// 追加 <prefix><n>\r\n 形式的行
+static void append_line(resp_buf_t* b, char prefix, long long n) {
+    char line[32];
+    int len = snprintf(line, sizeof(line), "%c%lld\r\n", prefix, n);
+    resp_append_raw(b, line, (size_t)len);
+}
+
+// 追加简单字符串应答
+void resp_append_simple(resp_buf_t* b, const char* s) {
+    size_t len = strlen(s);
+    if (reserve(b, len + 3) != 0) return;
+    b->data[b->len++] = '+';
+    memcpy(b->data + b->len, s, len);
+    b->len += len;
+    b->data[b->len++] = '\r';
+    b->data[b->len++] = '\n';
+}
+
+// 追加错误应答
+void resp_append_error(resp_buf_t* b, const char* msg) {
+    size_t len = strlen(msg);
+    if (reserve(b, len + 3) != 0) return;
+    b->data[b->len++] = '-';
+    memcpy(b->data + b->len, msg, len);
+    b->len += len;
+    b->data[b->len++] = '\r';
+    b->data[b->len++] = '\n';
+}
+
+// 追加整数应答
+void resp_append_int(resp_buf_t* b, long long n) {
+    append_line(b, ':', n);
+}
+
+// 追加批量字符串应答，头部、内容和结尾一次预留
+void resp_append_bulk(resp_buf_t* b, const char* data, size_t len) {
+    if (reserve(b, len + 32) != 0) return;
+    append_line(b, '$', (long long)len);
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len++] = '\r';
+    b->data[b->len++] = '\n';
+}
+
+// 追加空批量字符串应答
+void resp_append_nil(resp_buf_t* b) {
+    resp_append_raw(b, "$-1\r\n", 5);
+}
+
+// 追加数组头
+void resp_append_array(resp_buf_t* b, size_t n) {
+    append_line(b, '*', (long long)n);
+}
@@ -0,0 +1,1164 @@
+#define _GNU_SOURCE
+#include "minikv.h"
+#include "minikv_internal.h"
+#include "resp.h"
+#include "spsc.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+ * minikv-server：用 RESP 协议对外提供 GET/SET/DEL/SCAN 等命令。
+ *
+ * 进程内有 N 个工作线程（-t，默认 1），每个线程绑定一个核，拥有：
+ *   - 自己的 epoll 循环，监听 socket 在所有线程间共享（EPOLLEXCLUSIVE），连接由接受它的线程负责读写；
+ *   - 自己私有的普通 mk_t 分片，只有这个线程会访问它，数据路径上没有任何锁。
+ * 每个 key 按哈希归属一个分片。连接所在线程解析出请求后，属于本线程分片的 key 直接执行，
+ * 其余的打包成消息经 SPSC 无锁队列转给归属线程，执行结果再经反向队列送回。
+ * 同一个连接上的应答按请求顺序排队，流水线中后面的请求先完成也会等前面的应答先发出。
+ * 每次可读事件读一块数据，执行其中所有完整的请求；应答累积在输出缓冲区里一次 write 发出。
+ */
+
+// 默认监听端口，与 Redis 相同，现有的客户端和压测工具不用改配置
+#define SERVER_DEFAULT_PORT 6379
+// 工作线程数量上限
+#define SERVER_MAX_WORKERS 256
+// 连接读缓冲区的初始大小，放不下一个完整请求时加倍
+#define SERVER_READ_CHUNK (16 * 1024)
+// 输出缓冲区中未发出的数据超过这个值时暂停读取该连接，等客户端把应答取走
+#define SERVER_MAX_PENDING (16 * 1024 * 1024)
+// 单次 epoll_wait 最多返回的事件数
+#define SERVER_MAX_EVENTS 256
+// SCAN 未指定 COUNT 时的默认值
+#define SERVER_SCAN_COUNT 10
+// SCAN 游标中分片编号从这一位开始，低位是分片内 mk_scan 的游标
+#define SERVER_SCAN_SHARD_SHIFT 48
+// 线程间每个方向的队列容量，满了之后的消息暂存在发送方本地，下一轮再发
+#define SERVER_QUEUE_SIZE 4096
+// 选择分片用的哈希种子，固定值，与实例内部的随机种子无关
+#define SERVER_ROUTE_SEED 0x6d696e696b76ULL
+
+// epoll 中注册的对象：监听 socket、线程的唤醒 eventfd 或客户端连接
+typedef enum {
+    HANDLE_LISTENER,
+    HANDLE_WAKEUP,
+    HANDLE_CLIENT
+} handle_kind_t;
+
+typedef struct {
+    handle_kind_t kind;
+    int fd;
+} handle_t;
+
+// 请求的类型，决定各部分结果如何拼成应答
+typedef enum {
+    CMD_READY,  // 不涉及数据的命令，应答已经生成
+    CMD_GET,
+    CMD_SET,
+    CMD_DEL,
+    CMD_EXISTS,
+    CMD_MGET,
+    CMD_MSET,
+    CMD_SCAN,
+    CMD_DBSIZE,
+    CMD_SAVE
+} cmd_t;
+
+// 在某个分片上执行的单个操作
+typedef enum {
+    OP_GET,
+    OP_SET,
+    OP_DEL,
+    OP_EXISTS,
+    OP_SCAN,
+    OP_DBSIZE,
+    OP_SAVE
+} op_t;
+
+struct pending;
+
+// 一个操作：由连接所在线程创建，归属线程执行后原路送回
+// key 和 value 的副本放在 data 中，不依赖连接的读缓冲区
+typedef struct msg {
+    op_t op;
+    // 创建消息的线程和执行消息的线程
+    int from;
+    int to;
+    // 已经执行完毕
+    int done;
+    // 所属的请求
+    struct pending* owner;
+    // 发送方本地暂存队列中的下一条
+    struct msg* next;
+    // 结果：GET/SCAN 的应答片段，DEL/EXISTS/DBSIZE 的计数，写入失败标记
+    resp_buf_t reply;
+    long long n;
+    int failed;
+    // SCAN 的参数
+    uint64_t cursor;
+    size_t count;
+    // SAVE 时各线程依次把自己的分片写进这个文件
+    mk_dump_t* dump;
+    const char* key;
+    size_t klen;
+    const char* value;
+    size_t vlen;
+    char data[];
+} msg_t;
+
+struct conn;
+
+// 连接上一个尚未应答的请求，按到达顺序排成链表
+typedef struct pending {
+    struct pending* next;
+    struct conn* conn;
+    cmd_t cmd;
+    // 各部分的操作和尚未完成的数量
+    msg_t** parts;
+    int nparts;
+    int left;
+    // CMD_READY 的应答
+    resp_buf_t ready;
+    // CMD_SAVE 正在写的文件，发起的线程负责结束或放弃
+    mk_dump_t* dump;
+} pending_t;
+
+// 客户端连接
+typedef struct conn {
+    // 必须是第一个成员，epoll 返回的指针按 handle_t 解释
+    handle_t handle;
+    // 读缓冲区，rbuf[0, rlen) 是尚未处理的输入
+    char* rbuf;
+    size_t rlen;
+    size_t rcap;
+    // 输出缓冲区，out.data[0, sent) 已经发出
+    resp_buf_t out;
+    size_t sent;
+    // 当前在 epoll 中注册的事件
+    uint32_t events;
+    // 收到 QUIT 或协议错误，发完剩余应答后关闭
+    int closing;
+    // socket 已经关闭，等转发出去的消息全部回来后释放
+    int closed;
+    // 尚未应答的请求
+    pending_t* head;
+    pending_t* tail;
+    // 转发给其他线程、还没有回来的消息数
+    int inflight;
+    // 线程内所有连接组成的双向链表
+    struct conn* prev;
+    struct conn* next;
+} conn_t;
+
+struct server;
+
+// 工作线程
+typedef struct worker {
+    int id;
+    struct server* srv;
+    pthread_t thread;
+    int epfd;
+    // 其他线程发来消息时用它唤醒 epoll_wait
+    handle_t wakeup;
+    // 在 epoll_wait 中睡眠时为 1，发送方据此决定是否需要写 eventfd
+    _Alignas(64) int sleeping;
+    // 私有分片，只有本线程访问
+    _Alignas(64) mk_t* kv;
+    // 发往各线程但队列已满的消息，按目标线程暂存
+    msg_t** overflow_head;
+    msg_t** overflow_tail;
+    int overflow;
+    conn_t* conns;
+    // 请求参数切片，指向连接的读缓冲区，执行完即失效
+    mk_view_t argv[RESP_MAX_ARGS];
+} worker_t;
+
+// 服务器状态
+typedef struct server {
+    // 数据文件，未指定时 SAVE 报错，退出时也不保存
+    const char* filepath;
+    const char* unix_path;
+    handle_t tcp;
+    handle_t unix_sock;
+    int nworkers;
+    worker_t* workers;
+    // queues[from * nworkers + to] 是 from 发往 to 的队列，from 是唯一的生产者，to 是唯一的消费者
+    mk_spsc_t* queues;
+    // 收到退出信号后置位
+    int stop;
+} server_t;
+
+// 把 fd 设为非阻塞
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// 参数与命令名比较（不区分大小写）
+static int arg_is(const mk_view_t* arg, const char* name) {
+    size_t len = strlen(name);
+    return arg->len == len && strncasecmp(arg->data, name, len) == 0;
+}
+
+// 把参数解析为无符号整数，成功返回 0
+static int arg_to_u64(const mk_view_t* arg, uint64_t* out) {
+    if (arg->len == 0 || arg->len > 20) return -1;
+    uint64_t n = 0;
+    for (size_t i = 0; i < arg->len; i++) {
+        char c = arg->data[i];
+        if (c < '0' || c > '9') return -1;
+        uint64_t next = n * 10 + (uint64_t)(c - '0');
+        if (next < n) return -1;
+        n = next;
+    }
+    *out = n;
+    return 0;
+}
+
+// key 所属的分片：哈希高 32 位乘以线程数取高位，不需要取模
+static int shard_of(const server_t* srv, const char* key, size_t klen) {
+    if (srv->nworkers == 1) return 0;
+    uint64_t h = mk_hash(key, klen, SERVER_ROUTE_SEED) >> 32;
+    return (int)((h * (uint64_t)srv->nworkers) >> 32);
+}
+
+// 按数据文件现有的格式保存：二进制快照仍写二进制，其余写文本
+static int save_store(mk_t* kv, const char* filepath) {
+    if (mk_file_is_binary(filepath)) return mk_save_binary(kv, filepath);
+    return mk_save(kv, filepath);
+}
+
+// 节点的过期时刻，没有过期时间为 0
+static uint64_t node_expire_at(const mk_node_t* node) {
+    return (node->flags & MK_NODE_EXPIRES) ? mk_node_expire(node) : 0;
+}
+
+// SCAN 回调：把 key 追加为批量字符串并计数
+// mk_scan 给出的 key 以 '\0' 结尾，含 '\0' 的二进制 key 在这里会被截断
+typedef struct {
+    resp_buf_t keys;
+    size_t count;
+} scan_reply_t;
+
+static void scan_collect(const char* key, const char* value, void* user_data) {
+    (void)value;
+    scan_reply_t* r = (scan_reply_t*)user_data;
+    resp_append_bulk(&r->keys, key, strlen(key));
+    r->count++;
+}
+
+// 在本线程的分片上执行 SCAN，应答为 [下一个游标, [key...]]
+// 分片遍历完时下一个游标指向下一个分片的开头，最后一个分片遍历完返回 0
+static void scan_shard(worker_t* w, uint64_t cursor, size_t count, resp_buf_t* out) {
+    scan_reply_t r = { { NULL, 0, 0, 0 }, 0 };
+    uint64_t next = mk_scan(w->kv, cursor & ((1ULL << SERVER_SCAN_SHARD_SHIFT) - 1), count, scan_collect, &r);
+    if (next != 0) next |= (uint64_t)w->id << SERVER_SCAN_SHARD_SHIFT;
+    else if (w->id + 1 < w->srv->nworkers) next = (uint64_t)(w->id + 1) << SERVER_SCAN_SHARD_SHIFT;
+    char num[24];
+    int len = snprintf(num, sizeof(num), "%llu", (unsigned long long)next);
+    resp_append_array(out, 2);
+    resp_append_bulk(out, num, (size_t)len);
+    resp_append_array(out, r.count);
+    resp_append_raw(out, r.keys.data, r.keys.len);
+    if (r.keys.oom) out->oom = 1;
+    resp_buf_free(&r.keys);
+}
+
+// 在本线程的分片上执行一个操作，结果写回消息
+static void run_op(worker_t* w, msg_t* m) {
+    mk_view_t value;
+    switch (m->op) {
+    case OP_GET:
+        if (mk_get_n(w->kv, m->key, m->klen, &value) == 1) resp_append_bulk(&m->reply, value.data, value.len);
+        else resp_append_nil(&m->reply);
+        break;
+    case OP_SET:
+        m->failed = mk_set_n(w->kv, m->key, m->klen, m->value, m->vlen);
+        break;
+    case OP_DEL:
+    case OP_EXISTS:
+        // mk_del_n 不区分 key 是否存在，先查一次得到删除的数量
+        m->n = mk_get_n(w->kv, m->key, m->klen, &value) == 1;
+        if (m->n && m->op == OP_DEL) m->failed = mk_del_n(w->kv, m->key, m->klen);
+        break;
+    case OP_SCAN:
+        scan_shard(w, m->cursor, m->count, &m->reply);
+        break;
+    case OP_DBSIZE:
+        m->n = (long long)mk_count(w->kv);
+        break;
+    case OP_SAVE: {
+        // 同一时刻只有持有消息的线程在写文件；写完交给下一个线程，回到发起线程之前全部写完
+        if (mk_dump_add(m->dump, w->kv) != 0) m->failed = 1;
+        int next = (w->id + 1) % w->srv->nworkers;
+        if (!m->failed && next != m->from) {
+            m->to = next;
+            return;
+        }
+        break;
+    }
+    }
+    m->done = 1;
+}
+
+// 释放请求及其各部分的消息
+static void free_pending(pending_t* p) {
+    for (int i = 0; i < p->nparts; i++) {
+        resp_buf_free(&p->parts[i]->reply);
+        free(p->parts[i]);
+    }
+    free(p->parts);
+    resp_buf_free(&p->ready);
+    // 连接关闭后不再拼应答，没有结束的保存在这里放弃
+    mk_dump_abort(p->dump);
+    free(p);
+}
+
+// 所有部分都完成后拼出应答
+static void compose(server_t* srv, pending_t* p, resp_buf_t* out) {
+    long long sum = 0;
+    int failed = 0;
+    for (int i = 0; i < p->nparts; i++) {
+        sum += p->parts[i]->n;
+        if (p->parts[i]->failed) failed = p->parts[i]->failed;
+    }
+    switch (p->cmd) {
+    case CMD_READY:
+        resp_append_raw(out, p->ready.data, p->ready.len);
+        if (p->ready.oom) out->oom = 1;
+        break;
+    case CMD_GET:
+    case CMD_SCAN:
+        resp_append_raw(out, p->parts[0]->reply.data, p->parts[0]->reply.len);
+        if (p->parts[0]->reply.oom) out->oom = 1;
+        break;
+    case CMD_MGET:
+        resp_append_array(out, (size_t)p->nparts);
+        for (int i = 0; i < p->nparts; i++) {
+            resp_append_raw(out, p->parts[i]->reply.data, p->parts[i]->reply.len);
+            if (p->parts[i]->reply.oom) out->oom = 1;
+        }
+        break;
+    case CMD_SET:
+    case CMD_MSET:
+        if (failed == -2) resp_append_error(out, "ERR invalid key");
+        else if (failed) resp_append_error(out, "ERR write failed");
+        else resp_append_simple(out, "OK");
+        break;
+    case CMD_DEL:
+    case CMD_EXISTS:
+    case CMD_DBSIZE:
+        if (failed) resp_append_error(out, "ERR write failed");
+        else resp_append_int(out, sum);
+        break;
+    case CMD_SAVE:
+        // 各分片都已写进临时文件；有分片写失败时放弃，不用残缺的数据替换目标文件
+        if (failed) mk_dump_abort(p->dump);
+        else failed = mk_dump_finish(p->dump, NULL);
+        p->dump = NULL;
+        if (failed) resp_append_error(out, "ERR save failed");
+        else resp_append_simple(out, "OK");
+        break;
+    }
+}
+
+// 把队首已经完成的请求依次拼成应答
+static void drain_pending(server_t* srv, conn_t* c) {
+    while (c->head && c->head->left == 0) {
+        pending_t* p = c->head;
+        c->head = p->next;
+        if (!c->head) c->tail = NULL;
+        if (!c->closed) compose(srv, p, &c->out);
+        free_pending(p);
+    }
+}
+
+// 唤醒可能在 epoll_wait 中睡眠的线程
+// 与睡眠方的检查构成 Dekker 式的握手：双方都先写自己的标记再用全屏障读对方的状态
+static void wake(worker_t* target) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&target->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&target->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        ssize_t n = write(target->wakeup.fd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+// 发送消息；队列已满或者前面还有暂存的消息时先暂存，保持同一方向上的顺序
+static void send_msg(worker_t* w, int to, msg_t* m) {
+    server_t* srv = w->srv;
+    m->next = NULL;
+    if (!w->overflow_head[to] && mk_spsc_push(&srv->queues[w->id * srv->nworkers + to], m) == 0) {
+        wake(&srv->workers[to]);
+        return;
+    }
+    if (w->overflow_tail[to]) w->overflow_tail[to]->next = m;
+    else w->overflow_head[to] = m;
+    w->overflow_tail[to] = m;
+    w->overflow++;
+}
+
+// 重试发送暂存的消息
+static void flush_overflow(worker_t* w) {
+    server_t* srv = w->srv;
+    for (int to = 0; to < srv->nworkers && w->overflow > 0; to++) {
+        int sent = 0;
+        while (w->overflow_head[to]) {
+            msg_t* m = w->overflow_head[to];
+            if (mk_spsc_push(&srv->queues[w->id * srv->nworkers + to], m) != 0) break;
+            w->overflow_head[to] = m->next;
+            if (!m->next) w->overflow_tail[to] = NULL;
+            w->overflow--;
+            sent = 1;
+        }
+        if (sent) wake(&srv->workers[to]);
+    }
+}
+
+// 新建消息，复制 key 和 value
+static msg_t* new_msg(worker_t* w, op_t op, int to, const mk_view_t* key, const mk_view_t* value) {
+    size_t klen = key ? key->len : 0;
+    size_t vlen = value ? value->len : 0;
+    msg_t* m = (msg_t*)calloc(1, sizeof(msg_t) + klen + vlen);
+    if (!m) return NULL;
+    m->op = op;
+    m->from = w->id;
+    m->to = to;
+    if (key) memcpy(m->data, key->data, klen);
+    if (value) memcpy(m->data + klen, value->data, vlen);
+    m->key = m->data;
+    m->klen = klen;
+    m->value = m->data + klen;
+    m->vlen = vlen;
+    return m;
+}
+
+// 为请求创建 n 个部分，挂到连接的请求队列末尾
+static pending_t* new_pending(conn_t* c, cmd_t cmd, int nparts) {
+    pending_t* p = (pending_t*)calloc(1, sizeof(pending_t));
+    if (!p) return NULL;
+    if (nparts > 0) {
+        p->parts = (msg_t**)calloc((size_t)nparts, sizeof(msg_t*));
+        if (!p->parts) {
+            free(p);
+            return NULL;
+        }
+    }
+    p->conn = c;
+    p->cmd = cmd;
+    p->nparts = nparts;
+    p->left = nparts;
+    if (c->tail) c->tail->next = p;
+    else c->head = p;
+    c->tail = p;
+    return p;
+}
+
+// 添加请求的第 i 个部分：本线程的分片直接执行，其他分片的转发出去
+// SAVE 在本线程执行后还要交给下一个线程，同样转发
+static void add_part(worker_t* w, pending_t* p, int i, msg_t* m) {
+    m->owner = p;
+    p->parts[i] = m;
+    if (m->to == w->id) {
+        run_op(w, m);
+        if (m->done) {
+            p->left--;
+            return;
+        }
+    }
+    p->conn->inflight++;
+    send_msg(w, m->to, m);
+}
+
+// 不涉及数据的命令的应答写到哪里：前面没有排队的请求时直接写输出缓冲区，
+// 否则放进一个新的排队请求，等前面的应答发出后再发；内存不足返回 NULL
+static resp_buf_t* ready_out(conn_t* c) {
+    if (!c->head) return &c->out;
+    pending_t* p = new_pending(c, CMD_READY, 0);
+    return p ? &p->ready : NULL;
+}
+
+// 执行一个请求
+// 本线程分片上的单 key 命令在前面没有排队的请求时直接写应答，这是最常见的路径
+static void execute(worker_t* w, conn_t* c, mk_view_t* argv, int argc) {
+    server_t* srv = w->srv;
+    mk_view_t* cmd = &argv[0];
+    resp_buf_t* out = &c->out;
+    mk_view_t value;
+    cmd_t kind = CMD_READY;
+    int local = argc >= 2 && !c->head && shard_of(srv, argv[1].data, argv[1].len) == w->id;
+
+    if (arg_is(cmd, "get") && argc == 2) {
+        if (local) {
+            if (mk_get_n(w->kv, argv[1].data, argv[1].len, &value) == 1) resp_append_bulk(out, value.data, value.len);
+            else resp_append_nil(out);
+            return;
+        }
+        kind = CMD_GET;
+    } else if (arg_is(cmd, "set") && argc == 3) {
+        if (local) {
+            int ret = mk_set_n(w->kv, argv[1].data, argv[1].len, argv[2].data, argv[2].len);
+            if (ret == 0) resp_append_simple(out, "OK");
+            else if (ret == -2) resp_append_error(out, "ERR invalid key");
+            else resp_append_error(out, "ERR write failed");
+            return;
+        }
+        kind = CMD_SET;
+    } else if (arg_is(cmd, "del") && argc >= 2) {
+        kind = CMD_DEL;
+    } else if (arg_is(cmd, "exists") && argc >= 2) {
+        kind = CMD_EXISTS;
+    } else if (arg_is(cmd, "mget") && argc >= 2) {
+        kind = CMD_MGET;
+    } else if (arg_is(cmd, "mset") && argc >= 3 && argc % 2 == 1) {
+        kind = CMD_MSET;
+    } else if (arg_is(cmd, "scan") && argc >= 2) {
+        kind = CMD_SCAN;
+    } else if (arg_is(cmd, "dbsize") && argc == 1) {
+        kind = CMD_DBSIZE;
+    } else if (arg_is(cmd, "save") && argc == 1 && srv->filepath) {
+        kind = CMD_SAVE;
+    }
+
+    if (kind == CMD_READY) {
+        out = ready_out(c);
+        if (!out) {
+            c->out.oom = 1;
+            return;
+        }
+        if (arg_is(cmd, "ping") && argc <= 2) {
+            if (argc == 2) resp_append_bulk(out, argv[1].data, argv[1].len);
+            else resp_append_simple(out, "PONG");
+        } else if (arg_is(cmd, "echo") && argc == 2) {
+            resp_append_bulk(out, argv[1].data, argv[1].len);
+        } else if (arg_is(cmd, "save") && argc == 1) {
+            resp_append_error(out, "ERR no data file, start with -f <file>");
+        } else if (arg_is(cmd, "quit")) {
+            resp_append_simple(out, "OK");
+            c->closing = 1;
+        } else if (arg_is(cmd, "command") || arg_is(cmd, "config")) {
+            // redis-cli 和 redis-benchmark 连接时会查询，回空数组即可
+            resp_append_array(out, 0);
+        } else {
+            char msg[128];
+            int n = (int)(cmd->len < 64 ? cmd->len : 64);
+            snprintf(msg, sizeof(msg), "ERR unknown command or wrong number of arguments for '%.*s'", n, cmd->data);
+            resp_append_error(out, msg);
+        }
+        drain_pending(srv, c);
+        return;
+    }
+
+    // SCAN 的参数在拆分之前校验
+    uint64_t cursor = 0;
+    uint64_t count = SERVER_SCAN_COUNT;
+    if (kind == CMD_SCAN) {
+        int ok = arg_to_u64(&argv[1], &cursor) == 0 && (cursor >> SERVER_SCAN_SHARD_SHIFT) < (uint64_t)srv->nworkers;
+        for (int i = 2; ok && i < argc; i += 2) {
+            ok = i + 1 < argc && arg_is(&argv[i], "count") && arg_to_u64(&argv[i + 1], &count) == 0 && count > 0;
+        }
+        if (!ok) {
+            out = ready_out(c);
+            if (!out) c->out.oom = 1;
+            else resp_append_error(out, "ERR invalid cursor or syntax error");
+            drain_pending(srv, c);
+            return;
+        }
+    }
+
+    // 单线程时 SAVE 直接保存唯一的分片
+    if (kind == CMD_SAVE && srv->nworkers == 1) {
+        out = ready_out(c);
+        if (!out) c->out.oom = 1;
+        else if (save_store(w->kv, srv->filepath) != 0) resp_append_error(out, "ERR save failed");
+        else resp_append_simple(out, "OK");
+        drain_pending(srv, c);
+        return;
+    }
+
+    // 多线程时 SAVE 从本线程开始依次经过每个线程，各自把分片写进同一个临时文件，不汇总数据
+    mk_dump_t* dump = NULL;
+    if (kind == CMD_SAVE) {
+        dump = mk_dump_open(srv->filepath, mk_file_is_binary(srv->filepath), w->kv->seed, NULL);
+        if (!dump) {
+            out = ready_out(c);
+            if (!out) c->out.oom = 1;
+            else resp_append_error(out, "ERR save failed");
+            drain_pending(srv, c);
+            return;
+        }
+    }
+
+    // 拆成各分片上的操作：多 key 命令每个 key 一个，DBSIZE 每个分片一个，SAVE 和 SCAN 一个
+    int nparts;
+    if (kind == CMD_DBSIZE) nparts = srv->nworkers;
+    else if (kind == CMD_SET || kind == CMD_MSET) nparts = (argc - 1) / 2;
+    else if (kind == CMD_SCAN || kind == CMD_SAVE) nparts = 1;
+    else nparts = argc - 1;
+    pending_t* p = new_pending(c, kind, nparts);
+    if (!p) {
+        mk_dump_abort(dump);
+        c->out.oom = 1;
+        return;
+    }
+    p->dump = dump;
+    for (int i = 0; i < nparts; i++) {
+        msg_t* m;
+        switch (kind) {
+        case CMD_GET:
+        case CMD_MGET:
+            m = new_msg(w, OP_GET, shard_of(srv, argv[i + 1].data, argv[i + 1].len), &argv[i + 1], NULL);
+            break;
+        case CMD_SET:
+        case CMD_MSET:
+            m = new_msg(w, OP_SET, shard_of(srv, argv[2 * i + 1].data, argv[2 * i + 1].len), &argv[2 * i + 1], &argv[2 * i + 2]);
+            break;
+        case CMD_DEL:
+        case CMD_EXISTS:
+            m = new_msg(w, kind == CMD_DEL ? OP_DEL : OP_EXISTS, shard_of(srv, argv[i + 1].data, argv[i + 1].len), &argv[i + 1], NULL);
+            break;
+        case CMD_SCAN:
+            m = new_msg(w, OP_SCAN, (int)(cursor >> SERVER_SCAN_SHARD_SHIFT), NULL, NULL);
+            if (m) {
+                m->cursor = cursor;
+                m->count = (size_t)count;
+            }
+            break;
+        case CMD_SAVE:
+            m = new_msg(w, OP_SAVE, w->id, NULL, NULL);
+            if (m) m->dump = p->dump;
+            break;
+        default:
+            m = new_msg(w, OP_DBSIZE, i, NULL, NULL);
+            break;
+        }
+        if (!m) {
+            // 已经发出的部分仍会回来，标记连接出错，等它们回来后随连接一起释放
+            p->nparts = i;
+            p->left -= nparts - i;
+            // SAVE 的文件还没写任何分片，不能在拼应答时当成完整的数据提交
+            mk_dump_abort(p->dump);
+            p->dump = NULL;
+            c->out.oom = 1;
+            return;
+        }
+        add_part(w, p, i, m);
+    }
+    drain_pending(srv, c);
+}
+
+// 注册或修改连接关心的事件：有未发出的应答时关心可写，输出积压过多或正在关闭时不再读
+static void update_events(worker_t* w, conn_t* c) {
+    size_t pending = c->out.len - c->sent;
+    uint32_t events = 0;
+    if (!c->closing && pending < SERVER_MAX_PENDING) events |= EPOLLIN;
+    if (pending > 0) events |= EPOLLOUT;
+    if (events == c->events) return;
+    struct epoll_event ev = { .events = events, .data.ptr = c };
+    epoll_ctl(w->epfd, EPOLL_CTL_MOD, c->handle.fd, &ev);
+    c->events = events;
+}
+
+// 释放连接的全部内存
+static void free_conn(worker_t* w, conn_t* c) {
+    if (c->prev) c->prev->next = c->next;
+    else w->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    while (c->head) {
+        pending_t* p = c->head;
+        c->head = p->next;
+        free_pending(p);
+    }
+    free(c->rbuf);
+    resp_buf_free(&c->out);
+    free(c);
+}
+
+// 关闭连接；还有转发出去的消息没回来时先只关 socket，等消息回来再释放
+static void close_conn(worker_t* w, conn_t* c) {
+    if (!c->closed) {
+        epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->handle.fd, NULL);
+        close(c->handle.fd);
+        c->closed = 1;
+    }
+    if (c->inflight == 0) free_conn(w, c);
+}
+
+// 尽量发出输出缓冲区中的应答，全部发完后清空缓冲区；连接出错返回 -1
+static int flush_output(conn_t* c) {
+    while (c->sent < c->out.len) {
+        ssize_t n = write(c->handle.fd, c->out.data + c->sent, c->out.len - c->sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        c->sent += (size_t)n;
+    }
+    c->out.len = 0;
+    c->sent = 0;
+    return 0;
+}
+
+// 发出应答并更新事件，连接出错或者应该关闭时关闭它
+static void finish_io(worker_t* w, conn_t* c) {
+    if (c->out.oom || flush_output(c) != 0 || (c->closing && !c->head && c->out.len == 0)) {
+        close_conn(w, c);
+        return;
+    }
+    update_events(w, c);
+}
+
+// 解析并执行读缓冲区中所有完整的请求，剩下的半个请求移到缓冲区开头
+static void process_input(worker_t* w, conn_t* c) {
+    size_t pos = 0;
+    while (!c->closing && !c->out.oom && c->out.len - c->sent < SERVER_MAX_PENDING) {
+        int argc;
+        size_t used;
+        int ret = resp_parse_command(c->rbuf + pos, c->rlen - pos, w->argv, &argc, &used);
+        if (ret == 0) break;
+        if (ret < 0) {
+            // 协议错误的应答同样要排在之前的请求之后
+            resp_buf_t* out = ready_out(c);
+            if (out) resp_append_error(out, "ERR Protocol error");
+            else c->out.oom = 1;
+            c->closing = 1;
+            break;
+        }
+        pos += used;
+        if (argc > 0) execute(w, c, w->argv, argc);
+    }
+    c->rlen -= pos;
+    memmove(c->rbuf, c->rbuf + pos, c->rlen);
+}
+
+// 处理客户端连接上的事件
+static void handle_client(worker_t* w, conn_t* c, uint32_t events) {
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        // 缓冲区满了还没有完整的请求（大 value），加倍
+        if (c->rlen == c->rcap) {
+            char* bigger = (char*)realloc(c->rbuf, c->rcap * 2);
+            if (!bigger) {
+                close_conn(w, c);
+                return;
+            }
+            c->rbuf = bigger;
+            c->rcap *= 2;
+        }
+        ssize_t n = read(c->handle.fd, c->rbuf + c->rlen, c->rcap - c->rlen);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close_conn(w, c);
+            return;
+        }
+        if (n > 0) c->rlen += (size_t)n;
+    }
+    // 输出积压解除后，缓冲区里可能还有没执行的请求
+    process_input(w, c);
+    finish_io(w, c);
+}
+
+// 处理从其他线程收到的消息：请求在本分片执行后送回，结果交给所属的请求
+static int poll_queues(worker_t* w) {
+    server_t* srv = w->srv;
+    int handled = 0;
+    for (int from = 0; from < srv->nworkers; from++) {
+        if (from == w->id) continue;
+        mk_spsc_t* q = &srv->queues[from * srv->nworkers + w->id];
+        msg_t* m;
+        while ((m = (msg_t*)mk_spsc_pop(q)) != NULL) {
+            handled++;
+            if (!m->done) {
+                run_op(w, m);
+                send_msg(w, m->done ? m->from : m->to, m);
+                continue;
+            }
+            conn_t* c = m->owner->conn;
+            m->owner->left--;
+            c->inflight--;
+            if (c->closed) {
+                if (c->inflight == 0) free_conn(w, c);
+                continue;
+            }
+            drain_pending(srv, c);
+            // 应答可能让积压超过上限或者解除积压，process_input 会处理缓冲区中剩余的请求
+            if (!c->head) process_input(w, c);
+            finish_io(w, c);
+        }
+    }
+    return handled;
+}
+
+// 所有发往本线程的队列是否都为空
+static int queues_empty(worker_t* w) {
+    server_t* srv = w->srv;
+    for (int from = 0; from < srv->nworkers; from++) {
+        if (from != w->id && !mk_spsc_empty(&srv->queues[from * srv->nworkers + w->id])) return 0;
+    }
+    return 1;
+}
+
+// 接受所有等待中的连接
+static void accept_clients(worker_t* w, handle_t* listener) {
+    while (1) {
+        int fd = accept(listener->fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            // EAGAIN 表示已经取完（或被其他线程取走）；其他错误等下次事件再试
+            return;
+        }
+        set_nonblocking(fd);
+        if (listener == &w->srv->tcp) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        conn_t* c = (conn_t*)calloc(1, sizeof(conn_t));
+        char* rbuf = (char*)malloc(SERVER_READ_CHUNK);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (!c || !rbuf || (c->handle.fd = fd, epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev)) != 0) {
+            free(rbuf);
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->handle.kind = HANDLE_CLIENT;
+        c->rbuf = rbuf;
+        c->rcap = SERVER_READ_CHUNK;
+        c->events = EPOLLIN;
+        c->next = w->conns;
+        if (w->conns) w->conns->prev = c;
+        w->conns = c;
+    }
+}
+
+// 工作线程的事件循环
+static void* worker_main(void* arg) {
+    worker_t* w = (worker_t*)arg;
+    server_t* srv = w->srv;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (!__atomic_load_n(&srv->stop, __ATOMIC_ACQUIRE)) {
+        int handled = poll_queues(w);
+        flush_overflow(w);
+        // 还有暂存的消息时短暂等待后重试；刚处理过消息或队列非空时不睡眠
+        int timeout = w->overflow > 0 ? 1 : (handled > 0 ? 0 : -1);
+        if (timeout < 0) {
+            __atomic_store_n(&w->sleeping, 1, __ATOMIC_SEQ_CST);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (!queues_empty(w) || __atomic_load_n(&srv->stop, __ATOMIC_ACQUIRE)) timeout = 0;
+        }
+        int n = epoll_wait(w->epfd, events, SERVER_MAX_EVENTS, timeout);
+        __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+        for (int i = 0; i < n; i++) {
+            handle_t* h = (handle_t*)events[i].data.ptr;
+            if (h->kind == HANDLE_LISTENER) {
+                accept_clients(w, h);
+            } else if (h->kind == HANDLE_WAKEUP) {
+                uint64_t value;
+                ssize_t r = read(h->fd, &value, sizeof(value));
+                (void)r;
+            } else {
+                handle_client(w, (conn_t*)h, events[i].events);
+            }
+        }
+    }
+    return NULL;
+}
+
+// 创建监听 socket 并绑定地址
+static int listen_tcp(server_t* srv, const char* addr, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1 || bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 ||
+        set_nonblocking(fd) != 0 || listen(fd, 511) != 0) {
+        close(fd);
+        return -1;
+    }
+    srv->tcp.kind = HANDLE_LISTENER;
+    srv->tcp.fd = fd;
+    return 0;
+}
+
+// 监听 Unix socket，路径上已有的旧 socket 文件先删除
+static int listen_unix(server_t* srv, const char* path) {
+    struct sockaddr_un sa;
+    if (strlen(path) >= sizeof(sa.sun_path)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || set_nonblocking(fd) != 0 || listen(fd, 511) != 0) {
+        close(fd);
+        return -1;
+    }
+    srv->unix_sock.kind = HANDLE_LISTENER;
+    srv->unix_sock.fd = fd;
+    return 0;
+}
+
+// 把 fd 注册到线程的 epoll；监听 socket 用 EPOLLEXCLUSIVE，新连接只唤醒一个线程
+static int watch(worker_t* w, handle_t* h, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = h };
+    return epoll_ctl(w->epfd, EPOLL_CTL_ADD, h->fd, &ev);
+}
+
+// 初始化工作线程的 epoll、唤醒 fd 和私有分片
+static int init_worker(server_t* srv, worker_t* w, int id) {
+    w->id = id;
+    w->srv = srv;
+    w->epfd = epoll_create1(0);
+    w->wakeup.kind = HANDLE_WAKEUP;
+    w->wakeup.fd = eventfd(0, EFD_NONBLOCK);
+    w->overflow_head = (msg_t**)calloc((size_t)srv->nworkers, sizeof(msg_t*));
+    w->overflow_tail = (msg_t**)calloc((size_t)srv->nworkers, sizeof(msg_t*));
+    if (!w->kv) w->kv = mk_create();
+    if (w->epfd < 0 || w->wakeup.fd < 0 || !w->overflow_head || !w->overflow_tail || !w->kv) return -1;
+    if (watch(w, &w->wakeup, EPOLLIN) != 0) return -1;
+    uint32_t listen_events = srv->nworkers > 1 ? EPOLLIN | EPOLLEXCLUSIVE : EPOLLIN;
+    if (srv->tcp.fd >= 0 && watch(w, &srv->tcp, listen_events) != 0) return -1;
+    if (srv->unix_sock.fd >= 0 && watch(w, &srv->unix_sock, listen_events) != 0) return -1;
+    return 0;
+}
+
+// 释放工作线程的资源，所有线程都已退出
+static void destroy_worker(worker_t* w) {
+    while (w->conns) {
+        conn_t* c = w->conns;
+        if (!c->closed) close(c->handle.fd);
+        free_conn(w, c);
+    }
+    if (w->epfd >= 0) close(w->epfd);
+    if (w->wakeup.fd >= 0) close(w->wakeup.fd);
+    free(w->overflow_head);
+    free(w->overflow_tail);
+    mk_destroy(w->kv);
+}
+
+// 启动时按 key 分发节点的上下文，复制失败（内存不足）时置位 failed
+typedef struct {
+    server_t* srv;
+    int failed;
+} route_ctx_t;
+
+// 把节点连同过期时间放进它所属的分片，已经过期的不复制
+static void route_node(const mk_node_t* node, void* user_data) {
+    route_ctx_t* ctx = (route_ctx_t*)user_data;
+    if (ctx->failed || mk_node_expired(node)) return;
+    mk_t* kv = ctx->srv->workers[shard_of(ctx->srv, NODE_KEY(node), node->klen)].kv;
+    if (mk_set_entry(kv, NODE_KEY(node), node->klen, mk_hash_bytes(kv, NODE_KEY(node), node->klen),
+                     NODE_VALUE(node), node->vlen, node_expire_at(node)) != 0) {
+        ctx->failed = 1;
+    }
+}
+
+// 加载数据文件并按 key 分发到各分片；单线程时加载的实例直接作为唯一的分片
+static int load_store(server_t* srv) {
+    mk_t* all = mk_create();
+    if (!all) return -1;
+    if (srv->filepath && mk_load(all, srv->filepath) < 0) {
+        mk_destroy(all);
+        return -1;
+    }
+    if (srv->nworkers == 1) {
+        srv->workers[0].kv = all;
+        return 0;
+    }
+    for (int i = 0; i < srv->nworkers; i++) {
+        srv->workers[i].kv = mk_create();
+        if (!srv->workers[i].kv) {
+            mk_destroy(all);
+            return -1;
+        }
+        // 各分片使用相同的哈希种子，SAVE 写二进制快照时记录中的哈希值对整个文件都有效
+        srv->workers[i].kv->seed = all->seed;
+    }
+    route_ctx_t ctx = { srv, 0 };
+    mk_foreach_node(all, route_node, &ctx);
+    mk_destroy(all);
+    return ctx.failed ? -1 : 0;
+}
+
+// 退出时把各分片依次写回数据文件，所有线程都已退出；任何一个分片写失败都不替换数据文件
+static int save_on_exit(server_t* srv) {
+    if (srv->nworkers == 1) return save_store(srv->workers[0].kv, srv->filepath);
+    mk_dump_t* dump = mk_dump_open(srv->filepath, mk_file_is_binary(srv->filepath), srv->workers[0].kv->seed, NULL);
+    if (!dump) return -1;
+    for (int i = 0; i < srv->nworkers; i++) {
+        if (mk_dump_add(dump, srv->workers[i].kv) != 0) {
+            mk_dump_abort(dump);
+            return -1;
+        }
+    }
+    return mk_dump_finish(dump, NULL);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-f <file>] [-p <port>] [-b <addr>] [-s <unix_socket>] [-t <threads>]\n", prog);
+    fprintf(stderr, "  -f <file>         data file, loaded at startup and written by SAVE and on exit\n");
+    fprintf(stderr, "  -p <port>         TCP port (default %d, 0 disables TCP)\n", SERVER_DEFAULT_PORT);
+    fprintf(stderr, "  -b <addr>         TCP bind address (default 127.0.0.1)\n");
+    fprintf(stderr, "  -s <unix_socket>  also listen on a Unix socket\n");
+    fprintf(stderr, "  -t <threads>      worker threads, one shard and one core each (default 1)\n");
+}
+
+int main(int argc, char* argv[]) {
+    server_t srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.tcp.fd = -1;
+    srv.unix_sock.fd = -1;
+    srv.nworkers = 1;
+    int port = SERVER_DEFAULT_PORT;
+    const char* bind_addr = "127.0.0.1";
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-f") == 0) srv.filepath = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-p") == 0) port = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-b") == 0) bind_addr = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) srv.unix_path = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) srv.nworkers = atoi(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (port < 0 || port > 65535 || (port == 0 && !srv.unix_path) ||
+        srv.nworkers < 1 || srv.nworkers > SERVER_MAX_WORKERS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 队列的读写下标和线程的睡眠标记按缓存行对齐，分配时也要对齐
+    size_t workers_size = (size_t)srv.nworkers * sizeof(worker_t);
+    size_t queues_size = (size_t)srv.nworkers * (size_t)srv.nworkers * sizeof(mk_spsc_t);
+    srv.workers = (worker_t*)aligned_alloc(64, workers_size);
+    srv.queues = (mk_spsc_t*)aligned_alloc(64, queues_size);
+    if (!srv.workers || !srv.queues) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free(srv.workers);
+        free(srv.queues);
+        return 1;
+    }
+    memset(srv.workers, 0, workers_size);
+    memset(srv.queues, 0, queues_size);
+    for (int i = 0; i < srv.nworkers; i++) {
+        srv.workers[i].epfd = -1;
+        srv.workers[i].wakeup.fd = -1;
+    }
+    // 数据文件不存在时从空实例开始
+    if (load_store(&srv) != 0) {
+        fprintf(stderr, "Error: Failed to load %s\n", srv.filepath);
+        return 1;
+    }
+
+    // 客户端断开后写 socket 不能让进程退出；退出信号由主线程 sigwait 接收，
+    // 在创建工作线程之前屏蔽，工作线程继承屏蔽字，不会被信号打断
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    int ret = 0;
+    size_t keys = 0;
+    if (port > 0 && listen_tcp(&srv, bind_addr, port) != 0) {
+        fprintf(stderr, "Error: Failed to listen on %s:%d: %s\n", bind_addr, port, strerror(errno));
+        ret = 1;
+    } else if (srv.unix_path && listen_unix(&srv, srv.unix_path) != 0) {
+        fprintf(stderr, "Error: Failed to listen on %s: %s\n", srv.unix_path, strerror(errno));
+        ret = 1;
+    }
+    for (int i = 0; ret == 0 && i < srv.nworkers * srv.nworkers; i++) {
+        if (mk_spsc_init(&srv.queues[i], SERVER_QUEUE_SIZE) != 0) ret = 1;
+    }
+    for (int i = 0; ret == 0 && i < srv.nworkers; i++) {
+        if (init_worker(&srv, &srv.workers[i], i) != 0) {
+            fprintf(stderr, "Error: Failed to initialize worker %d\n", i);
+            ret = 1;
+        }
+        keys += mk_count(srv.workers[i].kv);
+    }
+
+    int started = 0;
+    if (ret == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        if (ncpu < 1) ncpu = 1;
+        for (; started < srv.nworkers; started++) {
+            worker_t* w = &srv.workers[started];
+            if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+                fprintf(stderr, "Error: Failed to start worker %d\n", started);
+                ret = 1;
+                break;
+            }
+            // 每个线程固定在一个核上，分片数据留在这个核的缓存里
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(started % ncpu, &cpus);
+            pthread_setaffinity_np(w->thread, sizeof(cpus), &cpus);
+        }
+    }
+    if (ret == 0) {
+        printf("minikv-server: %zu keys loaded, %d worker%s", keys, srv.nworkers, srv.nworkers > 1 ? "s" : "");
+        if (port > 0) printf(", listening on %s:%d", bind_addr, port);
+        if (srv.unix_path) printf(", unix socket %s", srv.unix_path);
+        printf("\n");
+        fflush(stdout);
+        int sig;
+        sigwait(&stop_signals, &sig);
+    }
+
+    // 通知所有线程退出并等待
+    __atomic_store_n(&srv.stop, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < started; i++) {
+        uint64_t one = 1;
+        ssize_t n = write(srv.workers[i].wakeup.fd, &one, sizeof(one));
+        (void)n;
+    }
+    for (int i = 0; i < started; i++) pthread_join(srv.workers[i].thread, NULL);
+
+    // 正常退出时写回数据文件
+    if (ret == 0 && srv.filepath && save_on_exit(&srv) != 0) {
+        fprintf(stderr, "Error: Failed to save %s\n", srv.filepath);
+        ret = 1;
+    }
+
+    // 队列和暂存链表中的消息都属于某个连接的请求，随连接一起释放
+    for (int i = 0; i < srv.nworkers; i++) {
+        worker_t* w = &srv.workers[i];
+        for (int to = 0; w->overflow_head && to < srv.nworkers; to++) {
+            while (w->overflow_head[to]) w->overflow_head[to] = w->overflow_head[to]->next;
+        }
+        destroy_worker(w);
+    }
+    for (int i = 0; i < srv.nworkers * srv.nworkers; i++) mk_spsc_destroy(&srv.queues[i]);
+    if (srv.tcp.fd >= 0) close(srv.tcp.fd);
+    if (srv.unix_sock.fd >= 0) {
+        close(srv.unix_sock.fd);
+        unlink(srv.unix_path);
+    }
+    free(srv.queues);
+    free(srv.workers);
+    return ret;
+}
@@ -0,0 +1,164 @@
+#include "slab.h"
+#include <stdlib.h>
+
+// 每页的默认大小
+#define MK_SLAB_PAGE_SIZE (64 * 1024)
+// 最小块大小，需要放得下空闲链表指针
+#define MK_SLAB_MIN_SIZE 32
+// 最大块大小，更大的块直接走 malloc
+#define MK_SLAB_MAX_SIZE (16 * 1024)
+// 页首预留给页链表指针的字节数，保持 16 字节对齐
+#define MK_SLAB_PAGE_HEADER 16
+
+// 超大块头部，组成双向链表
+typedef struct mk_slab_large {
+    struct mk_slab_large* prev;
+    struct mk_slab_large* next;
+} mk_slab_large_t;
+
+_Static_assert(sizeof(mk_slab_large_t) == MK_SLAB_LARGE_HEADER, "large block header size mismatch");
+
+// 初始化分配器
+void mk_slab_init(mk_slab_t* slab) {
+    // 计算类别大小：128 以内按 16 递增，之后每级约增长 12.5%，按 16 对齐
+    size_t size = MK_SLAB_MIN_SIZE;
+    int n = 0;
+    while (size <= MK_SLAB_MAX_SIZE && n < MK_SLAB_MAX_CLASSES) {
+        slab->class_size[n] = size;
+        slab->free_list[n] = NULL;
+        slab->page_cursor[n] = NULL;
+        slab->page_end[n] = NULL;
+        n++;
+        size_t step = size < 128 ? 16 : ((size / 8 + 15) & ~(size_t)15);
+        size += step;
+    }
+    slab->class_count = n;
+    slab->pages = NULL;
+    slab->large = NULL;
+}
+
+// 释放分配器持有的所有页和超大块
+void mk_slab_destroy(mk_slab_t* slab) {
+    // 整页释放，不需要遍历页内的块
+    void* page = slab->pages;
+    while (page) {
+        void* next = *(void**)page;
+        free(page);
+        page = next;
+    }
+    slab->pages = NULL;
+    // 释放所有超大块
+    mk_slab_large_t* large = slab->large;
+    while (large) {
+        mk_slab_large_t* next = large->next;
+        free(large);
+        large = next;
+    }
+    slab->large = NULL;
+}
+
+// 找到能容纳 size 字节的最小类别，二分查找
+static int size_class(const mk_slab_t* slab, size_t size) {
+    int lo = 0, hi = slab->class_count - 1;
+    if (size > slab->class_size[hi]) return -1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (slab->class_size[mid] >= size) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// 为类别分配新的一页
+static int refill_class(mk_slab_t* slab, int cls) {
+    size_t block = slab->class_size[cls];
+    // 每页至少放 8 个块
+    size_t page_size = MK_SLAB_PAGE_SIZE;
+    if (page_size < block * 8 + MK_SLAB_PAGE_HEADER) page_size = block * 8 + MK_SLAB_PAGE_HEADER;
+    char* page = (char*)malloc(page_size);
+    if (!page) return -1;
+    // 页首记录下一页，挂入页链表
+    *(void**)page = slab->pages;
+    slab->pages = page;
+    slab->page_cursor[cls] = page + MK_SLAB_PAGE_HEADER;
+    slab->page_end[cls] = page + page_size;
+    return 0;
+}
+
+// 分配至少 size 字节的块
+void* mk_slab_alloc(mk_slab_t* slab, size_t size, uint8_t* cls_out, size_t* usable_out) {
+    int cls = size_class(slab, size);
+    // 超大块直接 malloc，前面带上链表头
+    if (cls < 0) {
+        mk_slab_large_t* large = (mk_slab_large_t*)malloc(sizeof(mk_slab_large_t) + size);
+        if (!large) return NULL;
+        large->prev = NULL;
+        large->next = slab->large;
+        if (slab->large) slab->large->prev = large;
+        slab->large = large;
+        *cls_out = MK_SLAB_LARGE;
+        *usable_out = size;
+        return large + 1;
+    }
+    *cls_out = (uint8_t)cls;
+    *usable_out = slab->class_size[cls];
+    // 优先复用空闲链表中的块
+    void* block = slab->free_list[cls];
+    if (block) {
+        slab->free_list[cls] = *(void**)block;
+        return block;
+    }
+    // 当前页用完则申请新页
+    if (!slab->page_cursor[cls] || (size_t)(slab->page_end[cls] - slab->page_cursor[cls]) < slab->class_size[cls]) {
+        if (refill_class(slab, cls) != 0) return NULL;
+    }
+    block = slab->page_cursor[cls];
+    slab->page_cursor[cls] += slab->class_size[cls];
+    return block;
+}
+
+// 释放块
+void mk_slab_free(mk_slab_t* slab, void* ptr, uint8_t cls) {
+    if (!ptr) return;
+    // 超大块从链表摘下后直接释放
+    if (cls == MK_SLAB_LARGE) {
+        mk_slab_large_t* large = (mk_slab_large_t*)ptr - 1;
+        if (large->prev) large->prev->next = large->next;
+        else slab->large = large->next;
+        if (large->next) large->next->prev = large->prev;
+        free(large);
+        return;
+    }
+    // 普通块挂回空闲链表头部
+    *(void**)ptr = slab->free_list[cls];
+    slab->free_list[cls] = ptr;
+}
+
+// 把 src 的全部内存转交给 dst
+void mk_slab_merge(mk_slab_t* dst, mk_slab_t* src) {
+    // 页链表：把 src 的链表整体接到 dst 前面
+    if (src->pages) {
+        void* tail = src->pages;
+        while (*(void**)tail) tail = *(void**)tail;
+        *(void**)tail = dst->pages;
+        dst->pages = src->pages;
+    }
+    // 超大块链表同样整体拼接
+    if (src->large) {
+        mk_slab_large_t* tail = src->large;
+        while (tail->next) tail = tail->next;
+        tail->next = dst->large;
+        if (dst->large) dst->large->prev = tail;
+        dst->large = src->large;
+    }
+    // 各类别的空闲链表逐个拼接
+    for (int cls = 0; cls < src->class_count; cls++) {
+        void* block = src->free_list[cls];
+        if (!block) continue;
+        while (*(void**)block) block = *(void**)block;
+        *(void**)block = dst->free_list[cls];
+        dst->free_list[cls] = src->free_list[cls];
+    }
+    // src 重置为空
+    mk_slab_init(src);
+}
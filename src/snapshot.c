@@ -0,0 +1,277 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minikv.h"
+#include "minikv_internal.h"
+#include "writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * 二进制快照格式（版本 2，本机字节序）：
+ *   文件头 64 字节（mk_snap_header_t）
+ *   记录区：每条记录与内存中的 mk_node_t 布局完全一致
+ *           （节点头 + key + '\0' + value + '\0'，带过期时间的再跟 8 字节过期时刻），按 8 字节对齐补零
+ *           记录的 vcap 等于 vlen，过期时刻紧跟在 value 的 '\0' 之后
+ * 版本 1 没有过期时间，flags 所在的字节是补齐的 0，可以按版本 2 直接读取。
+ * 加载时把文件 mmap 进来，记录地址直接作为节点挂进哈希表，
+ * 不需要解析、拷贝，也不需要重新计算哈希。
+ */
+
+// 文件魔数
+#define MK_SNAP_MAGIC "MINIKVB\0"
+// 格式版本
+#define MK_SNAP_VERSION 2
+// 仍然可以加载的最早版本
+#define MK_SNAP_MIN_VERSION 1
+// 用于识别字节序
+#define MK_SNAP_ENDIAN 0x01020304u
+
+// 快照文件头
+typedef struct mk_snap_header {
+    // 魔数 "MINIKVB\0"
+    char magic[8];
+    // 格式版本
+    uint32_t version;
+    // 文件头大小，记录区从这里开始
+    uint32_t header_size;
+    // 记录条数
+    uint64_t count;
+    // 记录区总字节数
+    uint64_t data_size;
+    // 记录区的校验和
+    uint64_t checksum;
+    // 生成快照时使用的哈希函数版本
+    uint32_t hash_version;
+    // 字节序标记
+    uint32_t endian;
+    // 生成快照的实例的哈希种子，记录中的哈希值都是用它算出来的
+    uint64_t hash_seed;
+    // 保留
+    uint64_t reserved;
+} mk_snap_header_t;
+
+// 一段快照映射，挂在 mk_t 上，实例销毁时解除
+typedef struct mk_mapping {
+    void* addr;
+    size_t length;
+    struct mk_mapping* next;
+} mk_mapping_t;
+
+// 8 字节对齐
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+// 记录的总长度（含补齐）
+static size_t record_size(const mk_node_t* node) {
+    size_t tail = (node->flags & MK_NODE_EXPIRES) ? sizeof(uint64_t) : 0;
+    return ALIGN8(offsetof(mk_node_t, data) + (size_t)node->klen + 1 + node->vlen + 1 + tail);
+}
+
+// 按 8 字节字计算校验和，len 必须是 8 的倍数
+static uint64_t checksum_update(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// 校验和初始值
+#define MK_SNAP_CHECKSUM_SEED 0xcbf29ce484222325ULL
+
+// 判断文件是否为二进制快照
+int mk_file_is_binary(const char* filepath) {
+    if (!filepath) return 0;
+    FILE* fp = fopen(filepath, "rb");
+    if (!fp) return 0;
+    char magic[8];
+    int ok = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, MK_SNAP_MAGIC, 8) == 0;
+    fclose(fp);
+    return ok;
+}
+
+// 把一个节点写成一条记录，已经过期的节点不写
+// 记录直接在写缓冲中拼装，只有超过一块的记录才先拼在 buf 里
+void mk_snapshot_write_node(const mk_node_t* node, void* user_data) {
+    mk_dump_t* w = (mk_dump_t*)user_data;
+    if (w->progress) __atomic_fetch_add(w->progress, 1, __ATOMIC_RELAXED);
+    if (w->out->error || mk_node_expired(node)) return;
+    size_t size = record_size(node);
+    char* dst = mk_writer_reserve(w->out, size);
+    if (!dst) {
+        if (w->out->error) return;
+        // 缓冲区不够则扩大
+        if (size > w->cap) {
+            char* bigger = (char*)realloc(w->buf, size);
+            if (!bigger) {
+                w->out->error = 1;
+                return;
+            }
+            w->buf = bigger;
+            w->cap = size;
+        }
+        dst = w->buf;
+    }
+    // 按节点布局拼装记录，补齐部分清零，保证文件内容确定
+    memset(dst, 0, size);
+    mk_node_t* rec = (mk_node_t*)dst;
+    rec->hash = node->hash;
+    rec->klen = node->klen;
+    rec->vlen = node->vlen;
+    rec->vcap = node->vlen;
+    rec->cls = MK_NODE_MAPPED;
+    rec->flags = node->flags & MK_NODE_EXPIRES;
+    memcpy(NODE_KEY(rec), NODE_KEY(node), node->klen + 1);
+    memcpy(NODE_VALUE(rec), NODE_VALUE(node), node->vlen + 1);
+    if (rec->flags) {
+        uint64_t expire = mk_node_expire(node);
+        memcpy(NODE_EXPIRE(rec), &expire, sizeof(expire));
+    }
+    w->checksum = checksum_update(w->checksum, dst, size);
+    if (dst == w->buf) mk_writer_put(w->out, dst, size);
+    else mk_writer_advance(w->out, size);
+    w->count++;
+    w->data_size += size;
+}
+
+// 先写占位文件头，记录写完后再回填
+void mk_snapshot_begin(mk_dump_t* d) {
+    mk_snap_header_t header;
+    memset(&header, 0, sizeof(header));
+    d->checksum = MK_SNAP_CHECKSUM_SEED;
+    mk_writer_put(d->out, &header, sizeof(header));
+}
+
+// 回填文件头
+void mk_snapshot_end(mk_dump_t* d) {
+    mk_snap_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MK_SNAP_MAGIC, 8);
+    header.version = MK_SNAP_VERSION;
+    header.header_size = sizeof(header);
+    header.count = d->count;
+    header.data_size = d->data_size;
+    header.checksum = d->checksum;
+    header.hash_version = MK_HASH_VERSION;
+    header.hash_seed = d->seed;
+    header.endian = MK_SNAP_ENDIAN;
+    if (!d->out->error) mk_writer_pwrite(d->out, &header, sizeof(header), 0);
+}
+
+// 以二进制快照格式保存，经写入器先写临时文件、落盘后再 rename
+int mk_snapshot_save(mk_t* kv, const char* filepath, uint64_t* progress) {
+    mk_dump_t* d = mk_dump_open(filepath, 1, kv->seed, progress);
+    if (!d) return 1;
+    mk_dump_add(d, kv);
+    return mk_dump_finish(d, kv);
+}
+
+// 检查文件头和记录区边界，返回 0 表示合法
+static int validate_header(const mk_snap_header_t* header, size_t file_size) {
+    if (memcmp(header->magic, MK_SNAP_MAGIC, 8) != 0) return -1;
+    if (header->version < MK_SNAP_MIN_VERSION || header->version > MK_SNAP_VERSION) return -1;
+    if (header->endian != MK_SNAP_ENDIAN) return -1;
+    if (header->header_size != sizeof(mk_snap_header_t)) return -1;
+    if (header->data_size != file_size - sizeof(mk_snap_header_t)) return -1;
+    // count 不在校验和覆盖范围内，按最短记录（空键空值）算出上限；与记录的精确对应由逐条遍历检查
+    if (header->count > header->data_size / ALIGN8(offsetof(mk_node_t, data) + 2)) return -1;
+    return 0;
+}
+
+// mmap 二进制快照并挂入哈希表
+int mk_snapshot_load(mk_t* kv, const char* filepath) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(mk_snap_header_t)) {
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    // 私有只读映射；节点被修改时会复制到 slab，不会写回映射
+    char* base = (char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    posix_madvise(base, length, POSIX_MADV_SEQUENTIAL);
+
+    const mk_snap_header_t* header = (const mk_snap_header_t*)base;
+    const char* data = base + sizeof(mk_snap_header_t);
+    // 校验文件头和校验和，失败时不修改实例
+    if (validate_header(header, length) != 0 ||
+        checksum_update(MK_SNAP_CHECKSUM_SEED, data, header->data_size) != header->checksum) {
+        munmap(base, length);
+        return -2;
+    }
+    // 空的普通实例直接沿用快照的种子，这样记录中的哈希值仍然有效
+    // 并发实例可能正被其他线程写入，不能更换种子
+    if (header->hash_version == MK_HASH_VERSION && !kv->shards && kv->count == 0) {
+        kv->seed = header->hash_seed;
+    }
+    // 哈希函数和种子都一致时节点可以原样使用，否则需要重新计算哈希并复制到 slab
+    int reuse = header->hash_version == MK_HASH_VERSION && header->hash_seed == kv->seed;
+    // 映射记录要在节点挂入之前分配好，之后一旦有节点指向映射就不能再解除
+    mk_mapping_t* mapping = reuse ? (mk_mapping_t*)malloc(sizeof(mk_mapping_t)) : NULL;
+    if ((reuse && !mapping) || mk_reserve(kv, mk_count(kv) + header->count) != 0) {
+        free(mapping);
+        munmap(base, length);
+        return -1;
+    }
+    size_t offset = 0;
+    int ret = 0;
+    for (uint64_t i = 0; i < header->count; i++) {
+        // 记录头必须完整落在记录区内
+        if (header->data_size - offset < offsetof(mk_node_t, data)) {
+            ret = -2;
+            break;
+        }
+        mk_node_t* node = (mk_node_t*)(data + offset);
+        size_t size = record_size(node);
+        // 带过期时间的记录 vcap 必须等于 vlen，过期时刻才落在记录内
+        if (size > header->data_size - offset || node->cls != MK_NODE_MAPPED ||
+            ((node->flags & MK_NODE_EXPIRES) && node->vcap != node->vlen)) {
+            ret = -2;
+            break;
+        }
+        if (reuse) {
+            ret = mk_put_node(kv, node);
+        } else {
+            uint64_t hash = mk_hash_bytes(kv, NODE_KEY(node), node->klen);
+            ret = mk_set_entry(kv, NODE_KEY(node), node->klen, hash, NODE_VALUE(node), node->vlen,
+                               mk_node_expire(node));
+        }
+        if (ret != 0) break;
+        offset += size;
+    }
+    // 节点没有引用映射时可以立即解除
+    if (!reuse) {
+        munmap(base, length);
+        return ret;
+    }
+    // 记录映射，实例销毁时解除
+    mapping->addr = base;
+    mapping->length = length;
+    // 并发实例中可能有多个线程同时加载
+    pthread_mutex_lock(&kv->meta_lock);
+    mapping->next = kv->mappings;
+    kv->mappings = mapping;
+    pthread_mutex_unlock(&kv->meta_lock);
+    return ret;
+}
+
+// 解除所有快照映射
+void mk_snapshot_release(mk_t* kv) {
+    mk_mapping_t* mapping = kv->mappings;
+    while (mapping) {
+        mk_mapping_t* next = mapping->next;
+        munmap(mapping->addr, mapping->length);
+        free(mapping);
+        mapping = next;
+    }
+    kv->mappings = NULL;
+}
@@ -0,0 +1,52 @@
+#include "spsc.h"
+#include <stdlib.h>
+
+// 初始化队列
+int mk_spsc_init(mk_spsc_t* q, size_t capacity) {
+    size_t n = 2;
+    while (n < capacity) n *= 2;
+    q->items = (void**)malloc(n * sizeof(void*));
+    if (!q->items) return -1;
+    q->mask = n - 1;
+    q->head = 0;
+    q->tail = 0;
+    q->cached_head = 0;
+    q->cached_tail = 0;
+    return 0;
+}
+
+// 释放队列存储
+void mk_spsc_destroy(mk_spsc_t* q) {
+    free(q->items);
+    q->items = NULL;
+}
+
+// 放入元素：先写槽位，再以 release 发布新的 tail
+int mk_spsc_push(mk_spsc_t* q, void* item) {
+    size_t tail = q->tail;
+    if (tail - q->cached_head > q->mask) {
+        // 按缓存的 head 看已经满了，重新读取消费者的进度
+        q->cached_head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (tail - q->cached_head > q->mask) return -1;
+    }
+    q->items[tail & q->mask] = item;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// 取出元素：acquire 读到 tail 之后槽位内容可见，取完以 release 归还槽位
+void* mk_spsc_pop(mk_spsc_t* q) {
+    size_t head = q->head;
+    if (head == q->cached_tail) {
+        q->cached_tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (head == q->cached_tail) return NULL;
+    }
+    void* item = q->items[head & q->mask];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+// 近似判断队列是否为空
+int mk_spsc_empty(const mk_spsc_t* q) {
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
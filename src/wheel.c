@@ -0,0 +1,230 @@
+#define _POSIX_C_SOURCE 200809L
+#include "wheel.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 每层槽数的位数，每层 64 个槽，非空槽正好用一个 64 位掩码表示
+#define MK_WHEEL_BITS 6
+#define MK_WHEEL_SIZE (1 << MK_WHEEL_BITS)
+// 层数，6 层覆盖 2^36 毫秒（约 2.2 年）
+#define MK_WHEEL_LEVELS 6
+// 时间轮能直接表示的最大时间差
+#define MK_WHEEL_RANGE (1ULL << (MK_WHEEL_BITS * MK_WHEEL_LEVELS))
+// 散列表的初始桶数
+#define MK_WHEEL_BUCKETS 64
+
+// 定时器：挂在某一层某个槽的双向链表上，同时挂在按节点查找的散列表中
+typedef struct mk_timer {
+    struct mk_timer* prev;
+    struct mk_timer* next;
+    // 散列表中的下一个
+    struct mk_timer* hnext;
+    mk_node_t* node;
+    uint64_t expire;
+    // 所在的层和槽
+    uint8_t level;
+    uint8_t slot;
+} mk_timer_t;
+
+struct mk_wheel {
+    // 下一个待处理的毫秒，之前的时刻都已处理完
+    uint64_t now;
+    // 每层非空槽的掩码
+    uint64_t occupied[MK_WHEEL_LEVELS];
+    mk_timer_t* slots[MK_WHEEL_LEVELS][MK_WHEEL_SIZE];
+    // 按节点查找定时器，桶数为 2 的幂，用节点中的哈希值选桶
+    mk_timer_t** buckets;
+    size_t nbuckets;
+    size_t count;
+};
+
+// 创建空时间轮
+mk_wheel_t* mk_wheel_create(uint64_t now) {
+    mk_wheel_t* wheel = (mk_wheel_t*)calloc(1, sizeof(mk_wheel_t));
+    if (!wheel) return NULL;
+    wheel->buckets = (mk_timer_t**)calloc(MK_WHEEL_BUCKETS, sizeof(mk_timer_t*));
+    if (!wheel->buckets) {
+        free(wheel);
+        return NULL;
+    }
+    wheel->nbuckets = MK_WHEEL_BUCKETS;
+    wheel->now = now;
+    return wheel;
+}
+
+// 释放时间轮和所有定时器
+void mk_wheel_destroy(mk_wheel_t* wheel) {
+    if (!wheel) return;
+    for (size_t i = 0; i < wheel->nbuckets; i++) {
+        mk_timer_t* t = wheel->buckets[i];
+        while (t) {
+            mk_timer_t* next = t->hnext;
+            free(t);
+            t = next;
+        }
+    }
+    free(wheel->buckets);
+    free(wheel);
+}
+
+// 登记的定时器数量
+size_t mk_wheel_count(const mk_wheel_t* wheel) {
+    return wheel ? wheel->count : 0;
+}
+
+// 按过期时间与当前时间的差选择层和槽，挂到槽的链表头
+// 第 i 层放时间差在 [64^i, 64^(i+1)) 的定时器，槽号取过期时间的第 i 组 6 位，
+// 这个槽下一次被下放正好是在过期时间所在的 64^i 毫秒区间开始时
+static void place(mk_wheel_t* wheel, mk_timer_t* t) {
+    uint64_t when = t->expire < wheel->now ? wheel->now : t->expire;
+    if (when - wheel->now >= MK_WHEEL_RANGE) when = wheel->now + MK_WHEEL_RANGE - 1;
+    uint64_t diff = when - wheel->now;
+    int level = 0;
+    while (level < MK_WHEEL_LEVELS - 1 && diff >= (1ULL << (MK_WHEEL_BITS * (level + 1)))) level++;
+    int slot = (int)((when >> (MK_WHEEL_BITS * level)) & (MK_WHEEL_SIZE - 1));
+    t->level = (uint8_t)level;
+    t->slot = (uint8_t)slot;
+    t->prev = NULL;
+    t->next = wheel->slots[level][slot];
+    if (t->next) t->next->prev = t;
+    wheel->slots[level][slot] = t;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+// 从所在的槽中摘下，槽空了清掉掩码位
+static void unlink_slot(mk_wheel_t* wheel, mk_timer_t* t) {
+    if (t->prev) t->prev->next = t->next;
+    else wheel->slots[t->level][t->slot] = t->next;
+    if (t->next) t->next->prev = t->prev;
+    if (!wheel->slots[t->level][t->slot]) wheel->occupied[t->level] &= ~(1ULL << t->slot);
+}
+
+// 在散列表中查找节点的定时器，通过 link 返回指向它的指针，便于删除
+static mk_timer_t** find_link(mk_wheel_t* wheel, const mk_node_t* node) {
+    mk_timer_t** link = &wheel->buckets[node->hash & (wheel->nbuckets - 1)];
+    while (*link && (*link)->node != node) link = &(*link)->hnext;
+    return link;
+}
+
+// 定时器数量超过桶数时散列表加倍
+static void grow_buckets(mk_wheel_t* wheel) {
+    size_t n = wheel->nbuckets * 2;
+    mk_timer_t** buckets = (mk_timer_t**)calloc(n, sizeof(mk_timer_t*));
+    // 内存不足时保持原来的桶数，只是链变长
+    if (!buckets) return;
+    for (size_t i = 0; i < wheel->nbuckets; i++) {
+        mk_timer_t* t = wheel->buckets[i];
+        while (t) {
+            mk_timer_t* next = t->hnext;
+            mk_timer_t** head = &buckets[t->node->hash & (n - 1)];
+            t->hnext = *head;
+            *head = t;
+            t = next;
+        }
+    }
+    free(wheel->buckets);
+    wheel->buckets = buckets;
+    wheel->nbuckets = n;
+}
+
+// 登记或更新节点的过期时间
+int mk_wheel_set(mk_wheel_t* wheel, const mk_node_t* old, mk_node_t* node, uint64_t expire) {
+    mk_timer_t* t = old ? *find_link(wheel, old) : NULL;
+    if (t) {
+        // 同一个 key 的新旧节点哈希值相同，仍在同一个桶里
+        unlink_slot(wheel, t);
+        t->node = node;
+    } else {
+        t = (mk_timer_t*)malloc(sizeof(mk_timer_t));
+        if (!t) return -1;
+        t->node = node;
+        mk_timer_t** head = &wheel->buckets[node->hash & (wheel->nbuckets - 1)];
+        t->hnext = *head;
+        *head = t;
+        if (++wheel->count > wheel->nbuckets) grow_buckets(wheel);
+    }
+    t->expire = expire;
+    place(wheel, t);
+    return 0;
+}
+
+// 从槽和散列表中摘下并释放定时器
+static void drop(mk_wheel_t* wheel, mk_timer_t** link) {
+    mk_timer_t* t = *link;
+    unlink_slot(wheel, t);
+    *link = t->hnext;
+    wheel->count--;
+    free(t);
+}
+
+// 摘下节点的定时器
+void mk_wheel_remove(mk_wheel_t* wheel, const mk_node_t* node) {
+    mk_timer_t** link = find_link(wheel, node);
+    if (*link) drop(wheel, link);
+}
+
+// 循环右移，让 shift 号槽变成第 0 位
+static uint64_t rotate_right(uint64_t v, unsigned shift) {
+    return shift ? (v >> shift) | (v << (64 - shift)) : v;
+}
+
+// 下一个需要处理的时刻：各层下一个非空槽被处理的时刻中最早的一个
+// 第 0 层的槽在它对应的那一毫秒处理；第 i 层的槽在槽号对应的区间开始时下放
+static uint64_t next_event(const mk_wheel_t* wheel) {
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < MK_WHEEL_LEVELS; level++) {
+        if (!wheel->occupied[level]) continue;
+        unsigned shift = (unsigned)(MK_WHEEL_BITS * level);
+        // 不早于 now 的第一个区间
+        uint64_t window = (wheel->now + (1ULL << shift) - 1) >> shift;
+        unsigned idx = (unsigned)(window & (MK_WHEEL_SIZE - 1));
+        uint64_t k = (uint64_t)__builtin_ctzll(rotate_right(wheel->occupied[level], idx));
+        uint64_t when = (window + k) << shift;
+        if (when < next) next = when;
+    }
+    return next;
+}
+
+// 处理时刻 now 的下放：now 是哪些层的区间起点，就下放这些层中 now 对应的槽
+// 从高层往低层处理，高层下放到低层当前槽的定时器会在同一时刻继续下放，不会错过这一轮
+static void cascade(mk_wheel_t* wheel) {
+    int top = 0;
+    while (top < MK_WHEEL_LEVELS - 1 && !(wheel->now & ((1ULL << (MK_WHEEL_BITS * (top + 1))) - 1))) top++;
+    for (int level = top; level >= 1; level--) {
+        unsigned shift = (unsigned)(MK_WHEEL_BITS * level);
+        int slot = (int)((wheel->now >> shift) & (MK_WHEEL_SIZE - 1));
+        mk_timer_t* t = wheel->slots[level][slot];
+        wheel->slots[level][slot] = NULL;
+        wheel->occupied[level] &= ~(1ULL << slot);
+        while (t) {
+            mk_timer_t* next = t->next;
+            place(wheel, t);
+            t = next;
+        }
+    }
+}
+
+// 推进时间轮到 now
+size_t mk_wheel_advance(mk_wheel_t* wheel, uint64_t now, size_t max,
+                        void (*expire)(mk_node_t* node, void* user_data), void* user_data) {
+    size_t expired = 0;
+    while (wheel->count > 0) {
+        uint64_t when = next_event(wheel);
+        if (when > now) break;
+        wheel->now = when;
+        cascade(wheel);
+        int slot = (int)(when & (MK_WHEEL_SIZE - 1));
+        while (wheel->slots[0][slot]) {
+            // 停在这一毫秒，下次继续处理剩下的
+            if (expired == max) return expired;
+            mk_node_t* node = wheel->slots[0][slot]->node;
+            drop(wheel, find_link(wheel, node));
+            expire(node, user_data);
+            expired++;
+        }
+        wheel->now = when + 1;
+    }
+    // 到 now 为止没有别的事件，直接跳过这段时间
+    if (now >= wheel->now) wheel->now = now + 1;
+    return expired;
+}
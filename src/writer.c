@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+#include "writer.h"
+#include "minikv.h"
+#include "minikv_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+int mk_writer_open(mk_writer_t* w, const char* filepath) {
+    memset(w, 0, sizeof(*w));
+    w->start_ns = monotonic_ns();
+    w->tmp_path = mk_temp_path(filepath);
+    if (!w->tmp_path) return -1;
+    for (int i = 0; i < MK_WRITER_BLOCKS; i++) {
+        void* block = NULL;
+        if (posix_memalign(&block, 4096, MK_WRITER_BLOCK) != 0) {
+            for (int j = 0; j < i; j++) free(w->blocks[j]);
+            free(w->tmp_path);
+            return -1;
+        }
+        w->blocks[i] = (char*)block;
+    }
+    // 临时文件名每次保存都不同，O_EXCL 保证不会截断别人正在写的文件（例如崩溃遗留的同名文件）
+    w->fd = open(w->tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (w->fd < 0) {
+        for (int i = 0; i < MK_WRITER_BLOCKS; i++) free(w->blocks[i]);
+        free(w->tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// 用一次 writev 提交所有缓冲块，extra 不为空时跟在最后；处理被信号打断和只写了一部分的情况
+static int flush_blocks(mk_writer_t* w, const void* extra, size_t extra_len) {
+    struct iovec iov[MK_WRITER_BLOCKS + 1];
+    int cnt = 0;
+    for (int i = 0; i <= w->cur && i < MK_WRITER_BLOCKS; i++) {
+        if (!w->used[i]) continue;
+        iov[cnt].iov_base = w->blocks[i];
+        iov[cnt].iov_len = w->used[i];
+        cnt++;
+    }
+    if (extra_len) {
+        iov[cnt].iov_base = (void*)extra;
+        iov[cnt].iov_len = extra_len;
+        cnt++;
+    }
+    memset(w->used, 0, sizeof(w->used));
+    w->cur = 0;
+    struct iovec* next = iov;
+    while (cnt > 0 && !w->error) {
+        ssize_t n = writev(w->fd, next, cnt);
+        if (n < 0) {
+            if (errno != EINTR) w->error = 1;
+            continue;
+        }
+        if (n == 0) {
+            w->error = 1;
+            break;
+        }
+        w->bytes += (uint64_t)n;
+        // 跳过已经写完的块，剩下一部分的块从未写的位置继续
+        while (cnt > 0 && (size_t)n >= next->iov_len) {
+            n -= (ssize_t)next->iov_len;
+            next++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            next->iov_base = (char*)next->iov_base + n;
+            next->iov_len -= (size_t)n;
+        }
+    }
+    return w->error ? -1 : 0;
+}
+
+char* mk_writer_reserve(mk_writer_t* w, size_t n) {
+    if (w->error || n > MK_WRITER_BLOCK) return NULL;
+    if (MK_WRITER_BLOCK - w->used[w->cur] < n) {
+        // 当前块放不下就换下一块，所有块都用过了才提交
+        if (w->cur + 1 < MK_WRITER_BLOCKS) w->cur++;
+        else if (flush_blocks(w, NULL, 0) != 0) return NULL;
+    }
+    return w->blocks[w->cur] + w->used[w->cur];
+}
+
+void mk_writer_advance(mk_writer_t* w, size_t n) {
+    w->used[w->cur] += n;
+}
+
+int mk_writer_put(mk_writer_t* w, const void* data, size_t n) {
+    if (w->error) return -1;
+    // 大块数据不拷贝，连同已缓冲的内容一次提交
+    if (n >= MK_WRITER_BLOCK) return flush_blocks(w, data, n);
+    const char* src = (const char*)data;
+    while (n > 0) {
+        size_t room = MK_WRITER_BLOCK - w->used[w->cur];
+        if (room == 0) {
+            if (w->cur + 1 < MK_WRITER_BLOCKS) w->cur++;
+            else if (flush_blocks(w, NULL, 0) != 0) return -1;
+            continue;
+        }
+        size_t chunk = n < room ? n : room;
+        memcpy(w->blocks[w->cur] + w->used[w->cur], src, chunk);
+        w->used[w->cur] += chunk;
+        src += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+int mk_writer_pwrite(mk_writer_t* w, const void* data, size_t n, uint64_t off) {
+    if (flush_blocks(w, NULL, 0) != 0) return -1;
+    const char* src = (const char*)data;
+    while (n > 0) {
+        ssize_t r = pwrite(w->fd, src, n, (off_t)off);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            w->error = 1;
+            return -1;
+        }
+        src += r;
+        n -= (size_t)r;
+        off += (uint64_t)r;
+    }
+    return 0;
+}
+
+// fsync 文件所在的目录，让 rename 本身也落盘
+static int fsync_parent(const char* filepath) {
+    const char* slash = strrchr(filepath, '/');
+    char* dir;
+    if (!slash) dir = strdup(".");
+    else if (slash == filepath) dir = strdup("/");
+    else dir = strndup(filepath, (size_t)(slash - filepath));
+    if (!dir) return -1;
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    free(dir);
+    if (fd < 0) return -1;
+    int ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+int mk_writer_finish(mk_writer_t* w, const char* filepath) {
+    flush_blocks(w, NULL, 0);
+    if (!w->error && fsync(w->fd) != 0) w->error = 1;
+    if (close(w->fd) != 0) w->error = 1;
+    if (!w->error && rename(w->tmp_path, filepath) != 0) w->error = 1;
+    if (w->error) unlink(w->tmp_path);
+    else if (fsync_parent(filepath) != 0) w->error = 1;
+    for (int i = 0; i < MK_WRITER_BLOCKS; i++) free(w->blocks[i]);
+    free(w->tmp_path);
+    w->tmp_path = NULL;
+    w->elapsed_ns = monotonic_ns() - w->start_ns;
+    return w->error ? 1 : 0;
+}
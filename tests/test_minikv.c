@@ -1,10 +1,21 @@
 #define _POSIX_C_SOURCE 200809L
 #include <CUnit/Basic.h>
 #include "../include/minikv.h"
+#include "../include/resp.h"
+#include "../include/spsc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <dirent.h>
 
 static mk_t* kv = NULL;
 
@@ -175,7 +186,1381 @@ static void test_overwrite_does_not_increase_count(void) {
     mk_destroy(mk); // 清理资源
 }
 
+// 测试大量插入触发扩容、删除后回填，数据仍然完整
+static void test_many_keys_resize_and_delete(void) {
+    mk_t* mk = mk_create(); // 创建键值存储实例
+    char key[32], val[32];
+    for (int i = 0; i < 5000; i++) { // 插入足够多的键以触发多次扩容
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        CU_ASSERT_EQUAL(mk_set(mk, key, val), 0);
+    }
+    CU_ASSERT_EQUAL(mk_count(mk), 5000); // 验证计数
+    for (int i = 0; i < 5000; i += 2) { // 删除一半的键
+        snprintf(key, sizeof(key), "k%d", i);
+        mk_del(mk, key);
+    }
+    CU_ASSERT_EQUAL(mk_count(mk), 2500); // 验证删除后的计数
+    int ok = 1;
+    for (int i = 0; i < 5000; i++) { // 验证剩余的键都能查到，已删除的查不到
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        const char* got = mk_get(mk, key);
+        if (i % 2 == 0 ? got != NULL : (!got || strcmp(got, val) != 0)) ok = 0;
+    }
+    CU_ASSERT_TRUE(ok);
+    mk_destroy(mk); // 清理资源
+}
+
+// 测试渐进式迁移期间交替写入、覆盖和删除，结果与预期一致
+static void test_interleaved_ops_during_rehash(void) {
+    mk_t* mk = mk_create(); // 创建键值存储实例
+    char key[32], val[32];
+    int ok = 1;
+    for (int i = 0; i < 4000; i++) { // 插入新键的同时删除和覆盖旧键
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        mk_set(mk, key, val);
+        if (i % 3 == 0 && i > 0) { // 删除前一个键
+            snprintf(key, sizeof(key), "k%d", i - 1);
+            mk_del(mk, key);
+        }
+        if (i % 5 == 0) { // 覆盖较早的键
+            snprintf(key, sizeof(key), "k%d", i / 2);
+            snprintf(val, sizeof(val), "w%d", i / 2);
+            mk_set(mk, key, val);
+        }
+        snprintf(key, sizeof(key), "k%d", i / 4); // 随时检查较早的键
+        if (!mk_get(mk, key) && (i / 4 + 1) % 3 != 0) ok = 0;
+    }
+    CU_ASSERT_TRUE(ok);
+    size_t expected = 0;
+    for (int i = 0; i < 4000; i++) { // 统计应存在的键数
+        snprintf(key, sizeof(key), "k%d", i);
+        if (mk_get(mk, key)) expected++;
+    }
+    CU_ASSERT_EQUAL(mk_count(mk), expected); // 计数与实际可查到的键一致
+    mk_destroy(mk); // 清理资源
+}
+
+// 测试共享前缀、长度不同的 key 互不干扰
+static void test_shared_prefix_keys(void) {
+    mk_t* mk = mk_create(); // 创建键值存储实例
+    mk_set(mk, "svc.eu.host1.cpu", "1"); // 设置共享前缀的多个键
+    mk_set(mk, "svc.eu.host1.cpu.max", "2");
+    mk_set(mk, "svc.eu.host1", "3");
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "svc.eu.host1.cpu"), "1"); // 各自取到自己的值
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "svc.eu.host1.cpu.max"), "2");
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "svc.eu.host1"), "3");
+    CU_ASSERT_PTR_NULL(mk_get(mk, "svc.eu.host1.cp")); // 前缀本身不存在
+    mk_destroy(mk); // 清理资源
+}
+
+// 测试覆盖时 value 变长（重新分配节点）和变短（原地覆盖）
+static void test_overwrite_grow_and_shrink_value(void) {
+    mk_t* mk = mk_create(); // 创建键值存储实例
+    char big[2000];
+    memset(big, 'x', sizeof(big) - 1); // 构造一个很长的值
+    big[sizeof(big) - 1] = '\0';
+    mk_set(mk, "grow", "s"); // 先设置短值
+    mk_set(mk, "other", "o");
+    CU_ASSERT_EQUAL(mk_set(mk, "grow", big), 0); // 覆盖为长值，需要更大的节点
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "grow"), big);
+    CU_ASSERT_EQUAL(mk_set(mk, "grow", "short"), 0); // 再覆盖为短值，原地写入
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "grow"), "short");
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "other"), "o"); // 其他键不受影响
+    CU_ASSERT_EQUAL(mk_count(mk), 2);
+    mk_destroy(mk); // 清理资源
+}
+
+// 测试日志模式：set/del 只追加日志，重新加载时重放快照 + 日志
+static void test_log_append_and_replay(void) {
+    char* path = write_temp_file("a=1\nb=2\n"); // 创建初始快照
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    char log_path[256];
+    snprintf(log_path, sizeof(log_path), "%s.log", path);
+
+    mk_t* mk1 = mk_create(); // 加载快照后开启日志
+    mk_load(mk1, path);
+    CU_ASSERT_EQUAL(mk_log_open(mk1, path, MK_FSYNC_NEVER, 0), 0);
+    CU_ASSERT_EQUAL(mk_set(mk1, "c", "three = 3"), 0); // 值中包含空格和等号
+    CU_ASSERT_EQUAL(mk_del(mk1, "a"), 0);
+    CU_ASSERT_EQUAL(mk_set(mk1, "b", "22"), 0);
+    mk_destroy(mk1); // 没有调用 mk_save
+
+    mk_t* mk2 = mk_create(); // 重新加载：快照 + 日志
+    CU_ASSERT_EQUAL(mk_load(mk2, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk2), 2);
+    CU_ASSERT_PTR_NULL(mk_get(mk2, "a"));
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "b"), "22");
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "c"), "three = 3");
+
+    CU_ASSERT_EQUAL(mk_log_open(mk2, path, MK_FSYNC_ALWAYS, 0), 0); // 压缩日志
+    CU_ASSERT_EQUAL(mk_log_compact(mk2), 0);
+    mk_destroy(mk2);
+
+    FILE* fp = fopen(log_path, "r"); // 压缩后日志为空
+    CU_ASSERT_PTR_NOT_NULL(fp);
+    if (fp) {
+        CU_ASSERT_EQUAL(fgetc(fp), EOF);
+        fclose(fp);
+    }
+    mk_t* mk3 = mk_create(); // 只靠新快照也能得到同样的数据
+    mk_load(mk3, path);
+    CU_ASSERT_EQUAL(mk_count(mk3), 2);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk3, "c"), "three = 3");
+    mk_destroy(mk3);
+
+    unlink(log_path); // 删除临时文件
+    unlink(path);
+    free(path);
+}
+
+// 测试日志末尾写了一半的记录会被忽略并截掉
+static void test_log_torn_tail(void) {
+    char* path = write_temp_file(""); // 空快照
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    char log_path[256];
+    snprintf(log_path, sizeof(log_path), "%s.log", path);
+    FILE* fp = fopen(log_path, "w"); // 一条完整记录 + 一条不完整记录
+    fputs("S 1 1\nx1\nS 1 5\nyab", fp);
+    fclose(fp);
+
+    mk_t* mk = mk_create();
+    CU_ASSERT_EQUAL(mk_load(mk, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk), 1); // 只有完整的记录生效
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "x"), "1");
+    CU_ASSERT_EQUAL(mk_log_open(mk, path, MK_FSYNC_NEVER, 0), 0); // 之后追加的记录可以被重放
+    mk_set(mk, "z", "26");
+    mk_destroy(mk);
+
+    mk = mk_create();
+    mk_load(mk, path);
+    CU_ASSERT_EQUAL(mk_count(mk), 2);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "z"), "26");
+    mk_destroy(mk);
+
+    unlink(log_path); // 删除临时文件
+    unlink(path);
+    free(path);
+}
+
+// 测试日志中间损坏的记录：超过 32 位的长度不会导致越界写，损坏时加载报错且不截断文件，之后的记录保留
+static void test_log_bad_length(void) {
+    char* path = write_temp_file("");
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    char log_path[256];
+    snprintf(log_path, sizeof(log_path), "%s.log", path);
+    const char* bad[] = { "S 1 1\nx1\nS 18446744073709551615 1\nab\nS 1 1\ny2\n",
+                          "S 1 1\nx1\nS 4294967296 1\nab\nS 1 1\ny2\n",
+                          "S 1 1\nx1\nX 1 99999999999 0\nab\nS 1 1\ny2\n",
+                          "S 1 1\nx1\nQ 1 1\nab\nS 1 1\ny2\n",
+                          "S 1 1\nx1\nS 1 1\nabX\nS 1 1\ny2\n" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        FILE* fp = fopen(log_path, "w");
+        fputs(bad[i], fp);
+        fclose(fp);
+        mk_t* mk = mk_create();
+        CU_ASSERT(mk_load(mk, path) < 0);
+        CU_ASSERT_STRING_EQUAL(mk_get(mk, "x"), "1");
+        mk_destroy(mk);
+        struct stat sb;
+        CU_ASSERT_EQUAL(stat(log_path, &sb), 0);
+        CU_ASSERT_EQUAL((size_t)sb.st_size, strlen(bad[i]));
+    }
+    unlink(log_path);
+    unlink(path);
+    free(path);
+}
+
+// 当前目录中 "<path>." 开头、".tmp" 结尾的临时文件个数
+static int count_temp_files(const char* path) {
+    DIR* dir = opendir(".");
+    if (!dir) return -1;
+    size_t plen = strlen(path);
+    int n = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len > plen + 4 && strncmp(ent->d_name, path, plen) == 0 && ent->d_name[plen] == '.' &&
+            strcmp(ent->d_name + len - 4, ".tmp") == 0) {
+            n++;
+        }
+    }
+    closedir(dir);
+    return n;
+}
+
+// 检查保存出来的文件：带过期时间的 key 仍然带着过期时间
+static void check_ttl_file(const char* path, int n) {
+    mk_t* mk = mk_create();
+    CU_ASSERT_EQUAL(mk_load(mk, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk), (size_t)n + 1);
+    char key[32];
+    int with_ttl = 0;
+    for (int i = 0; i < n; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        if (mk_ttl(mk, key) > 0) with_ttl++;
+    }
+    CU_ASSERT_EQUAL(with_ttl, n);
+    CU_ASSERT_EQUAL(mk_ttl(mk, "plain"), -1);
+    mk_destroy(mk);
+}
+
+// 测试多线程服务器加载、SAVE 和退出时保存都保留过期时间，文本和二进制数据文件各一次
+// 各线程把自己的分片依次写进同一个文件，二进制快照中各分片的记录共用文件头里的哈希种子
+static void test_server_keeps_ttl(void) {
+    const char* path = "test_server_ttl.kv";
+    const char* sock = "test_server_ttl.sock";
+    const int n = 200;
+    unsigned long long expire = (unsigned long long)time(NULL) * 1000ULL + 3600ULL * 1000ULL;
+    for (int binary = 0; binary < 2; binary++) {
+        FILE* fp = fopen(path, "w");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+        for (int i = 0; i < n; i++) fprintf(fp, "@%llu k%d=v%d\n", expire, i, i);
+        fputs("plain=1\n", fp);
+        fclose(fp);
+        if (binary) {
+            mk_t* mk = mk_create();
+            CU_ASSERT_EQUAL(mk_load(mk, path), 0);
+            CU_ASSERT_EQUAL(mk_save_binary(mk, path), 0);
+            mk_destroy(mk);
+        }
+        unlink(sock);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            freopen("/dev/null", "w", stdout);
+            execl("bin/minikv-server", "minikv-server", "-f", path, "-p", "0", "-s", sock, "-t", "4", (char*)NULL);
+            _exit(127);
+        }
+        CU_ASSERT_FATAL(pid > 0);
+        // 等 Unix socket 出现后连接
+        int fd = -1;
+        for (int i = 0; i < 300 && fd < 0; i++) {
+            struct sockaddr_un sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sun_family = AF_UNIX;
+            snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", sock);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+                close(fd);
+                fd = -1;
+                struct timespec delay = { 0, 10 * 1000 * 1000 };
+                nanosleep(&delay, NULL);
+            }
+        }
+        CU_ASSERT(fd >= 0);
+        if (fd >= 0) {
+            const char* req = "*1\r\n$4\r\nSAVE\r\n";
+            CU_ASSERT_EQUAL(write(fd, req, strlen(req)), (ssize_t)strlen(req));
+            char reply[64] = { 0 };
+            CU_ASSERT(read(fd, reply, sizeof(reply) - 1) > 0);
+            CU_ASSERT_STRING_EQUAL(reply, "+OK\r\n");
+            close(fd);
+            CU_ASSERT_EQUAL(mk_file_is_binary(path), binary); // 保持数据文件原来的格式
+            check_ttl_file(path, n);
+        }
+        // 退出时再保存一次
+        kill(pid, SIGTERM);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        CU_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        CU_ASSERT_EQUAL(mk_file_is_binary(path), binary);
+        check_ttl_file(path, n);
+        CU_ASSERT_EQUAL(count_temp_files(path), 0);
+        unlink(path);
+        unlink(sock);
+    }
+}
+
+// 测试二进制快照的保存、mmap 加载，以及加载后修改和删除
+static void test_binary_snapshot_roundtrip(void) {
+    char* path = write_temp_file(""); // 创建临时文件
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+
+    mk_t* mk1 = mk_create(); // 写入一些键值对后保存为二进制快照
+    char key[32], val[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "value %d", i);
+        mk_set(mk1, key, val);
+    }
+    CU_ASSERT_EQUAL(mk_save_binary(mk1, path), 0);
+    CU_ASSERT_EQUAL(mk_file_is_binary(path), 1);
+    mk_destroy(mk1);
+
+    mk_t* mk2 = mk_create(); // 加载并验证
+    CU_ASSERT_EQUAL(mk_load(mk2, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk2), 1000);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "k42"), "value 42");
+    CU_ASSERT_EQUAL(mk_set(mk2, "k42", "changed"), 0); // 修改映射中的节点
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "k42"), "changed");
+    CU_ASSERT_EQUAL(mk_set(mk2, "k43", ""), 0); // 空值也不能写进只读映射
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "k43"), "");
+    mk_del(mk2, "k44"); // 删除映射中的节点
+    CU_ASSERT_PTR_NULL(mk_get(mk2, "k44"));
+    CU_ASSERT_EQUAL(mk_count(mk2), 999);
+    CU_ASSERT_EQUAL(mk_save(mk2, path), 0); // 覆盖正在被映射的文件（导出为文本）
+    CU_ASSERT_EQUAL(mk_file_is_binary(path), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "k500"), "value 500"); // 映射仍然有效
+    mk_destroy(mk2);
+
+    mk_t* mk3 = mk_create(); // 文本导出的内容一致
+    CU_ASSERT_EQUAL(mk_load(mk3, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk3), 999);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk3, "k42"), "changed");
+    mk_destroy(mk3);
+
+    unlink(path); // 删除临时文件
+    free(path);
+}
+
+// 测试校验和不匹配的二进制快照会被拒绝
+// 测试快照加载到已有数据的实例：哈希种子不同，需要逐条重新计算哈希
+static void test_binary_snapshot_reseed(void) {
+    char* path = write_temp_file("");
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+
+    mk_t* mk1 = mk_create();
+    char key[32], val[32];
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "value %d", i);
+        mk_set(mk1, key, val);
+    }
+    CU_ASSERT_EQUAL(mk_save_binary(mk1, path), 0);
+    mk_destroy(mk1);
+
+    mk_t* mk2 = mk_create(); // 非空实例不会采用快照的种子
+    mk_set(mk2, "existing", "yes");
+    mk_set(mk2, "k7", "old");
+    CU_ASSERT_EQUAL(mk_load(mk2, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk2), 501);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "existing"), "yes");
+    CU_ASSERT_STRING_EQUAL(mk_get(mk2, "k7"), "value 7");
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "value %d", i);
+        const char* v = mk_get(mk2, key);
+        CU_ASSERT_PTR_NOT_NULL(v);
+        if (v) CU_ASSERT_STRING_EQUAL(v, val);
+    }
+    mk_destroy(mk2);
+
+    mk_t* mk3 = mk_create_concurrent(4); // 分片实例同样走重新哈希的路径
+    CU_ASSERT_EQUAL(mk_load(mk3, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk3), 500);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk3, "k499"), "value 499");
+    mk_destroy(mk3);
+
+    unlink(path);
+    free(path);
+}
+
+static void test_binary_snapshot_corrupt(void) {
+    char* path = write_temp_file(""); // 创建临时文件
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    mk_t* mk = mk_create();
+    mk_set(mk, "alpha", "1");
+    mk_set(mk, "beta", "2");
+    CU_ASSERT_EQUAL(mk_save_binary(mk, path), 0);
+    mk_destroy(mk);
+
+    FILE* fp = fopen(path, "r+b"); // 篡改最后一个字节
+    CU_ASSERT_PTR_NOT_NULL(fp);
+    if (fp) {
+        fseek(fp, -2, SEEK_END);
+        fputc('X', fp);
+        fclose(fp);
+    }
+    mk = mk_create();
+    CU_ASSERT_NOT_EQUAL(mk_load(mk, path), 0); // 加载失败且实例保持为空
+    CU_ASSERT_EQUAL(mk_count(mk), 0);
+    mk_destroy(mk);
+    unlink(path); // 删除临时文件
+    free(path);
+}
+
+// 篡改文件头里的记录条数：条数不在校验和范围内，过大时要在预留槽位之前拒绝，偏大一点时由逐条遍历发现
+static void test_binary_snapshot_bad_count(void) {
+    char* path = write_temp_file("");
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    uint64_t counts[] = {1ULL << 62, UINT64_MAX, 3};
+    for (int i = 0; i < 3; i++) {
+        mk_t* mk = mk_create();
+        mk_set(mk, "alpha", "1");
+        mk_set(mk, "beta", "2");
+        CU_ASSERT_EQUAL(mk_save_binary(mk, path), 0);
+        mk_destroy(mk);
+
+        FILE* fp = fopen(path, "r+b"); // count 字段紧跟在魔数、版本和文件头大小之后
+        CU_ASSERT_PTR_NOT_NULL(fp);
+        if (fp) {
+            fseek(fp, 16, SEEK_SET);
+            fwrite(&counts[i], sizeof(uint64_t), 1, fp);
+            fclose(fp);
+        }
+        mk = mk_create();
+        CU_ASSERT(mk_load(mk, path) < 0);
+        CU_ASSERT_EQUAL(mk_count(mk), 0);
+        mk_destroy(mk);
+        mk = mk_create_concurrent(4); // 并发实例按分片分摊预留数量，同样不能溢出
+        CU_ASSERT(mk_load(mk, path) < 0);
+        CU_ASSERT_EQUAL(mk_count(mk), 0);
+        mk_destroy(mk);
+    }
+    unlink(path);
+    free(path);
+}
+
+// 测试超过旧的 1024 字节行限制的长行，以及超过读缓冲区大小的行
+static void test_load_long_lines(void) {
+    size_t sizes[] = {5000, (size_t)3 << 20}; // 一行 5KB，一行 3MB
+    char* path = write_temp_file("");
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    FILE* fp = fopen(path, "w");
+    fprintf(fp, "short=1\n");
+    for (int i = 0; i < 2; i++) {
+        fprintf(fp, "long%d = ", i);
+        for (size_t j = 0; j < sizes[i]; j++) fputc('a' + (int)(j % 26), fp);
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "last=end"); // 最后一行没有换行符
+    fclose(fp);
+
+    mk_t* mk = mk_create();
+    CU_ASSERT_EQUAL(mk_load(mk, path), 0);
+    CU_ASSERT_EQUAL(mk_count(mk), 4);
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "short"), "1");
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "last"), "end");
+    for (int i = 0; i < 2; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "long%d", i);
+        const char* v = mk_get(mk, key);
+        CU_ASSERT_PTR_NOT_NULL(v);
+        if (!v) continue;
+        CU_ASSERT_EQUAL(strlen(v), sizes[i]); // 值完整，没有被截断成多行
+        CU_ASSERT_EQUAL(v[sizes[i] - 1], 'a' + (int)((sizes[i] - 1) % 26));
+    }
+    mk_destroy(mk);
+    unlink(path);
+    free(path);
+}
+
+// mk_foreach 回调：统计遍历到的条目数
+static void count_items(const char* key, const char* value, void* user_data) {
+    int* visited = (int*)user_data;
+    (void)key;
+    (void)value;
+    (*visited)++;
+}
+
+// 并发测试中每个线程的参数
+typedef struct {
+    mk_t* kv;
+    int id;
+    int errors;
+} worker_arg_t;
+
+// 每个线程写入自己的 key，反复覆盖一个共享 key，并读回自己写的值
+static void* concurrent_worker(void* p) {
+    worker_arg_t* arg = (worker_arg_t*)p;
+    char key[32], val[32];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(key, sizeof(key), "t%d.k%d", arg->id, i);
+        snprintf(val, sizeof(val), "v%d", i);
+        if (mk_set(arg->kv, key, val) != 0) arg->errors++;
+        const char* got = mk_get(arg->kv, key); // 只有本线程写这个 key，读到的值是稳定的
+        if (!got || strcmp(got, val) != 0) arg->errors++;
+        if (i % 2 == 1 && mk_del(arg->kv, key) != 0) arg->errors++; // 删掉一半
+        mk_set(arg->kv, "shared", val);
+    }
+    return NULL;
+}
+
+// 测试批量读写删除，结果与逐个操作一致
+static void test_batch_operations(void) {
+    const char* keys[40];
+    const char* vals[40];
+    char kbuf[40][16], vbuf[40][16];
+    for (int i = 0; i < 40; i++) { // 超过一组的大小，覆盖分组边界
+        snprintf(kbuf[i], sizeof(kbuf[i]), "batch%d", i);
+        snprintf(vbuf[i], sizeof(vbuf[i]), "v%d", i);
+        keys[i] = kbuf[i];
+        vals[i] = vbuf[i];
+    }
+    mk_t* mk = mk_create();
+    CU_ASSERT_EQUAL(mk_mset(mk, keys, vals, 40), 0);
+    CU_ASSERT_EQUAL(mk_count(mk), 40);
+
+    const char* bad[2] = { "ok", "bad key" };
+    CU_ASSERT_EQUAL(mk_mset(mk, bad, vals, 2), -2); // 有无效 key 时整批不写入
+    CU_ASSERT_PTR_NULL(mk_get(mk, "ok"));
+
+    const char* query[3] = { "batch7", "missing", NULL };
+    const char* out[3];
+    CU_ASSERT_EQUAL(mk_mget(mk, query, 3, out), 1);
+    CU_ASSERT_STRING_EQUAL(out[0], "v7");
+    CU_ASSERT_PTR_NULL(out[1]);
+    CU_ASSERT_PTR_NULL(out[2]);
+    const char* all[40];
+    CU_ASSERT_EQUAL(mk_mget(mk, keys, 40, all), 40);
+    CU_ASSERT_STRING_EQUAL(all[39], "v39");
+
+    CU_ASSERT_EQUAL(mk_mdel(mk, keys, 20), 20);
+    CU_ASSERT_EQUAL(mk_mdel(mk, keys, 20), 0); // 已删除的 key 不再计数
+    CU_ASSERT_EQUAL(mk_count(mk), 20);
+    CU_ASSERT_EQUAL(mk_mget(mk, keys, 40, all), 20);
+    CU_ASSERT_PTR_NULL(all[0]);
+    mk_destroy(mk);
+}
+
+// 检查 key 对应的 value 与给定字节完全一致
+static int view_equals(mk_t* mk, const char* key, size_t klen, const char* value, size_t vlen) {
+    mk_view_t v;
+    return mk_get_n(mk, key, klen, &v) == 1 && v.len == vlen && memcmp(v.data, value, vlen) == 0;
+}
+
+// 测试按长度的接口：任意字节的 key/value 经文本、二进制快照和日志都能原样读回
+static void test_binary_safe_roundtrip(void) {
+    static const char k1[] = "bin\0key";          // key 含 '\0'
+    static const char v1[] = "a\0b\nc=d %41\r\n";  // value 含 '\0'、换行、'=' 和 '%'
+    static const char k2[] = "key with spaces=";
+    static const char v2[] = "  padded  ";         // 首尾空白
+    mk_t* mk = mk_create();
+    CU_ASSERT_EQUAL(mk_set_n(mk, k1, sizeof(k1) - 1, v1, sizeof(v1) - 1), 0);
+    CU_ASSERT_EQUAL(mk_set_n(mk, k2, sizeof(k2) - 1, v2, sizeof(v2) - 1), 0);
+    CU_ASSERT_EQUAL(mk_set_n(mk, "empty", 5, NULL, 0), 0);
+    CU_ASSERT_EQUAL(mk_set_n(mk, "", 0, "x", 1), -2);
+    CU_ASSERT_EQUAL(mk_set(mk, "plain", "value"), 0);
+    CU_ASSERT_TRUE(view_equals(mk, k1, sizeof(k1) - 1, v1, sizeof(v1) - 1));
+    CU_ASSERT_TRUE(view_equals(mk, "plain", 5, "value", 5)); // 两套接口看到的是同一份数据
+    mk_view_t v;
+    CU_ASSERT_EQUAL(mk_get_n(mk, "bin", 3, &v), 0); // 前缀不会误匹配
+    CU_ASSERT_PTR_NULL(v.data);
+
+    char* path = write_temp_file("");
+    for (int format = 0; format < 2; format++) { // 文本和二进制快照
+        CU_ASSERT_EQUAL(format ? mk_save_binary(mk, path) : mk_save(mk, path), 0);
+        mk_t* loaded = mk_create();
+        mk_t* parallel = mk_create();
+        CU_ASSERT_EQUAL(mk_load(loaded, path), 0);
+        CU_ASSERT_EQUAL(mk_load_parallel(parallel, path, 2), 0);
+        mk_t* all[2] = { loaded, parallel };
+        for (int i = 0; i < 2; i++) {
+            CU_ASSERT_EQUAL(mk_count(all[i]), 4);
+            CU_ASSERT_TRUE(view_equals(all[i], k1, sizeof(k1) - 1, v1, sizeof(v1) - 1));
+            CU_ASSERT_TRUE(view_equals(all[i], k2, sizeof(k2) - 1, v2, sizeof(v2) - 1));
+            CU_ASSERT_TRUE(view_equals(all[i], "empty", 5, "", 0));
+            CU_ASSERT_STRING_EQUAL(mk_get(all[i], "plain"), "value");
+        }
+        mk_destroy(loaded);
+        mk_destroy(parallel);
+    }
+
+    // 日志模式下按长度写入和删除，重放后一致
+    char* log_path = malloc(strlen(path) + 5);
+    sprintf(log_path, "%s.log", path);
+    CU_ASSERT_EQUAL(mk_log_open(mk, path, MK_FSYNC_NEVER, 0), 0);
+    CU_ASSERT_EQUAL(mk_set_n(mk, "log\nkey", 7, "\0\0", 2), 0);
+    CU_ASSERT_EQUAL(mk_del_n(mk, k1, sizeof(k1) - 1), 0);
+    mk_log_close(mk);
+    mk_t* replayed = mk_create();
+    CU_ASSERT_EQUAL(mk_load(replayed, path), 0);
+    CU_ASSERT_TRUE(view_equals(replayed, "log\nkey", 7, "\0\0", 2));
+    CU_ASSERT_EQUAL(mk_get_n(replayed, k1, sizeof(k1) - 1, &v), 0);
+    CU_ASSERT_EQUAL(mk_count(replayed), 4);
+    mk_destroy(replayed);
+    mk_destroy(mk);
+    unlink(log_path);
+    unlink(path);
+    free(log_path);
+    free(path);
+}
+
+// 无锁读测试共享的状态
+typedef struct {
+    mk_t* kv;
+    int stop;
+    int errors;
+} lockfree_arg_t;
+
+// 写线程：反复覆盖 100 个固定 key（值的长度不断变化），并不断插入、删除临时 key 触发扩容和回填
+static void* lockfree_writer(void* p) {
+    lockfree_arg_t* arg = (lockfree_arg_t*)p;
+    char key[32], val[128];
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 100; i++) {
+            snprintf(key, sizeof(key), "fixed%d", i);
+            int n = snprintf(val, sizeof(val), "%d:", round);
+            memset(val + n, 'a' + round % 26, (size_t)(round % 60)); // 值的格式为 "round:" 加 round%60 个相同字母
+            val[n + round % 60] = '\0';
+            mk_set(arg->kv, key, val);
+        }
+        for (int i = 0; i < 200; i++) {
+            snprintf(key, sizeof(key), "tmp%d.%d", round, i);
+            mk_set(arg->kv, key, "x");
+        }
+        for (int i = 0; i < 200; i++) {
+            snprintf(key, sizeof(key), "tmp%d.%d", round, i);
+            mk_del(arg->kv, key);
+        }
+    }
+    __atomic_store_n(&arg->stop, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 读线程：在读临界区内读取固定 key，值必须始终存在且格式完整
+static void* lockfree_reader(void* p) {
+    lockfree_arg_t* arg = (lockfree_arg_t*)p;
+    char key[32];
+    int i = 0;
+    while (!__atomic_load_n(&arg->stop, __ATOMIC_ACQUIRE)) {
+        snprintf(key, sizeof(key), "fixed%d", i++ % 100);
+        mk_read_begin(arg->kv);
+        const char* v = mk_get(arg->kv, key);
+        int round = -1;
+        const char* colon = v ? strchr(v, ':') : NULL;
+        if (colon) round = atoi(v);
+        if (round < 0 || strlen(colon + 1) != (size_t)(round % 60)) {
+            __atomic_add_fetch(&arg->errors, 1, __ATOMIC_RELAXED);
+        } else {
+            for (const char* c = colon + 1; *c; c++) {
+                if (*c != 'a' + round % 26) {
+                    __atomic_add_fetch(&arg->errors, 1, __ATOMIC_RELAXED);
+                    break;
+                }
+            }
+        }
+        mk_read_end(arg->kv);
+    }
+    return NULL;
+}
+
+// 测试无锁读：写线程并发覆盖、插入、删除时，读线程读到的值始终完整有效
+static void test_concurrent_lockfree_reads(void) {
+    lockfree_arg_t arg = { mk_create_concurrent(2), 0, 0 }; // 分片少，读写更容易落在同一分片
+    CU_ASSERT_PTR_NOT_NULL(arg.kv);
+    if (!arg.kv) return;
+    for (int i = 0; i < 100; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "fixed%d", i);
+        mk_set(arg.kv, key, "0:");
+    }
+    pthread_t writer, readers[3];
+    for (int t = 0; t < 3; t++) pthread_create(&readers[t], NULL, lockfree_reader, &arg);
+    pthread_create(&writer, NULL, lockfree_writer, &arg);
+    pthread_join(writer, NULL);
+    for (int t = 0; t < 3; t++) pthread_join(readers[t], NULL);
+    CU_ASSERT_EQUAL(arg.errors, 0);
+    CU_ASSERT_EQUAL(mk_count(arg.kv), 100);
+    mk_destroy(arg.kv);
+}
+
+// 测试分片实例在多线程并发读写下结果正确
+static void test_concurrent_threads(void) {
+    mk_t* mk = mk_create_concurrent(8);
+    CU_ASSERT_PTR_NOT_NULL(mk);
+    if (!mk) return;
+    pthread_t threads[4];
+    worker_arg_t args[4];
+    for (int t = 0; t < 4; t++) {
+        args[t].kv = mk;
+        args[t].id = t;
+        args[t].errors = 0;
+        pthread_create(&threads[t], NULL, concurrent_worker, &args[t]);
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+        CU_ASSERT_EQUAL(args[t].errors, 0);
+    }
+    CU_ASSERT_EQUAL(mk_count(mk), 4 * 2500 + 1); // 每个线程留下一半，加上共享 key
+    CU_ASSERT_STRING_EQUAL(mk_get(mk, "t3.k4998"), "v4998");
+    CU_ASSERT_PTR_NULL(mk_get(mk, "t3.k4999"));
+    int visited = 0;
+    mk_foreach(mk, count_items, &visited);
+    CU_ASSERT_EQUAL((size_t)visited, mk_count(mk));
+
+    // 保存后用普通实例加载，内容一致
+    char* path = write_temp_file("");
+    CU_ASSERT_EQUAL(mk_save(mk, path), 0);
+    mk_t* plain = mk_create();
+    CU_ASSERT_EQUAL(mk_load(plain, path), 0);
+    CU_ASSERT_EQUAL(mk_count(plain), mk_count(mk));
+    CU_ASSERT_STRING_EQUAL(mk_get(plain, "t0.k0"), "v0");
+    mk_destroy(plain);
+    mk_destroy(mk);
+    unlink(path);
+    free(path);
+}
+
+// 测试多线程加载与顺序加载结果一致，包括重复 key 的覆盖顺序
+static void test_load_parallel_matches_sequential(void) {
+    char* path = write_temp_file(""); // 生成一个足够大、能切成多块的文件
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    FILE* fp = fopen(path, "w");
+    for (int i = 0; i < 60000; i++) {
+        fprintf(fp, "key%d = value %d with some padding text\n", i % 20000, i); // 每个 key 出现三次
+        if (i % 1000 == 0) fprintf(fp, "# comment %d\n\n", i);
+    }
+    fprintf(fp, "tail=no newline at end");
+    fclose(fp);
+
+    mk_t* seq = mk_create(); // 顺序加载
+    mk_t* par = mk_create(); // 四线程加载
+    CU_ASSERT_EQUAL(mk_load(seq, path), 0);
+    CU_ASSERT_EQUAL(mk_load_parallel(par, path, 4), 0);
+    CU_ASSERT_EQUAL(mk_count(par), mk_count(seq));
+    CU_ASSERT_EQUAL(mk_count(par), 20001);
+    CU_ASSERT_STRING_EQUAL(mk_get(par, "key7"), "value 40007 with some padding text"); // 最后一次出现的值生效
+    CU_ASSERT_STRING_EQUAL(mk_get(par, "tail"), "no newline at end");
+    int mismatches = 0;
+    char key[32];
+    for (int i = 0; i < 20000; i++) { // 逐个比较
+        snprintf(key, sizeof(key), "key%d", i);
+        const char* a = mk_get(seq, key);
+        const char* b = mk_get(par, key);
+        if (!a || !b || strcmp(a, b) != 0) mismatches++;
+    }
+    CU_ASSERT_EQUAL(mismatches, 0);
+    int visited = 0;
+    mk_foreach(par, count_items, &visited); // 遍历到的条目数与计数一致
+    CU_ASSERT_EQUAL((size_t)visited, mk_count(par));
+    mk_destroy(seq);
+    mk_destroy(par);
+    unlink(path); // 删除临时文件
+    free(path);
+}
+
 // 主函数，初始化测试框架并运行所有测试
+// 有序遍历时把 key 依次拼成 "k1,k2,..."
+static void join_keys(const char* key, const char* value, void* user_data) {
+    (void)value;
+    char* out = (char*)user_data;
+    if (out[0]) strcat(out, ",");
+    strcat(out, key);
+}
+
+// 测试有序索引：开启前后的数据都在索引中，写入、覆盖、删除同步维护
+static void test_ordered_index(void) {
+    char out[256] = "";
+    mk_t* mk = mk_create();
+    mk_set(mk, "b", "2");
+    mk_set(mk, "app.cache.x", "1");
+    mk_set(mk, "app.cache.q", "5"); // 前 8 字节相同，建索引时要比较完整的 key
+    CU_ASSERT_EQUAL(mk_range(mk, NULL, NULL, join_keys, out), -1); // 未开启索引
+    CU_ASSERT_EQUAL(mk_index_enable(mk), 0); // 已有数据建入索引
+    mk_set(mk, "a", "1");
+    mk_set(mk, "app.cache.a", "2");
+    mk_set(mk, "app.z", "3");
+    mk_set(mk, "app.cache", "4");
+    mk_set(mk, "b", "a much longer value that needs a new node"); // 覆盖后索引指向新节点
+    CU_ASSERT_EQUAL(mk_range(mk, NULL, NULL, join_keys, out), 7);
+    CU_ASSERT_STRING_EQUAL(out, "a,app.cache,app.cache.a,app.cache.q,app.cache.x,app.z,b");
+
+    out[0] = '\0';
+    CU_ASSERT_EQUAL(mk_prefix(mk, "app.cache.", join_keys, out), 3);
+    CU_ASSERT_STRING_EQUAL(out, "app.cache.a,app.cache.q,app.cache.x");
+    out[0] = '\0';
+    CU_ASSERT_EQUAL(mk_range(mk, "app.cache", "app.cache.x", join_keys, out), 3); // [start, end)
+    CU_ASSERT_STRING_EQUAL(out, "app.cache,app.cache.a,app.cache.q");
+
+    mk_del(mk, "app.cache.a"); // 删除后从索引中消失
+    out[0] = '\0';
+    CU_ASSERT_EQUAL(mk_prefix(mk, "app.", join_keys, out), 4);
+    CU_ASSERT_STRING_EQUAL(out, "app.cache,app.cache.q,app.cache.x,app.z");
+    out[0] = '\0';
+    CU_ASSERT_EQUAL(mk_prefix(mk, "zzz", join_keys, out), 0);
+    mk_destroy(mk);
+
+    // 并发实例的各分片共用一个索引，数量足够多时覆盖跳表的多层
+    mk_t* cmk = mk_create_concurrent(8);
+    CU_ASSERT_EQUAL(mk_index_enable(cmk), 0);
+    char key[32];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(key, sizeof(key), "k%04d", i);
+        mk_set(cmk, key, "v");
+    }
+    for (int i = 0; i < 2000; i += 2) {
+        snprintf(key, sizeof(key), "k%04d", i);
+        mk_del(cmk, key);
+    }
+    out[0] = '\0';
+    CU_ASSERT_EQUAL(mk_range(cmk, "k0100", "k0106", join_keys, out), 3);
+    CU_ASSERT_STRING_EQUAL(out, "k0101,k0103,k0105");
+    out[0] = '\0';
+    CU_ASSERT_EQUAL(mk_prefix(cmk, "k199", join_keys, out), 5);
+    CU_ASSERT_STRING_EQUAL(out, "k1991,k1993,k1995,k1997,k1999");
+    mk_destroy(cmk);
+}
+
+// mk_scan 回调：记录 "k<n>" 形式的 key 被返回的次数
+static void mark_seen(const char* key, const char* value, void* user_data) {
+    (void)value;
+    int* seen = (int*)user_data;
+    if (key[0] == 'k') seen[atoi(key + 1)]++;
+}
+
+// 测试游标遍历：中途扩容、迁移和缩容都不会漏掉一直存在的 key
+static void test_scan_across_resize(void) {
+    static int seen[1000];
+    char key[32];
+    mk_t* mk = mk_create();
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mk_set(mk, key, "v");
+    }
+    memset(seen, 0, sizeof(seen));
+    uint64_t cursor = 0;
+    int calls = 0;
+    do {
+        cursor = mk_scan(mk, cursor, 10, mark_seen, seen);
+        calls++;
+        if (calls == 5) { // 扩容，之后的调用发生在渐进迁移期间
+            for (int i = 0; i < 5000; i++) {
+                snprintf(key, sizeof(key), "x%d", i);
+                mk_set(mk, key, "v");
+            }
+        } else if (calls == 40) { // 删掉大部分 key 触发缩容
+            for (int i = 0; i < 5000; i++) {
+                snprintf(key, sizeof(key), "x%d", i);
+                mk_del(mk, key);
+            }
+        }
+    } while (cursor != 0);
+    CU_ASSERT(calls > 40);
+    int missing = 0;
+    for (int i = 0; i < 1000; i++) missing += seen[i] == 0;
+    CU_ASSERT_EQUAL(missing, 0);
+    mk_destroy(mk);
+
+    // 并发实例：没有修改时每个 key 恰好返回一次
+    mk_t* cmk = mk_create_concurrent(4);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mk_set(cmk, key, "v");
+    }
+    memset(seen, 0, sizeof(seen));
+    cursor = 0;
+    do {
+        cursor = mk_scan(cmk, cursor, 7, mark_seen, seen);
+    } while (cursor != 0);
+    int exact = 0;
+    for (int i = 0; i < 1000; i++) exact += seen[i] == 1;
+    CU_ASSERT_EQUAL(exact, 1000);
+    mk_destroy(cmk);
+}
+
+// 测试 RESP 请求解析：流水线、不完整的数据、内联命令和协议错误
+static void test_resp_parse(void) {
+    static mk_view_t argv[RESP_MAX_ARGS];
+    int argc;
+    size_t used;
+    const char* buf = "*3\r\n$3\r\nSET\r\n$3\r\nk\0b\r\n$4\r\nv\r\nx\r\n*2\r\n$3\r\nGET\r\n$1\r\na\r\n";
+    size_t len = 52;
+    CU_ASSERT_EQUAL(resp_parse_command(buf, len, argv, &argc, &used), 1);
+    CU_ASSERT_EQUAL(argc, 3);
+    CU_ASSERT_EQUAL(used, 32);
+    CU_ASSERT(argv[1].len == 3 && memcmp(argv[1].data, "k\0b", 3) == 0); // 参数可以含 '\0' 和 \r\n
+    CU_ASSERT(argv[2].len == 4 && memcmp(argv[2].data, "v\r\nx", 4) == 0);
+    CU_ASSERT_EQUAL(resp_parse_command(buf + used, len - used, argv, &argc, &used), 1); // 流水线中的第二个请求
+    CU_ASSERT(argc == 2 && argv[1].len == 1 && argv[1].data[0] == 'a');
+    for (size_t cut = 1; cut < 32; cut++) { // 任意位置截断都要等待更多数据
+        CU_ASSERT_EQUAL(resp_parse_command(buf, cut, argv, &argc, &used), 0);
+    }
+    CU_ASSERT_EQUAL(resp_parse_command("  PING  hello\r\nGET", 19, argv, &argc, &used), 1); // 内联命令
+    CU_ASSERT(argc == 2 && used == 15 && argv[1].len == 5);
+    CU_ASSERT_EQUAL(resp_parse_command("\r\n", 2, argv, &argc, &used), 1);
+    CU_ASSERT_EQUAL(argc, 0);
+    CU_ASSERT_EQUAL(resp_parse_command("*1\r\n$3\r\nGETxx", 15, argv, &argc, &used), -1); // 长度与内容不符
+    CU_ASSERT_EQUAL(resp_parse_command("*1\r\n:3\r\n", 9, argv, &argc, &used), -1);
+
+    resp_buf_t out = { NULL, 0, 0, 0 };
+    resp_append_array(&out, 3);
+    resp_append_bulk(&out, "ab", 2);
+    resp_append_nil(&out);
+    resp_append_int(&out, -7);
+    resp_append_simple(&out, "OK");
+    resp_append_error(&out, "ERR x");
+    const char* expect = "*3\r\n$2\r\nab\r\n$-1\r\n:-7\r\n+OK\r\n-ERR x\r\n";
+    CU_ASSERT(out.len == strlen(expect) && memcmp(out.data, expect, out.len) == 0);
+    resp_buf_free(&out);
+}
+
+// SPSC 队列的生产者线程：按顺序放入 1..n，队列满时重试
+#define SPSC_ITEMS 200000
+
+static void* spsc_producer(void* p) {
+    mk_spsc_t* q = (mk_spsc_t*)p;
+    for (uintptr_t i = 1; i <= SPSC_ITEMS; i++) {
+        while (mk_spsc_push(q, (void*)i) != 0) sched_yield();
+    }
+    return NULL;
+}
+
+// SPSC 队列：容量取整、满和空的判断，以及跨线程时元素不丢失、不重复、保持顺序
+static void test_spsc_queue(void) {
+    mk_spsc_t q;
+    CU_ASSERT(mk_spsc_init(&q, 3) == 0);
+    CU_ASSERT(mk_spsc_empty(&q));
+    CU_ASSERT(mk_spsc_pop(&q) == NULL);
+    int items[4];
+    for (int i = 0; i < 4; i++) CU_ASSERT(mk_spsc_push(&q, &items[i]) == 0);
+    CU_ASSERT(mk_spsc_push(&q, &items[0]) == -1);
+    for (int i = 0; i < 4; i++) CU_ASSERT(mk_spsc_pop(&q) == &items[i]);
+    CU_ASSERT(mk_spsc_empty(&q));
+    mk_spsc_destroy(&q);
+
+    CU_ASSERT(mk_spsc_init(&q, 64) == 0);
+    pthread_t producer;
+    pthread_create(&producer, NULL, spsc_producer, &q);
+    uintptr_t expect = 1;
+    int in_order = 1;
+    while (expect <= SPSC_ITEMS) {
+        void* item = mk_spsc_pop(&q);
+        if (!item) {
+            sched_yield();
+            continue;
+        }
+        if ((uintptr_t)item != expect) in_order = 0;
+        expect++;
+    }
+    pthread_join(producer, NULL);
+    CU_ASSERT(in_order);
+    CU_ASSERT(mk_spsc_empty(&q));
+    mk_spsc_destroy(&q);
+}
+
+// 短暂休眠，等待 key 过期
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// 过期时间：到期后读取和遍历立即不可见，写操作或 mk_expire 回收内存，覆盖会清除过期时间
+static void count_cb(const char* key, const char* value, void* user_data) {
+    (void)key;
+    (void)value;
+    (*(int*)user_data)++;
+}
+
+static void test_expire_ttl(void) {
+    for (int concurrent = 0; concurrent < 2; concurrent++) {
+        mk_t* mk = concurrent ? mk_create_concurrent(4) : mk_create();
+        CU_ASSERT_EQUAL(mk_set_ex(mk, "a", "1", 0), -1); // ttl 必须大于 0
+        CU_ASSERT_EQUAL(mk_set_ex(mk, "bad key", "1", 1000), -2);
+        CU_ASSERT_EQUAL(mk_set_ex(mk, "short", "1", 30), 0);
+        CU_ASSERT_EQUAL(mk_set_ex(mk, "long", "2", 100000), 0);
+        CU_ASSERT_EQUAL(mk_set(mk, "plain", "3"), 0);
+        long long ttl = mk_ttl(mk, "long");
+        CU_ASSERT(ttl > 99000 && ttl <= 100000);
+        CU_ASSERT_EQUAL(mk_ttl(mk, "plain"), -1);
+        CU_ASSERT_EQUAL(mk_ttl(mk, "missing"), -2);
+        CU_ASSERT_STRING_EQUAL(mk_get(mk, "short"), "1");
+        // 批量写入一些很快过期的 key，值长短不一，覆盖原地改写和重新分配两种情况
+        char key[32];
+        for (int i = 0; i < 500; i++) {
+            snprintf(key, sizeof(key), "k%d", i);
+            mk_set_ex(mk, key, i % 2 ? "x" : "a much longer value than before", 20);
+        }
+        for (int i = 0; i < 500; i += 3) {
+            snprintf(key, sizeof(key), "k%d", i);
+            mk_set_ex(mk, key, i % 2 ? "a much longer value than before" : "y", 20);
+        }
+        mk_set_ex(mk, "k1", "kept", 100000); // 延长过期时间
+        mk_set(mk, "k2", "persist"); // 普通 set 清除过期时间
+        sleep_ms(60);
+
+        CU_ASSERT_PTR_NULL(mk_get(mk, "short"));
+        CU_ASSERT_EQUAL(mk_ttl(mk, "short"), -2);
+        CU_ASSERT_STRING_EQUAL(mk_get(mk, "k1"), "kept");
+        CU_ASSERT_STRING_EQUAL(mk_get(mk, "k2"), "persist");
+        CU_ASSERT_EQUAL(mk_ttl(mk, "k2"), -1);
+        const char* keys[3] = { "short", "long", "k3" };
+        const char* values[3];
+        CU_ASSERT_EQUAL(mk_mget(mk, keys, 3, values), 1);
+        int visible = 0;
+        mk_foreach(mk, count_cb, &visible);
+        CU_ASSERT_EQUAL(visible, 4); // long、plain、k1、k2
+        CU_ASSERT_EQUAL(mk_count(mk), 503); // 还没有回收
+        CU_ASSERT_EQUAL(mk_del(mk, "k4"), 0); // 写操作顺带回收一部分
+        size_t before = mk_count(mk);
+        CU_ASSERT(before < 503);
+        CU_ASSERT_EQUAL(mk_expire(mk), before - 4);
+        CU_ASSERT_EQUAL(mk_count(mk), 4);
+        CU_ASSERT_EQUAL(mk_expire(mk), 0);
+        CU_ASSERT_STRING_EQUAL(mk_get(mk, "long"), "2");
+        mk_destroy(mk);
+    }
+}
+
+// 过期时间在文本快照、二进制快照和日志中保存，加载时已经过期的 key 被丢弃
+static void test_expire_persistence(void) {
+    char* path = write_temp_file("");
+    CU_ASSERT_PTR_NOT_NULL(path);
+    if (!path) return;
+    char log_path[256];
+    snprintf(log_path, sizeof(log_path), "%s.log", path);
+    for (int binary = 0; binary < 2; binary++) {
+        mk_t* mk1 = mk_create();
+        mk_set_ex(mk1, "soon", "1", 20);
+        mk_set_ex(mk1, "later", "2", 100000);
+        mk_set_ex(mk1, "odd", "line\nbreak", 100000); // 转义行同样可以带过期时间
+        mk_set(mk1, "plain", "3");
+        CU_ASSERT_EQUAL(binary ? mk_save_binary(mk1, path) : mk_save(mk1, path), 0);
+        CU_ASSERT_EQUAL(mk_log_open(mk1, path, MK_FSYNC_NEVER, 0), 0); // 日志中的过期记录
+        mk_set_ex(mk1, "logged", "4", 100000);
+        mk_set_ex(mk1, "logged_soon", "5", 20);
+        mk_set_ex(mk1, "plain", "6", 100000);
+        mk_destroy(mk1);
+        sleep_ms(40);
+
+        mk_t* mk2 = mk_create();
+        CU_ASSERT_EQUAL(mk_load(mk2, path), 0);
+        CU_ASSERT_EQUAL(mk_count(mk2), 4);
+        CU_ASSERT_PTR_NULL(mk_get(mk2, "soon"));
+        CU_ASSERT_PTR_NULL(mk_get(mk2, "logged_soon"));
+        CU_ASSERT_STRING_EQUAL(mk_get(mk2, "odd"), "line\nbreak");
+        CU_ASSERT_STRING_EQUAL(mk_get(mk2, "plain"), "6");
+        long long ttl = mk_ttl(mk2, "later");
+        CU_ASSERT(ttl > 90000 && ttl <= 100000);
+        ttl = mk_ttl(mk2, "logged");
+        CU_ASSERT(ttl > 90000 && ttl <= 100000);
+        mk_destroy(mk2);
+
+        mk_t* mk3 = mk_create_concurrent(4); // 多线程加载同样保留过期时间
+        CU_ASSERT_EQUAL(mk_load_parallel(mk3, path, 2), 0);
+        CU_ASSERT_EQUAL(mk_count(mk3), 4);
+        CU_ASSERT(mk_ttl(mk3, "plain") > 90000);
+        mk_destroy(mk3);
+        unlink(log_path);
+    }
+    unlink(path);
+    free(path);
+}
+
+// 内存统计：节点按 slab 块大小计入，覆盖和删除后准确回到原值
+static void test_memory_accounting(void) {
+    mk_t* mk = mk_create();
+    size_t base = mk_memory_usage(mk);
+    CU_ASSERT(base > 0); // 初始的槽位数组
+    mk_set(mk, "a", "1");
+    CU_ASSERT_EQUAL(mk_memory_usage(mk), base + 32); // 节点头 22 字节 + "a\0" + "1\0"，落在 32 字节的块里
+    char big[101];
+    memset(big, 'x', 100);
+    big[100] = '\0';
+    mk_set(mk, "a", big); // 换成 128 字节的块
+    CU_ASSERT_EQUAL(mk_memory_usage(mk), base + 128);
+    mk_set(mk, "a", "2"); // 原地覆盖，块不变
+    CU_ASSERT_EQUAL(mk_memory_usage(mk), base + 128);
+    mk_del(mk, "a");
+    CU_ASSERT_EQUAL(mk_memory_usage(mk), base);
+    mk_destroy(mk);
+}
+
+// 统计信息：探测长度分布合计等于 key 数，各项字节数与写入的数据一致，扩容被计数
+static void test_stats(void) {
+    mk_stats_t st;
+    CU_ASSERT_EQUAL(mk_stats(NULL, &st), -1);
+    char key[32];
+    for (int concurrent = 0; concurrent < 2; concurrent++) {
+        mk_t* mk = concurrent ? mk_create_concurrent(4) : mk_create();
+        size_t klen_sum = 0;
+        for (int i = 0; i < 5000; i++) {
+            klen_sum += (size_t)snprintf(key, sizeof(key), "key%d", i);
+            mk_set(mk, key, "value");
+        }
+        CU_ASSERT_EQUAL(mk_stats(mk, &st), 0);
+        CU_ASSERT_EQUAL(st.count, 5000);
+        size_t hist = 0;
+        for (int i = 0; i < MK_STATS_PROBE_BUCKETS; i++) hist += st.probe_hist[i];
+        CU_ASSERT_EQUAL(hist, 5000);
+        CU_ASSERT(st.max_probe >= 1);
+        CU_ASSERT(st.avg_probe >= 1.0 && st.avg_probe <= (double)st.max_probe);
+        CU_ASSERT(st.load_factor > 0.0 && st.load_factor <= 0.75);
+        CU_ASSERT_EQUAL(st.key_bytes, klen_sum);
+        CU_ASSERT_EQUAL(st.value_bytes, 5000 * 5);
+        CU_ASSERT(st.node_bytes >= st.key_bytes + st.value_bytes + st.header_bytes);
+        CU_ASSERT(st.resizes > 0);
+        CU_ASSERT_EQUAL(st.memory, mk_memory_usage(mk));
+        mk_destroy(mk);
+    }
+}
+
+// 延迟记录：各操作分别计数，扩容和保存加载各记一次，暂停后不再记录；直方图各档首尾相接
+static void test_latency(void) {
+#ifdef MK_NO_LATENCY
+    // 编译时去掉了延迟记录，只能确认开启失败
+    mk_t* off = mk_create();
+    CU_ASSERT_EQUAL(mk_latency_enable(off, 1), -1);
+    mk_destroy(off);
+    return;
+#endif
+    mk_latency_t lat;
+    uint64_t low, high, prev = 0;
+    for (int i = 0; i < MK_LATENCY_BUCKETS; i++) {
+        CU_ASSERT_EQUAL(mk_latency_bucket(i, &low, &high), 0);
+        CU_ASSERT_EQUAL(low, prev);
+        CU_ASSERT(high > low);
+        prev = high;
+    }
+    CU_ASSERT_EQUAL(prev, UINT64_MAX);
+    CU_ASSERT_EQUAL(mk_latency_bucket(MK_LATENCY_BUCKETS, &low, &high), -1);
+
+    char key[32];
+    const char* path = "test_latency.kv";
+    for (int concurrent = 0; concurrent < 2; concurrent++) {
+        mk_t* mk = concurrent ? mk_create_concurrent(4) : mk_create();
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_GET, &lat), -1); // 从未开启
+        CU_ASSERT_EQUAL(mk_latency_enable(mk, 1), 0);
+        for (int i = 0; i < 2000; i++) {
+            snprintf(key, sizeof(key), "key%d", i);
+            mk_set(mk, key, "value");
+        }
+        mk_get(mk, "key1");
+        mk_get(mk, "missing");
+        mk_del(mk, "key1");
+        CU_ASSERT_EQUAL(mk_save(mk, path), 0);
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_SET, &lat), 0);
+        CU_ASSERT_EQUAL(lat.count, 2000);
+        CU_ASSERT(lat.p50_ns <= lat.p99_ns && lat.p99_ns <= lat.p999_ns && lat.p999_ns <= lat.max_ns);
+        CU_ASSERT(lat.total_ns >= lat.max_ns);
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_GET, &lat), 0);
+        CU_ASSERT_EQUAL(lat.count, 2);
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_DEL, &lat), 0);
+        CU_ASSERT_EQUAL(lat.count, 1);
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_RESIZE, &lat), 0);
+        CU_ASSERT(lat.count > 0);
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_SAVE, &lat), 0);
+        CU_ASSERT_EQUAL(lat.count, 1);
+        // 暂停后不再记录，已有数据保留；清空后归零
+        CU_ASSERT_EQUAL(mk_latency_enable(mk, 0), 0);
+        mk_get(mk, "key2");
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_GET, &lat), 0);
+        CU_ASSERT_EQUAL(lat.count, 2);
+        mk_latency_reset(mk);
+        CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_SET, &lat), 0);
+        CU_ASSERT_EQUAL(lat.count, 0);
+        mk_destroy(mk);
+    }
+    mk_t* mk = mk_create();
+    mk_latency_enable(mk, 1);
+    CU_ASSERT_EQUAL(mk_load(mk, path), 0);
+    CU_ASSERT_EQUAL(mk_latency(mk, MK_OP_LOAD, &lat), 0);
+    CU_ASSERT_EQUAL(lat.count, 1);
+    CU_ASSERT_STRING_EQUAL(mk_op_name(MK_OP_RESIZE), "resize");
+    CU_ASSERT_PTR_NULL(mk_op_name(MK_OP_COUNT));
+    mk_destroy(mk);
+    remove(path);
+}
+
+// 后台保存：子进程写的是发起时刻的数据，之后的修改不影响文件；进度和结果可以查询
+static void test_bgsave(void) {
+    char key[32];
+    const char* path = "test_bgsave.kv";
+    const char* path2 = "test_bgsave2.kv";
+    mk_bgsave_status_t st;
+    for (int concurrent = 0; concurrent < 2; concurrent++) {
+        for (int binary = 0; binary < 2; binary++) {
+            mk_t* mk = concurrent ? mk_create_concurrent(4) : mk_create();
+            CU_ASSERT_EQUAL(mk_bgsave_wait(mk), 1); // 从未发起
+            for (int i = 0; i < 5000; i++) {
+                snprintf(key, sizeof(key), "key%d", i);
+                mk_set(mk, key, "value");
+            }
+            CU_ASSERT_EQUAL(mk_bgsave(mk, path, binary), 0);
+            mk_set(mk, "key0", "changed");
+            mk_set(mk, "extra", "value");
+            // 前一次还没结束时拒绝；已经结束则另起一次，写到另一个文件
+            int again = mk_bgsave(mk, path2, binary);
+            CU_ASSERT(again == -2 || again == 0);
+            CU_ASSERT_EQUAL(mk_bgsave_wait(mk), 0);
+            CU_ASSERT_EQUAL(mk_bgsave_status(mk, &st), 0);
+            CU_ASSERT_FALSE(st.running);
+            CU_ASSERT_EQUAL(st.last_result, 0);
+            CU_ASSERT_EQUAL(st.keys_written, st.keys_total);
+            CU_ASSERT_EQUAL(st.keys_total, again == 0 ? 5001 : 5000);
+            mk_destroy(mk);
+
+            mk_t* loaded = mk_create();
+            CU_ASSERT_EQUAL(mk_load(loaded, path), 0);
+            CU_ASSERT_EQUAL(mk_count(loaded), 5000);
+            CU_ASSERT_STRING_EQUAL(mk_get(loaded, "key0"), "value");
+            CU_ASSERT_STRING_EQUAL(mk_get(loaded, "key4999"), "value");
+            CU_ASSERT_PTR_NULL(mk_get(loaded, "extra"));
+            mk_destroy(loaded);
+            remove(path);
+            remove(path2);
+        }
+    }
+}
+
+// 保存经过多块写缓冲：跨块的行、超过一块的 value、转义行和带过期时间的行都能原样读回
+// 保存完成后不留临时文件，统计中的写入字节数与文件大小一致；无法 rename 时返回错误并删除临时文件
+static void test_save_buffered(void) {
+    char key[32], val[64];
+    const char* path = "test_save_buffered.kv";
+    size_t big_len = 600 * 1024;
+    char* big = (char*)malloc(big_len + 1);
+    memset(big, 'x', big_len);
+    big[big_len] = '\0';
+
+    mk_t* mk = mk_create();
+    for (int i = 0; i < 20000; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "value-%d-0123456789abcdefghijklmnopqrstuvwxyz", i);
+        mk_set(mk, key, val);
+    }
+    mk_set(mk, "big", big);
+    mk_set_n(mk, "escaped", 7, "a\nb", 3);
+    mk_set_ex(mk, "ttl", "soon", 3600 * 1000);
+    mk_stats_t st;
+    for (int binary = 0; binary < 2; binary++) {
+        CU_ASSERT_EQUAL(binary ? mk_save_binary(mk, path) : mk_save(mk, path), 0);
+        CU_ASSERT_EQUAL(count_temp_files(path), 0);
+        struct stat sb;
+        CU_ASSERT_EQUAL(stat(path, &sb), 0);
+        CU_ASSERT_EQUAL(mk_stats(mk, &st), 0);
+        CU_ASSERT_EQUAL(st.saves, (uint64_t)binary + 1);
+        CU_ASSERT(st.last_save_mb_per_sec > 0);
+        if (!binary) CU_ASSERT_EQUAL(st.save_bytes, (uint64_t)sb.st_size);
+
+        mk_t* loaded = mk_create();
+        CU_ASSERT_EQUAL(mk_load(loaded, path), 0);
+        CU_ASSERT_EQUAL(mk_count(loaded), 20003);
+        CU_ASSERT_STRING_EQUAL(mk_get(loaded, "key19999"), "value-19999-0123456789abcdefghijklmnopqrstuvwxyz");
+        const char* got = mk_get(loaded, "big");
+        CU_ASSERT(got && strlen(got) == big_len);
+        mk_view_t view;
+        CU_ASSERT_EQUAL(mk_get_n(loaded, "escaped", 7, &view), 1);
+        CU_ASSERT(view.len == 3 && memcmp(view.data, "a\nb", 3) == 0);
+        CU_ASSERT_STRING_EQUAL(mk_get(loaded, "ttl"), "soon");
+        mk_destroy(loaded);
+    }
+
+    // 目标是目录时 rename 失败，临时文件被删掉
+    const char* dir = "test_save_buffered.dir";
+    CU_ASSERT_EQUAL(mkdir(dir, 0755), 0);
+    CU_ASSERT_NOT_EQUAL(mk_save(mk, dir), 0);
+    CU_ASSERT_EQUAL(count_temp_files(dir), 0);
+    CU_ASSERT_EQUAL(mk_stats(mk, &st), 0);
+    CU_ASSERT_EQUAL(st.saves, 2);
+    rmdir(dir);
+    mk_destroy(mk);
+    free(big);
+    remove(path);
+}
+
+// 并发实例上两个线程同时保存到同一路径：各写各的临时文件，最终文件完整
+typedef struct {
+    mk_t* kv;
+    const char* path;
+    int binary;
+    int failed;
+} save_arg_t;
+
+static void* save_thread(void* arg) {
+    save_arg_t* a = (save_arg_t*)arg;
+    for (int i = 0; i < 20; i++) {
+        if ((a->binary ? mk_save_binary(a->kv, a->path) : mk_save(a->kv, a->path)) != 0) a->failed++;
+    }
+    return NULL;
+}
+
+static void test_concurrent_save_same_path(void) {
+    const char* path = "test_concurrent_save.kv";
+    char key[32];
+    mk_t* mk = mk_create_concurrent(4);
+    for (int i = 0; i < 20000; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        mk_set(mk, key, "value-0123456789abcdefghijklmnopqrstuvwxyz");
+    }
+    for (int binary = 0; binary < 2; binary++) {
+        save_arg_t args[2] = { { mk, path, binary, 0 }, { mk, path, binary, 0 } };
+        pthread_t threads[2];
+        for (int t = 0; t < 2; t++) pthread_create(&threads[t], NULL, save_thread, &args[t]);
+        for (int t = 0; t < 2; t++) pthread_join(threads[t], NULL);
+        CU_ASSERT_EQUAL(args[0].failed + args[1].failed, 0);
+        CU_ASSERT_EQUAL(count_temp_files(path), 0);
+        CU_ASSERT_EQUAL(mk_file_is_binary(path), binary);
+        mk_t* loaded = mk_create();
+        CU_ASSERT_EQUAL(mk_load(loaded, path), 0);
+        CU_ASSERT_EQUAL(mk_count(loaded), 20000);
+        CU_ASSERT_STRING_EQUAL(mk_get(loaded, "key19999"), "value-0123456789abcdefghijklmnopqrstuvwxyz");
+        mk_destroy(loaded);
+    }
+    mk_destroy(mk);
+    remove(path);
+}
+
+// 内存上限：每次写入后不超过上限；LFU 保留访问频繁的 key，LRU 先淘汰最久没有访问的 key
+static void test_maxmemory_eviction(void) {
+    char key[32];
+    for (int concurrent = 0; concurrent < 2; concurrent++) {
+        mk_t* mk = concurrent ? mk_create_concurrent(4) : mk_create();
+        size_t limit = mk_memory_usage(mk) + 64 * 1024;
+        CU_ASSERT_EQUAL(mk_set_maxmemory(mk, limit, MK_EVICT_LFU), 0);
+        for (int i = 0; i < 100; i++) {
+            snprintf(key, sizeof(key), "hot%d", i);
+            mk_set(mk, key, "value");
+            for (int j = 0; j < 3; j++) mk_get(mk, key);
+        }
+        int over = 0;
+        for (int i = 0; i < 20000; i++) {
+            snprintf(key, sizeof(key), "cold%d", i);
+            mk_set(mk, key, "value");
+            if (i % 10 == 0) { // 热点 key 被反复读取
+                snprintf(key, sizeof(key), "hot%d", (i / 10) % 100);
+                mk_get(mk, key);
+            }
+            // 并发实例按分片限制，总量只保证不超过各分片上限之和
+            if (mk_memory_usage(mk) > limit + (concurrent ? 4096 : 0)) over = 1;
+        }
+        CU_ASSERT_FALSE(over);
+        CU_ASSERT(mk_count(mk) < 20100);
+        int kept = 0;
+        for (int i = 0; i < 100; i++) {
+            snprintf(key, sizeof(key), "hot%d", i);
+            if (mk_get(mk, key)) kept++;
+        }
+        CU_ASSERT(kept >= 90);
+        mk_destroy(mk);
+    }
+
+    mk_t* mk = mk_create();
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "old%d", i);
+        mk_set(mk, key, "value");
+    }
+    CU_ASSERT_EQUAL(mk_set_maxmemory(mk, mk_memory_usage(mk), MK_EVICT_LRU), 0);
+    sleep_ms(1100); // LRU 时钟以秒为单位
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "new%d", i);
+        mk_set(mk, key, "value");
+    }
+    int kept = 0;
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "new%d", i);
+        if (mk_get(mk, key)) kept++;
+    }
+    CU_ASSERT(kept >= 90);
+    CU_ASSERT_EQUAL(mk_set_maxmemory(mk, 0, MK_EVICT_LRU), 0); // 取消上限后不再淘汰
+    size_t count = mk_count(mk);
+    mk_set(mk, "extra", "value");
+    CU_ASSERT_EQUAL(mk_count(mk), count + 1);
+    mk_destroy(mk);
+}
+
 int main(void) {
     if (CUE_SUCCESS != CU_initialize_registry()) // 初始化CUnit注册表
         return CU_get_error();
@@ -198,7 +1583,38 @@ int main(void) {
         (NULL == CU_add_test(pSuite, "test_load_multiple_equals", test_load_multiple_equals)) ||
         (NULL == CU_add_test(pSuite, "test_save_load_consistency", test_save_load_consistency)) ||
         (NULL == CU_add_test(pSuite, "test_invalid_key", test_invalid_key)) ||
-        (NULL == CU_add_test(pSuite, "test_overwrite_does_not_increase_count", test_overwrite_does_not_increase_count)))
+        (NULL == CU_add_test(pSuite, "test_overwrite_does_not_increase_count", test_overwrite_does_not_increase_count)) ||
+        (NULL == CU_add_test(pSuite, "test_many_keys_resize_and_delete", test_many_keys_resize_and_delete)) ||
+        (NULL == CU_add_test(pSuite, "test_interleaved_ops_during_rehash", test_interleaved_ops_during_rehash)) ||
+        (NULL == CU_add_test(pSuite, "test_shared_prefix_keys", test_shared_prefix_keys)) ||
+        (NULL == CU_add_test(pSuite, "test_overwrite_grow_and_shrink_value", test_overwrite_grow_and_shrink_value)) ||
+        (NULL == CU_add_test(pSuite, "test_log_append_and_replay", test_log_append_and_replay)) ||
+        (NULL == CU_add_test(pSuite, "test_log_torn_tail", test_log_torn_tail)) ||
+        (NULL == CU_add_test(pSuite, "test_log_bad_length", test_log_bad_length)) ||
+        (NULL == CU_add_test(pSuite, "test_server_keeps_ttl", test_server_keeps_ttl)) ||
+        (NULL == CU_add_test(pSuite, "test_binary_snapshot_roundtrip", test_binary_snapshot_roundtrip)) ||
+        (NULL == CU_add_test(pSuite, "test_binary_snapshot_reseed", test_binary_snapshot_reseed)) ||
+        (NULL == CU_add_test(pSuite, "test_binary_snapshot_corrupt", test_binary_snapshot_corrupt)) ||
+        (NULL == CU_add_test(pSuite, "test_binary_snapshot_bad_count", test_binary_snapshot_bad_count)) ||
+        (NULL == CU_add_test(pSuite, "test_load_parallel_matches_sequential", test_load_parallel_matches_sequential)) ||
+        (NULL == CU_add_test(pSuite, "test_load_long_lines", test_load_long_lines)) ||
+        (NULL == CU_add_test(pSuite, "test_concurrent_threads", test_concurrent_threads)) ||
+        (NULL == CU_add_test(pSuite, "test_concurrent_lockfree_reads", test_concurrent_lockfree_reads)) ||
+        (NULL == CU_add_test(pSuite, "test_batch_operations", test_batch_operations)) ||
+        (NULL == CU_add_test(pSuite, "test_binary_safe_roundtrip", test_binary_safe_roundtrip)) ||
+        (NULL == CU_add_test(pSuite, "test_ordered_index", test_ordered_index)) ||
+        (NULL == CU_add_test(pSuite, "test_scan_across_resize", test_scan_across_resize)) ||
+        (NULL == CU_add_test(pSuite, "test_resp_parse", test_resp_parse)) ||
+        (NULL == CU_add_test(pSuite, "test_spsc_queue", test_spsc_queue)) ||
+        (NULL == CU_add_test(pSuite, "test_expire_ttl", test_expire_ttl)) ||
+        (NULL == CU_add_test(pSuite, "test_expire_persistence", test_expire_persistence)) ||
+        (NULL == CU_add_test(pSuite, "test_memory_accounting", test_memory_accounting)) ||
+        (NULL == CU_add_test(pSuite, "test_maxmemory_eviction", test_maxmemory_eviction)) ||
+        (NULL == CU_add_test(pSuite, "test_stats", test_stats)) ||
+        (NULL == CU_add_test(pSuite, "test_latency", test_latency)) ||
+        (NULL == CU_add_test(pSuite, "test_bgsave", test_bgsave)) ||
+        (NULL == CU_add_test(pSuite, "test_save_buffered", test_save_buffered)) ||
+        (NULL == CU_add_test(pSuite, "test_concurrent_save_same_path", test_concurrent_save_same_path)))
     {
         CU_cleanup_registry(); // 如果添加测试用例失败，清理注册表
         return CU_get_error();